@@ -0,0 +1,442 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#include "ns3/end-device-lora-phy.h"
+#include "ns3/end-device-lora-mac.h"
+#include "ns3/lora-net-device.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include "ns3/lora-helper.h"
+#include "ns3/lora-channel.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/propagation-delay-model.h"
+#include "ns3/node-container.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/position-allocator.h"
+#include "ns3/double.h"
+#include "ns3/string.h"
+#include "ns3/command-line.h"
+#include "ns3/lora-radio-energy-model-helper.h"
+#include "ns3/lora-energy-source-helper.h"
+#include "ns3/lora-energy-source.h"
+#include "ns3/lora-radio-energy-model.h"
+#include "ns3/lora-consumption-model.h"
+#include "ns3/lora-energy-monitor.h"
+#include "ns3/lora-stats-helper.h"
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("LoraEnergyBenchmark");
+
+/*********************************************************************
+ * Allocation counting (global operator new)
+ *********************************************************************/
+namespace {
+std::atomic<uint64_t> g_allocations (0);
+}
+
+void *
+operator new (std::size_t size)
+{
+  g_allocations.fetch_add (1, std::memory_order_relaxed);
+  void *p = std::malloc (size ? size : 1);
+  if (p == 0)
+    {
+      throw std::bad_alloc ();
+    }
+  return p;
+}
+
+void *
+operator new[] (std::size_t size)
+{
+  return operator new (size);
+}
+
+void
+operator delete (void *p) noexcept
+{
+  std::free (p);
+}
+
+void
+operator delete[] (void *p) noexcept
+{
+  std::free (p);
+}
+
+void
+operator delete (void *p, std::size_t) noexcept
+{
+  std::free (p);
+}
+
+void
+operator delete[] (void *p, std::size_t) noexcept
+{
+  std::free (p);
+}
+
+/*********************************************************************
+ * Parameters configuration
+ *********************************************************************/
+#define N_ITERATIONS                1000000
+#define N_SCHEDULED_EVENTS           200000
+#define FLEET_SIZES          "1000,100000"
+#define WRITER_NODES_PER_SIZE        200000
+#define FLEET_SIDE                    10000
+#define OUTPUT_DIR       "src/lorawan/deployment"
+#define JSON_FILE        "src/lorawan/deployment/energy-benchmark.json"
+
+namespace {
+
+struct Result
+{
+  std::string name;
+  uint64_t iterations;
+  double nsPerOp;
+  double allocsPerOp;
+  double opsPerSecond;
+  //Output volume of writers, 0 otherwise
+  double bytesPerSecond;
+};
+
+std::vector<Result> g_results;
+
+void
+Record (std::string name, uint64_t iterations, double ns, uint64_t allocations, double bytes = 0)
+{
+  Result result;
+  result.name = name;
+  result.iterations = iterations;
+  result.nsPerOp = ns / iterations;
+  result.allocsPerOp = static_cast<double> (allocations) / iterations;
+  result.opsPerSecond = ns > 0 ? 1e9 * iterations / ns : 0;
+  result.bytesPerSecond = ns > 0 ? 1e9 * bytes / ns : 0;
+  g_results.push_back (result);
+  std::cout << std::left << std::setw (44) << name << std::right
+            << std::setw (12) << iterations
+            << std::setw (14) << std::fixed << std::setprecision (2) << result.nsPerOp << " ns/op"
+            << std::setw (10) << std::setprecision (3) << result.allocsPerOp << " allocs/op"
+            << std::setw (14) << std::setprecision (0) << result.opsPerSecond << " op/s";
+  if (bytes > 0)
+    {
+      std::cout << std::setw (10) << std::setprecision (1) << result.bytesPerSecond / 1048576.0 << " MiB/s";
+    }
+  std::cout << std::endl;
+}
+
+double
+ElapsedNs (std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::nano> (std::chrono::steady_clock::now () - start).count ();
+}
+
+//Keeps results alive so the compiler cannot drop the benchmarked calls
+volatile double g_sink;
+
+/*********************************************************************
+ * Direct calls
+ *********************************************************************/
+void
+BenchCalcTxCurrent (uint64_t iterations)
+{
+  Ptr<LoraConsumptionModel> model = CreateObject<InterpolatedLoraConsumptionModel> ();
+  double sum = 0;
+  for (uint64_t i = 0; i < iterations / 10; i++)
+    {
+      sum += model->CalcTxCurrent (2.0 + (i % 19));
+    }
+
+  uint64_t allocations = g_allocations.load ();
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  for (uint64_t i = 0; i < iterations; i++)
+    {
+      //Sweep the table, interpolated points included
+      sum += model->CalcTxCurrent (2.0 + (i % 37) * 0.5);
+    }
+  double ns = ElapsedNs (start);
+  g_sink = sum;
+  Record ("InterpolatedLoraConsumptionModel::CalcTxCurrent", iterations, ns, g_allocations.load () - allocations);
+}
+
+/*********************************************************************
+ * Calls that need simulation time to advance
+ *
+ * n events 1 ms apart are scheduled, then only Simulator::Run is timed.
+ * The same run with no-op events is subtracted, so figures are net of
+ * the scheduler cost.
+ *********************************************************************/
+void
+NoOp (uint32_t i)
+{
+}
+
+void
+ChangeModelState (Ptr<LoraRadioEnergyModel> model, uint32_t i)
+{
+  static const int states[4] = { EndDeviceLoraPhy::TX, EndDeviceLoraPhy::STANDBY,
+                                 EndDeviceLoraPhy::RX, EndDeviceLoraPhy::SLEEP };
+  model->ChangeState (states[i % 4]);
+}
+
+void
+UpdateSource (Ptr<LoraEnergySource> source, uint32_t i)
+{
+  source->UpdateEnergySource ();
+}
+
+void
+SwitchPhy (Ptr<EndDeviceLoraPhy> phy, uint32_t i)
+{
+  //Legal PHY transitions, every one dispatched to the listeners
+  switch (i % 6)
+    {
+    case 0:
+      phy->SwitchToTx (14.0);
+      break;
+    case 2:
+      phy->SwitchToRx ();
+      break;
+    case 4:
+      phy->SwitchToSleep ();
+      break;
+    default:
+      phy->SwitchToStandby ();
+      break;
+    }
+}
+
+template <typename Schedule>
+void
+RunScheduled (uint32_t n, Schedule schedule, double &ns, uint64_t &allocations)
+{
+  for (uint32_t i = 0; i < n; i++)
+    {
+      schedule (MilliSeconds (i + 1), i);
+    }
+  Simulator::Stop (MilliSeconds (n + 1));
+  allocations = g_allocations.load ();
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  Simulator::Run ();
+  ns = ElapsedNs (start);
+  allocations = g_allocations.load () - allocations;
+}
+
+template <typename Schedule>
+void
+BenchScheduled (std::string name, uint32_t n, Schedule schedule)
+{
+  double baseNs;
+  uint64_t baseAllocations;
+  RunScheduled (n, [] (Time t, uint32_t i) { Simulator::Schedule (t, &NoOp, i); },
+                baseNs, baseAllocations);
+  double ns;
+  uint64_t allocations;
+  RunScheduled (n, schedule, ns, allocations);
+  Record (name, n, std::max (0.0, ns - baseNs),
+          allocations > baseAllocations ? allocations - baseAllocations : 0);
+}
+
+/*********************************************************************
+ * Fleets
+ *********************************************************************/
+struct Fleet
+{
+  NodeContainer endDevices;
+  NodeContainer gateways;
+  Ptr<LoraEnergyMonitor> monitor;
+};
+
+Fleet
+BuildFleet (uint32_t n)
+{
+  Fleet fleet;
+  Ptr<LogDistancePropagationLossModel> loss = CreateObject<LogDistancePropagationLossModel> ();
+  Ptr<PropagationDelayModel> delay = CreateObject<ConstantSpeedPropagationDelayModel> ();
+  Ptr<LoraChannel> channel = CreateObject<LoraChannel> (loss, delay);
+
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  std::ostringstream side;
+  side << "ns3::UniformRandomVariable[Min=" << -FLEET_SIDE / 2 << "|Max=" << FLEET_SIDE / 2 << "]";
+  mobility.SetPositionAllocator ("ns3::RandomBoxPositionAllocator",
+                                 "X", StringValue (side.str ()),
+                                 "Y", StringValue (side.str ()),
+                                 "Z", StringValue ("ns3::ConstantRandomVariable[Constant=1.5]"));
+
+  LoraPhyHelper phyHelper = LoraPhyHelper ();
+  phyHelper.SetChannel (channel);
+  LoraMacHelper macHelper = LoraMacHelper ();
+  LoraHelper helper = LoraHelper ();
+
+  fleet.endDevices.Create (n);
+  mobility.Install (fleet.endDevices);
+  phyHelper.SetDeviceType (LoraPhyHelper::ED);
+  macHelper.SetDeviceType (LoraMacHelper::ED);
+  NetDeviceContainer devices = helper.Install (phyHelper, macHelper, fleet.endDevices);
+
+  fleet.gateways.Create (1);
+  mobility.Install (fleet.gateways);
+  phyHelper.SetDeviceType (LoraPhyHelper::GW);
+  macHelper.SetDeviceType (LoraMacHelper::GW);
+  helper.Install (phyHelper, macHelper, fleet.gateways);
+
+  LoraEnergySourceHelper sourceHelper;
+  LoraRadioEnergyModelHelper radioEnergyHelper;
+  fleet.monitor = CreateObject<LoraEnergyMonitor> ();
+  radioEnergyHelper.SetConsumptionModel ("ns3::InterpolatedLoraConsumptionModel");
+  radioEnergyHelper.SetMonitor (fleet.monitor);
+  EnergySourceContainer sources = sourceHelper.BulkInstall (fleet.endDevices);
+  radioEnergyHelper.BulkInstall (devices, sources);
+  return fleet;
+}
+
+uint64_t
+FileSize (std::string fileName)
+{
+  struct stat st;
+  return stat (fileName.c_str (), &st) == 0 ? st.st_size : 0;
+}
+
+template <typename Write>
+void
+BenchWriter (std::string name, uint32_t nodes, uint32_t repetitions, std::string fileName, Write write)
+{
+  write (fileName);
+  uint64_t allocations = g_allocations.load ();
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  for (uint32_t r = 0; r < repetitions; r++)
+    {
+      write (fileName);
+    }
+  double ns = ElapsedNs (start);
+  allocations = g_allocations.load () - allocations;
+  std::ostringstream label;
+  label << name << "/" << nodes;
+  //One op is one node written
+  Record (label.str (), static_cast<uint64_t> (nodes) * repetitions, ns, allocations,
+          static_cast<double> (FileSize (fileName)) * repetitions);
+}
+
+void
+WriteJson (std::string fileName)
+{
+  std::ofstream file (fileName.c_str ());
+  file << "{\n  \"benchmarks\": [\n";
+  for (uint32_t i = 0; i < g_results.size (); i++)
+    {
+      const Result &r = g_results[i];
+      file << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+           << ", \"nsPerOp\": " << r.nsPerOp << ", \"allocsPerOp\": " << r.allocsPerOp
+           << ", \"opsPerSecond\": " << r.opsPerSecond
+           << ", \"bytesPerSecond\": " << r.bytesPerSecond << "}"
+           << (i + 1 < g_results.size () ? "," : "") << "\n";
+    }
+  file << "  ]\n}\n";
+}
+
+} // namespace
+
+/*********************************************************************
+ * Main Program - Energy model microbenchmarks
+ *********************************************************************/
+
+int main (int argc, char *argv[])
+{
+  uint64_t iterations = N_ITERATIONS;
+  uint32_t scheduledEvents = N_SCHEDULED_EVENTS;
+  std::string fleetSizes = FLEET_SIZES;
+  std::string outputDir = OUTPUT_DIR;
+  std::string jsonFile = JSON_FILE;
+
+  CommandLine cmd;
+  cmd.AddValue ("iterations", "Iterations of the direct-call benchmarks", iterations);
+  cmd.AddValue ("events", "Events of the scheduled benchmarks", scheduledEvents);
+  cmd.AddValue ("fleetSizes", "Comma separated fleet sizes of the writer benchmarks", fleetSizes);
+  cmd.AddValue ("outputDir", "Directory of the files written by the writer benchmarks", outputDir);
+  cmd.AddValue ("json", "JSON results file", jsonFile);
+  cmd.Parse (argc, argv);
+
+  /*********************************************************************
+   *  Hot paths of a single device
+   *********************************************************************/
+  BenchCalcTxCurrent (iterations);
+
+  Fleet single = BuildFleet (1);
+  const LoraEnergyMonitor::Entry &device = single.monitor->Get (0);
+  Ptr<LoraRadioEnergyModel> model = device.model;
+  Ptr<LoraEnergySource> source = device.source;
+  Ptr<EndDeviceLoraPhy> phy = DynamicCast<LoraNetDevice> (single.endDevices.Get (0)->GetDevice (0))
+    ->GetPhy ()->GetObject<EndDeviceLoraPhy> ();
+  NS_ASSERT (phy != 0);
+  phy->SwitchToStandby ();
+
+  BenchScheduled ("LoraRadioEnergyModel::ChangeState", scheduledEvents,
+                  [model] (Time t, uint32_t i) { Simulator::Schedule (t, &ChangeModelState, model, i); });
+  BenchScheduled ("LoraEnergySource::UpdateEnergySource", scheduledEvents,
+                  [source] (Time t, uint32_t i) { Simulator::Schedule (t, &UpdateSource, source, i); });
+  BenchScheduled ("EndDeviceLoraPhy listener dispatch", scheduledEvents,
+                  [phy] (Time t, uint32_t i) { Simulator::Schedule (t, &SwitchPhy, phy, i); });
+
+  /*********************************************************************
+   *  Statistics writers
+   *********************************************************************/
+  std::istringstream sizes (fleetSizes);
+  std::string size;
+  while (std::getline (sizes, size, ','))
+    {
+      uint32_t nodes = std::atoi (size.c_str ());
+      if (nodes == 0)
+        {
+          continue;
+        }
+      Fleet fleet = BuildFleet (nodes);
+      LoraStatsHelper statsHelper;
+      uint32_t repetitions = std::max (1u, WRITER_NODES_PER_SIZE / nodes);
+      Ptr<LoraEnergyMonitor> monitor = fleet.monitor;
+      NodeContainer gateways = fleet.gateways;
+
+      BenchWriter ("LoraStatsHelper::EnergyInformation", nodes, repetitions, outputDir + "/benchmark-energy.dat",
+                   [&] (std::string f) { statsHelper.EnergyInformation (f, monitor); });
+      BenchWriter ("LoraStatsHelper::EnergyInformationBinary", nodes, repetitions, outputDir + "/benchmark-energy.col",
+                   [&] (std::string f) { statsHelper.EnergyInformationBinary (f, monitor); });
+      BenchWriter ("LoraStatsHelper::NodeInformation", nodes, repetitions, outputDir + "/benchmark-collect.dat",
+                   [&] (std::string f) { statsHelper.NodeInformation (f, monitor, gateways); });
+      BenchWriter ("LoraStatsHelper::NodeInformationBinary", nodes, repetitions, outputDir + "/benchmark-collect.col",
+                   [&] (std::string f) { statsHelper.NodeInformationBinary (f, monitor, gateways); });
+    }
+
+  WriteJson (jsonFile);
+  NS_LOG_INFO ("Results written to " << jsonFile);
+
+  Simulator::Destroy ();
+  return 0;
+}
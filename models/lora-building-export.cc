@@ -0,0 +1,385 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#include "lora-building-export.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/building-list.h"
+#include "ns3/building.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <map>
+
+#define BUILDING_MAGIC          "LORABLD1"
+#define BUILDING_VERSION        2
+#define GRID_TOLERANCE          1e-6
+#define FILE_BUFFER_SIZE        (1 << 20)
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LoraBuildingExport");
+
+namespace {
+
+//Corner c of a box, bit 0 selects xMax, bit 1 yMax, bit 2 zMax
+void
+GetCorner (const Box &box, uint32_t c, double corner[3])
+{
+  corner[0] = (c & 1) ? box.xMax : box.xMin;
+  corner[1] = (c & 2) ? box.yMax : box.yMin;
+  corner[2] = (c & 4) ? box.zMax : box.zMin;
+}
+
+//Six faces as corner indices, counter-clockwise seen from outside
+const uint32_t g_faces[6][4] = { { 0, 2, 3, 1 },   //bottom
+                                 { 4, 5, 7, 6 },   //top
+                                 { 0, 4, 6, 2 },   //xMin
+                                 { 1, 3, 7, 5 },   //xMax
+                                 { 0, 1, 5, 4 },   //yMin
+                                 { 2, 6, 7, 3 } }; //yMax
+
+bool
+Equal (double a, double b)
+{
+  return std::fabs (a - b) <= GRID_TOLERANCE * std::max (1.0, std::fabs (a));
+}
+
+template <typename T>
+void
+Put (std::ofstream &file, const T &value)
+{
+  file.write (reinterpret_cast<const char *> (&value), sizeof (value));
+}
+
+template <typename T>
+void
+Get (std::ifstream &file, std::string fileName, T &value)
+{
+  if (!file.read (reinterpret_cast<char *> (&value), sizeof (value)))
+    {
+      NS_FATAL_ERROR ("Truncated building file " << fileName);
+    }
+}
+
+} // anonymous namespace
+
+std::vector<Box>
+LoraBuildingExport::GetBoxes (void)
+{
+  std::vector<Box> boxes;
+  boxes.reserve (BuildingList::GetNBuildings ());
+  for (BuildingList::Iterator i = BuildingList::Begin (); i != BuildingList::End (); ++i)
+    {
+      boxes.push_back ((*i)->GetBoundaries ());
+    }
+  return boxes;
+}
+
+bool
+LoraBuildingExport::DetectGrid (const std::vector<Box> &boxes, Grid &grid)
+{
+  if (boxes.size () < 2)
+    {
+      return false;
+    }
+  const Box &first = boxes[0];
+  grid.xMin = first.xMin;
+  grid.yMin = first.yMin;
+  grid.zMin = first.zMin;
+  grid.zMax = first.zMax;
+  grid.lengthX = first.xMax - first.xMin;
+  grid.lengthY = first.yMax - first.yMin;
+  grid.count = boxes.size ();
+
+  //Row first if the second building is on the same row
+  grid.rowFirst = Equal (boxes[1].yMin, first.yMin);
+  grid.gridWidth = 1;
+  while (grid.gridWidth < boxes.size ()
+         && (grid.rowFirst ? Equal (boxes[grid.gridWidth].yMin, first.yMin)
+                           : Equal (boxes[grid.gridWidth].xMin, first.xMin)))
+    {
+      grid.gridWidth++;
+    }
+  if (grid.rowFirst)
+    {
+      grid.stepX = boxes[1].xMin - first.xMin;
+      grid.stepY = grid.gridWidth < boxes.size () ? boxes[grid.gridWidth].yMin - first.yMin : 0;
+    }
+  else
+    {
+      grid.stepY = boxes[1].yMin - first.yMin;
+      grid.stepX = grid.gridWidth < boxes.size () ? boxes[grid.gridWidth].xMin - first.xMin : 0;
+    }
+
+  //Every box must be where the grid puts it
+  std::vector<Box> expected = ExpandGrid (grid);
+  for (uint32_t k = 0; k < boxes.size (); k++)
+    {
+      if (!Equal (boxes[k].xMin, expected[k].xMin) || !Equal (boxes[k].xMax, expected[k].xMax)
+          || !Equal (boxes[k].yMin, expected[k].yMin) || !Equal (boxes[k].yMax, expected[k].yMax)
+          || !Equal (boxes[k].zMin, expected[k].zMin) || !Equal (boxes[k].zMax, expected[k].zMax))
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+std::vector<Box>
+LoraBuildingExport::ExpandGrid (const Grid &grid)
+{
+  std::vector<Box> boxes;
+  boxes.reserve (grid.count);
+  for (uint32_t k = 0; k < grid.count; k++)
+    {
+      uint32_t column = grid.rowFirst ? k % grid.gridWidth : k / grid.gridWidth;
+      uint32_t row    = grid.rowFirst ? k / grid.gridWidth : k % grid.gridWidth;
+      double x = grid.xMin + column * grid.stepX;
+      double y = grid.yMin + row * grid.stepY;
+      boxes.push_back (Box (x, x + grid.lengthX, y, y + grid.lengthY, grid.zMin, grid.zMax));
+    }
+  return boxes;
+}
+
+void
+LoraBuildingExport::BuildMesh (const std::vector<Box> &boxes, std::vector<double> &vertices,
+                               std::vector<uint32_t> &quads)
+{
+  //Shared corners are stored once
+  std::map<std::vector<double>, uint32_t> index;
+  std::vector<double> key (3);
+  vertices.reserve (boxes.size () * 8 * 3);
+  quads.reserve (boxes.size () * 6 * 4);
+  for (std::size_t b = 0; b < boxes.size (); b++)
+    {
+      uint32_t corners[8];
+      for (uint32_t c = 0; c < 8; c++)
+        {
+          GetCorner (boxes[b], c, &key[0]);
+          std::map<std::vector<double>, uint32_t>::iterator it = index.find (key);
+          if (it == index.end ())
+            {
+              uint32_t id = vertices.size () / 3;
+              index.insert (std::make_pair (key, id));
+              vertices.push_back (key[0]);
+              vertices.push_back (key[1]);
+              vertices.push_back (key[2]);
+              corners[c] = id;
+            }
+          else
+            {
+              corners[c] = it->second;
+            }
+        }
+      for (uint32_t f = 0; f < 6; f++)
+        {
+          for (uint32_t v = 0; v < 4; v++)
+            {
+              quads.push_back (corners[g_faces[f][v]]);
+            }
+        }
+    }
+}
+
+void
+LoraBuildingExport::WriteMeshText (std::string fileName, const std::vector<Box> &boxes)
+{
+  std::vector<double> vertices;
+  std::vector<uint32_t> quads;
+  BuildMesh (boxes, vertices, quads);
+
+  std::vector<char> buffer (FILE_BUFFER_SIZE);
+  std::ofstream file;
+  file.rdbuf ()->pubsetbuf (&buffer[0], buffer.size ());
+  file.open (fileName.c_str (), std::ios_base::out | std::ios_base::trunc);
+  NS_ASSERT (file.is_open () == true);
+  //Enough digits for UTM-sized coordinates at sub-millimetre resolution
+  file << std::setprecision (15);
+
+  file << "# " << boxes.size () << " buildings, " << vertices.size () / 3 << " vertices, "
+       << quads.size () / 4 << " faces\n";
+  for (std::size_t v = 0; v < vertices.size (); v += 3)
+    {
+      file << "v " << vertices[v] << " " << vertices[v + 1] << " " << vertices[v + 2] << "\n";
+    }
+  //One group per building, 1-based indices
+  for (std::size_t q = 0; q < quads.size (); q += 4)
+    {
+      if (q % 24 == 0)
+        {
+          file << "g building" << q / 24 + 1 << "\n";
+        }
+      file << "f " << quads[q] + 1 << " " << quads[q + 1] + 1 << " "
+           << quads[q + 2] + 1 << " " << quads[q + 3] + 1 << "\n";
+    }
+  file.close ();
+}
+
+LoraBuildingExport::Encoding
+LoraBuildingExport::WriteBinary (std::string fileName, const std::vector<Box> &boxes)
+{
+  std::ofstream file (fileName.c_str (), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+  NS_ASSERT (file.is_open () == true);
+
+  Grid grid;
+  Encoding encoding = DetectGrid (boxes, grid) ? GRID : MESH;
+  file.write (BUILDING_MAGIC, 8);
+  Put (file, static_cast<uint32_t> (BUILDING_VERSION));
+  Put (file, static_cast<uint32_t> (encoding));
+
+  if (encoding == GRID)
+    {
+      Put (file, grid.xMin);
+      Put (file, grid.yMin);
+      Put (file, grid.zMin);
+      Put (file, grid.zMax);
+      Put (file, grid.lengthX);
+      Put (file, grid.lengthY);
+      Put (file, grid.stepX);
+      Put (file, grid.stepY);
+      Put (file, grid.gridWidth);
+      Put (file, grid.count);
+      Put (file, static_cast<uint32_t> (grid.rowFirst));
+    }
+  else
+    {
+      std::vector<double> vertices;
+      std::vector<uint32_t> quads;
+      BuildMesh (boxes, vertices, quads);
+      Put (file, static_cast<uint32_t> (vertices.size () / 3));
+      Put (file, static_cast<uint32_t> (quads.size () / 4));
+      if (!vertices.empty ())
+        {
+          file.write (reinterpret_cast<const char *> (&vertices[0]), vertices.size () * sizeof (double));
+          file.write (reinterpret_cast<const char *> (&quads[0]), quads.size () * sizeof (uint32_t));
+        }
+    }
+  NS_LOG_DEBUG ("Buildings written to " << fileName << " as " << (encoding == GRID ? "grid" : "mesh"));
+  return encoding;
+}
+
+std::vector<Box>
+LoraBuildingExport::ReadBinary (std::string fileName)
+{
+  std::ifstream file (fileName.c_str (), std::ios_base::in | std::ios_base::binary);
+  if (!file.is_open ())
+    {
+      NS_FATAL_ERROR ("Cannot open building file " << fileName);
+    }
+  char magic[8];
+  uint32_t version, encoding;
+  if (!file.read (magic, 8) || std::memcmp (magic, BUILDING_MAGIC, 8) != 0)
+    {
+      NS_FATAL_ERROR ("Not a building file: " << fileName);
+    }
+  Get (file, fileName, version);
+  Get (file, fileName, encoding);
+  if (version != BUILDING_VERSION)
+    {
+      NS_FATAL_ERROR ("Unsupported building file version " << version);
+    }
+
+  if (encoding == GRID)
+    {
+      Grid grid;
+      uint32_t rowFirst;
+      Get (file, fileName, grid.xMin);
+      Get (file, fileName, grid.yMin);
+      Get (file, fileName, grid.zMin);
+      Get (file, fileName, grid.zMax);
+      Get (file, fileName, grid.lengthX);
+      Get (file, fileName, grid.lengthY);
+      Get (file, fileName, grid.stepX);
+      Get (file, fileName, grid.stepY);
+      Get (file, fileName, grid.gridWidth);
+      Get (file, fileName, grid.count);
+      Get (file, fileName, rowFirst);
+      if ((grid.count > 0 && grid.gridWidth == 0) || rowFirst > 1)
+        {
+          NS_FATAL_ERROR ("Invalid building grid in " << fileName);
+        }
+      grid.rowFirst = rowFirst != 0;
+      return ExpandGrid (grid);
+    }
+  if (encoding != MESH)
+    {
+      NS_FATAL_ERROR ("Unknown building encoding " << encoding << " in " << fileName);
+    }
+
+  uint32_t nVertices, nQuads;
+  Get (file, fileName, nVertices);
+  Get (file, fileName, nQuads);
+  if ((nVertices == 0) != (nQuads == 0) || nQuads % 6 != 0)
+    {
+      NS_FATAL_ERROR ("Invalid mesh of " << nVertices << " vertices and " << nQuads
+                      << " quads in " << fileName);
+    }
+  //Check the counts against the file size before allocating
+  std::streampos position = file.tellg ();
+  file.seekg (0, std::ios_base::end);
+  uint64_t available = static_cast<uint64_t> (file.tellg () - position);
+  file.seekg (position);
+  if (3 * sizeof (double) * static_cast<uint64_t> (nVertices) + 4 * sizeof (uint32_t) * static_cast<uint64_t> (nQuads) > available)
+    {
+      NS_FATAL_ERROR ("Truncated building file " << fileName);
+    }
+
+  std::vector<double> vertices (static_cast<std::size_t> (nVertices) * 3);
+  std::vector<uint32_t> quads (static_cast<std::size_t> (nQuads) * 4);
+  if (nVertices > 0)
+    {
+      if (!file.read (reinterpret_cast<char *> (&vertices[0]), vertices.size () * sizeof (double))
+          || !file.read (reinterpret_cast<char *> (&quads[0]), quads.size () * sizeof (uint32_t)))
+        {
+          NS_FATAL_ERROR ("Truncated building file " << fileName);
+        }
+    }
+  for (std::size_t i = 0; i < quads.size (); i++)
+    {
+      if (quads[i] >= nVertices)
+        {
+          NS_FATAL_ERROR ("Quad vertex index " << quads[i] << " out of " << nVertices
+                          << " vertices in " << fileName);
+        }
+    }
+
+  //Six quads per building, the box is the extent of its corners
+  std::vector<Box> boxes;
+  boxes.reserve (nQuads / 6);
+  for (uint32_t b = 0; b < nQuads; b += 6)
+    {
+      Box box (1e300, -1e300, 1e300, -1e300, 1e300, -1e300);
+      for (uint32_t i = b * 4; i < (b + 6) * 4; i++)
+        {
+          const double *v = &vertices[static_cast<std::size_t> (quads[i]) * 3];
+          box.xMin = std::min (box.xMin, v[0]);
+          box.xMax = std::max (box.xMax, v[0]);
+          box.yMin = std::min (box.yMin, v[1]);
+          box.yMax = std::max (box.yMax, v[1]);
+          box.zMin = std::min (box.zMin, v[2]);
+          box.zMax = std::max (box.zMax, v[2]);
+        }
+      boxes.push_back (box);
+    }
+  return boxes;
+}
+
+} // namespace ns3
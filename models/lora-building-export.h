@@ -0,0 +1,96 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#ifndef LORA_BUILDING_EXPORT_H
+#define LORA_BUILDING_EXPORT_H
+
+#include "ns3/box.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup energy
+ *
+ * \brief Compact export of the building geometry
+ *
+ * Buildings are boxes, exported as an indexed mesh: every distinct corner
+ * is written once and each face refers to its four corners, so touching
+ * buildings share vertices. Text output is Wavefront OBJ (v / f lines,
+ * 1-based indices). Binary layout, little endian:
+ *
+ *   header : char magic[8] = "LORABLD1", uint32 version, uint32 encoding
+ *   MESH   : uint32 nVertices, uint32 nQuads,
+ *            double xyz[3 * nVertices], uint32 quad[4 * nQuads] (0-based,
+ *            six quads per building)
+ *   GRID   : double xMin, yMin, zMin, zMax, lengthX, lengthY, stepX, stepY,
+ *            uint32 gridWidth, uint32 count, uint32 rowFirst
+ *
+ * GRID is used when the buildings form the regular layout produced by
+ * GridBuildingAllocator (equal boxes, constant steps, filled row or column
+ * first), whatever the number of buildings. ReadBinary rejects other
+ * versions, inconsistent counts and out-of-range quad indices.
+ */
+class LoraBuildingExport
+{
+public:
+  enum Encoding
+  {
+    MESH = 1,
+    GRID = 2
+  };
+
+  //Parameters of a regular layout
+  struct Grid
+  {
+    double xMin;
+    double yMin;
+    double zMin;
+    double zMax;
+    double lengthX;
+    double lengthY;
+    double stepX;
+    double stepY;
+    uint32_t gridWidth;
+    uint32_t count;
+    bool rowFirst;
+  };
+
+  //Boxes of all buildings in BuildingList order
+  static std::vector<Box> GetBoxes (void);
+
+  //True if the boxes are a regular grid, filling grid
+  static bool DetectGrid (const std::vector<Box> &boxes, Grid &grid);
+  //Boxes of a grid in allocation order
+  static std::vector<Box> ExpandGrid (const Grid &grid);
+
+  static void WriteMeshText (std::string fileName, const std::vector<Box> &boxes);
+  //Grid encoding if the layout is regular, mesh otherwise; returns the encoding
+  static Encoding WriteBinary (std::string fileName, const std::vector<Box> &boxes);
+  static std::vector<Box> ReadBinary (std::string fileName);
+
+private:
+  static void BuildMesh (const std::vector<Box> &boxes, std::vector<double> &vertices,
+                         std::vector<uint32_t> &quads);
+};
+
+} // namespace ns3
+
+#endif /* LORA_BUILDING_EXPORT_H */
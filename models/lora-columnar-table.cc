@@ -0,0 +1,402 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#include "lora-columnar-table.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include <fstream>
+#include <cstring>
+#include <cmath>
+#include <limits>
+
+#define COLUMNAR_MAGIC          "LORACOL1"
+#define COLUMNAR_VERSION        1
+#define COLUMNAR_ALIGN          64
+#define COLUMNAR_NAME_LENGTH    48
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LoraColumnarTable");
+
+namespace {
+
+//On-disk header and schema entries, 64 bytes each
+struct FileHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t nColumns;
+  uint64_t nRows;
+  char padding[40];
+};
+
+struct SchemaEntry
+{
+  char name[COLUMNAR_NAME_LENGTH];
+  uint32_t type;
+  uint32_t elementSize;
+  uint64_t offset;
+};
+
+uint64_t
+Align (uint64_t offset)
+{
+  return (offset + COLUMNAR_ALIGN - 1) / COLUMNAR_ALIGN * COLUMNAR_ALIGN;
+}
+
+//Read header and schema of a binary file
+void
+ReadSchema (std::ifstream &file, std::string fileName, FileHeader &header, std::vector<SchemaEntry> &schema)
+{
+  if (!file.read (reinterpret_cast<char *> (&header), sizeof (header))
+      || std::memcmp (header.magic, COLUMNAR_MAGIC, 8) != 0)
+    {
+      NS_FATAL_ERROR ("Not a columnar results file: " << fileName);
+    }
+  if (header.version != COLUMNAR_VERSION)
+    {
+      NS_FATAL_ERROR ("Unsupported columnar version " << header.version << " in " << fileName);
+    }
+  schema.resize (header.nColumns);
+  if (header.nColumns > 0
+      && !file.read (reinterpret_cast<char *> (&schema[0]), header.nColumns * sizeof (SchemaEntry)))
+    {
+      NS_FATAL_ERROR ("Truncated schema in " << fileName);
+    }
+}
+
+} // anonymous namespace
+
+LoraColumnarTable::LoraColumnarTable ()
+{
+}
+
+LoraColumnarTable::~LoraColumnarTable ()
+{
+}
+
+uint32_t
+LoraColumnarTable::GetElementSize (ColumnType type)
+{
+  switch (type)
+    {
+    case LABEL:
+      return 4;
+    case UINT32:
+      return sizeof (uint32_t);
+    case DOUBLE:
+      return sizeof (double);
+    default:
+      NS_FATAL_ERROR ("Invalid column type: " << type);
+    }
+  return 0;
+}
+
+bool
+LoraColumnarTable::IsAbsent (const Column &column, uint64_t row)
+{
+  const char *value = &column.data[row * GetElementSize (column.type)];
+  if (column.type == UINT32)
+    {
+      uint32_t v;
+      std::memcpy (&v, value, sizeof (v));
+      return v == ABSENT_UINT;
+    }
+  if (column.type == DOUBLE)
+    {
+      double v;
+      std::memcpy (&v, value, sizeof (v));
+      return std::isnan (v);
+    }
+  return false;
+}
+
+uint32_t
+LoraColumnarTable::AddColumn (std::string name, ColumnType type)
+{
+  NS_ASSERT (name.size () < COLUMNAR_NAME_LENGTH);
+  NS_ASSERT_MSG (GetNRows () == 0, "Columns must be defined before appending rows");
+  Column column;
+  column.name = name;
+  column.type = type;
+  m_columns.push_back (column);
+  return m_columns.size () - 1;
+}
+
+void
+LoraColumnarTable::Reserve (uint64_t rows)
+{
+  for (uint32_t c = 0; c < m_columns.size (); c++)
+    {
+      m_columns[c].data.reserve (rows * GetElementSize (m_columns[c].type));
+    }
+}
+
+void
+LoraColumnarTable::AppendLabel (uint32_t column, const std::string &label)
+{
+  NS_ASSERT (column < m_columns.size () && m_columns[column].type == LABEL);
+  char value[4] = { 0, 0, 0, 0 };
+  std::strncpy (value, label.c_str (), 4);
+  m_columns[column].data.insert (m_columns[column].data.end (), value, value + 4);
+}
+
+void
+LoraColumnarTable::AppendUint (uint32_t column, uint32_t value)
+{
+  NS_ASSERT (column < m_columns.size () && m_columns[column].type == UINT32);
+  const char *bytes = reinterpret_cast<const char *> (&value);
+  m_columns[column].data.insert (m_columns[column].data.end (), bytes, bytes + sizeof (value));
+}
+
+void
+LoraColumnarTable::AppendDouble (uint32_t column, double value)
+{
+  NS_ASSERT (column < m_columns.size () && m_columns[column].type == DOUBLE);
+  const char *bytes = reinterpret_cast<const char *> (&value);
+  m_columns[column].data.insert (m_columns[column].data.end (), bytes, bytes + sizeof (value));
+}
+
+uint32_t
+LoraColumnarTable::GetNColumns (void) const
+{
+  return m_columns.size ();
+}
+
+uint64_t
+LoraColumnarTable::GetNRows (void) const
+{
+  if (m_columns.empty ())
+    {
+      return 0;
+    }
+  return m_columns[0].data.size () / GetElementSize (m_columns[0].type);
+}
+
+std::string
+LoraColumnarTable::GetColumnName (uint32_t column) const
+{
+  NS_ASSERT (column < m_columns.size ());
+  return m_columns[column].name;
+}
+
+LoraColumnarTable::ColumnType
+LoraColumnarTable::GetColumnType (uint32_t column) const
+{
+  NS_ASSERT (column < m_columns.size ());
+  return m_columns[column].type;
+}
+
+void
+LoraColumnarTable::WriteBinary (std::string fileName) const
+{
+  uint64_t nRows = GetNRows ();
+  std::ofstream file (fileName.c_str (), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+  NS_ASSERT (file.is_open () == true);
+
+  FileHeader header;
+  std::memset (&header, 0, sizeof (header));
+  std::memcpy (header.magic, COLUMNAR_MAGIC, 8);
+  header.version = COLUMNAR_VERSION;
+  header.nColumns = m_columns.size ();
+  header.nRows = nRows;
+
+  //Schema with aligned column offsets
+  std::vector<SchemaEntry> schema (m_columns.size ());
+  uint64_t offset = Align (sizeof (FileHeader) + m_columns.size () * sizeof (SchemaEntry));
+  for (uint32_t c = 0; c < m_columns.size (); c++)
+    {
+      NS_ASSERT_MSG (m_columns[c].data.size () == nRows * GetElementSize (m_columns[c].type),
+                     "Column " << m_columns[c].name << " has a different number of rows");
+      std::memset (&schema[c], 0, sizeof (SchemaEntry));
+      std::strncpy (schema[c].name, m_columns[c].name.c_str (), COLUMNAR_NAME_LENGTH - 1);
+      schema[c].type = m_columns[c].type;
+      schema[c].elementSize = GetElementSize (m_columns[c].type);
+      schema[c].offset = offset;
+      offset = Align (offset + m_columns[c].data.size ());
+    }
+
+  file.write (reinterpret_cast<const char *> (&header), sizeof (header));
+  if (!schema.empty ())
+    {
+      file.write (reinterpret_cast<const char *> (&schema[0]), schema.size () * sizeof (SchemaEntry));
+    }
+
+  //One contiguous write per column
+  static const char zeros[COLUMNAR_ALIGN] = { 0 };
+  uint64_t position = sizeof (FileHeader) + schema.size () * sizeof (SchemaEntry);
+  for (uint32_t c = 0; c < m_columns.size (); c++)
+    {
+      file.write (zeros, schema[c].offset - position);
+      if (!m_columns[c].data.empty ())
+        {
+          file.write (&m_columns[c].data[0], m_columns[c].data.size ());
+        }
+      position = schema[c].offset + m_columns[c].data.size ();
+    }
+  NS_LOG_DEBUG ("Columnar file " << fileName << ": " << nRows << " rows, " << m_columns.size () << " columns");
+}
+
+void
+LoraColumnarTable::WriteText (std::string fileName) const
+{
+  uint64_t nRows = GetNRows ();
+  std::ofstream file (fileName.c_str (), std::ios_base::out | std::ios_base::trunc);
+  NS_ASSERT (file.is_open () == true);
+
+  //Print column info
+  file << "#";
+  for (uint32_t c = 0; c < m_columns.size (); c++)
+    {
+      file << m_columns[c].name << " ";
+    }
+  file << "\n";
+
+  //Rows are buffered by the stream, no flush per row. Absent values at
+  //the end of a row are left out (same lines as before the columnar
+  //table), elsewhere they are written as "nan" to keep the column order
+  for (uint64_t row = 0; row < nRows; row++)
+    {
+      uint32_t nPresent = m_columns.size ();
+      while (nPresent > 0 && IsAbsent (m_columns[nPresent - 1], row))
+        {
+          nPresent--;
+        }
+      for (uint32_t c = 0; c < nPresent; c++)
+        {
+          const char *value = &m_columns[c].data[row * GetElementSize (m_columns[c].type)];
+          if (IsAbsent (m_columns[c], row))
+            {
+              file << "nan ";
+              continue;
+            }
+          switch (m_columns[c].type)
+            {
+            case LABEL:
+              file << std::string (value, strnlen (value, 4)) << " ";
+              break;
+            case UINT32:
+              {
+                uint32_t v;
+                std::memcpy (&v, value, sizeof (v));
+                file << v << " ";
+                break;
+              }
+            case DOUBLE:
+              {
+                double v;
+                std::memcpy (&v, value, sizeof (v));
+                file << v << " ";
+                break;
+              }
+            }
+        }
+      file << "\n";
+    }
+  file.flush ();
+}
+
+void
+LoraColumnarTable::ReadBinary (std::string fileName)
+{
+  std::ifstream file (fileName.c_str (), std::ios_base::in | std::ios_base::binary);
+  if (!file.is_open ())
+    {
+      NS_FATAL_ERROR ("Cannot open columnar file " << fileName);
+    }
+  FileHeader header;
+  std::vector<SchemaEntry> schema;
+  ReadSchema (file, fileName, header, schema);
+
+  m_columns.clear ();
+  for (uint32_t c = 0; c < schema.size (); c++)
+    {
+      Column column;
+      column.name = std::string (schema[c].name, strnlen (schema[c].name, COLUMNAR_NAME_LENGTH));
+      column.type = static_cast<ColumnType> (schema[c].type);
+      NS_ASSERT (schema[c].elementSize == GetElementSize (column.type));
+      column.data.resize (header.nRows * schema[c].elementSize);
+      file.seekg (schema[c].offset);
+      if (!column.data.empty () && !file.read (&column.data[0], column.data.size ()))
+        {
+          NS_FATAL_ERROR ("Truncated column " << column.name << " in " << fileName);
+        }
+      m_columns.push_back (column);
+    }
+}
+
+std::vector<double>
+LoraColumnarTable::ReadColumn (std::string fileName, std::string name)
+{
+  std::ifstream file (fileName.c_str (), std::ios_base::in | std::ios_base::binary);
+  if (!file.is_open ())
+    {
+      NS_FATAL_ERROR ("Cannot open columnar file " << fileName);
+    }
+  FileHeader header;
+  std::vector<SchemaEntry> schema;
+  ReadSchema (file, fileName, header, schema);
+
+  std::vector<double> values;
+  for (uint32_t c = 0; c < schema.size (); c++)
+    {
+      if (name != std::string (schema[c].name, strnlen (schema[c].name, COLUMNAR_NAME_LENGTH)))
+        {
+          continue;
+        }
+      //Seek straight to the column
+      file.seekg (schema[c].offset);
+      values.resize (header.nRows);
+      if (schema[c].type == DOUBLE)
+        {
+          if (header.nRows > 0 && !file.read (reinterpret_cast<char *> (&values[0]), header.nRows * sizeof (double)))
+            {
+              NS_FATAL_ERROR ("Truncated column " << name << " in " << fileName);
+            }
+        }
+      else if (schema[c].type == UINT32)
+        {
+          std::vector<uint32_t> raw (header.nRows);
+          if (header.nRows > 0 && !file.read (reinterpret_cast<char *> (&raw[0]), header.nRows * sizeof (uint32_t)))
+            {
+              NS_FATAL_ERROR ("Truncated column " << name << " in " << fileName);
+            }
+          for (uint64_t row = 0; row < header.nRows; row++)
+            {
+              values[row] = raw[row] == ABSENT_UINT ? std::numeric_limits<double>::quiet_NaN () : raw[row];
+            }
+        }
+      else
+        {
+          NS_FATAL_ERROR ("Column " << name << " is not numeric");
+        }
+      return values;
+    }
+  NS_FATAL_ERROR ("Column " << name << " not found in " << fileName);
+  return values;
+}
+
+void
+LoraColumnarTable::BinaryToText (std::string binaryName, std::string textName)
+{
+  LoraColumnarTable table;
+  table.ReadBinary (binaryName);
+  table.WriteText (textName);
+}
+
+} // namespace ns3
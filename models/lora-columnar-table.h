@@ -0,0 +1,105 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#ifndef LORA_COLUMNAR_TABLE_H
+#define LORA_COLUMNAR_TABLE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup energy
+ *
+ * \brief Typed column store for node and energy reports
+ *
+ * The same table is written either as today's space separated text or as
+ * a columnar binary file. Binary layout (host byte order, little endian on
+ * all supported platforms), every block aligned to 64 bytes so the file
+ * can be memory mapped:
+ *
+ *   header  : char magic[8] = "LORACOL1", uint32 version, uint32 nColumns,
+ *             uint64 nRows, padding to 64 bytes
+ *   schema  : nColumns entries of 64 bytes: char name[48], uint32 type,
+ *             uint32 elementSize, uint64 offset of the column data
+ *   columns : nRows contiguous values per column
+ *
+ * Absent fields (e.g. energy of a gateway) are stored as NaN or as
+ * ABSENT_UINT. In text they are left out at the end of a row and written
+ * as "nan" elsewhere, so fields keep their column index.
+ */
+class LoraColumnarTable
+{
+public:
+  enum ColumnType
+  {
+    LABEL  = 1,   //Up to 4 characters
+    UINT32 = 2,
+    DOUBLE = 3
+  };
+
+  static const uint32_t ABSENT_UINT = 0xFFFFFFFF;
+
+  LoraColumnarTable ();
+  ~LoraColumnarTable ();
+
+  //Define columns, return column index
+  uint32_t AddColumn (std::string name, ColumnType type);
+  void Reserve (uint64_t rows);
+
+  //Append a value at the end of a column
+  void AppendLabel (uint32_t column, const std::string &label);
+  void AppendUint (uint32_t column, uint32_t value);
+  void AppendDouble (uint32_t column, double value);
+
+  uint32_t GetNColumns (void) const;
+  uint64_t GetNRows (void) const;
+  std::string GetColumnName (uint32_t column) const;
+  ColumnType GetColumnType (uint32_t column) const;
+
+  void WriteBinary (std::string fileName) const;
+  void WriteText (std::string fileName) const;
+  //Load a whole binary file
+  void ReadBinary (std::string fileName);
+
+  //Read one column of a binary file without reading the others
+  //(UINT32 columns are converted, absent values become NaN)
+  static std::vector<double> ReadColumn (std::string fileName, std::string name);
+  //Convert a binary file to the text report
+  static void BinaryToText (std::string binaryName, std::string textName);
+
+private:
+  struct Column
+  {
+    std::string name;
+    ColumnType type;
+    std::vector<char> data;
+  };
+
+  static uint32_t GetElementSize (ColumnType type);
+  //NaN double or ABSENT_UINT value
+  static bool IsAbsent (const Column &column, uint64_t row);
+
+  std::vector<Column> m_columns;
+};
+
+} // namespace ns3
+
+#endif /* LORA_COLUMNAR_TABLE_H */
@@ -75,11 +75,11 @@ InterpolatedLoraConsumptionModel::CalcTxCurrent (double power_dBm) const
 {
   NS_LOG_FUNCTION (this << power_dBm);
   //Collect data from datasheet
-  std::vector<double> power_dBm_lookup_table =      {7.0, 13.0, 17.0, 20.0 };
-  std::vector<double> curruent_ma_lookup_table =   {18.0, 28.0, 90.0, 125.0};
+  static const double power_dBm_lookup_table[] =    {7.0, 13.0, 17.0, 20.0 };
+  static const double curruent_ma_lookup_table[] =  {18.0, 28.0, 90.0, 125.0};
 
   //Size of look up table elements
-  int n_elements = power_dBm_lookup_table.size();
+  const int n_elements = sizeof (power_dBm_lookup_table) / sizeof (power_dBm_lookup_table[0]);
 
   //values which limits the value to be interpolated
   double current_ma_L, current_ma_R, power_dBm_L, power_dBm_R;
@@ -87,12 +87,21 @@ InterpolatedLoraConsumptionModel::CalcTxCurrent (double power_dBm) const
   //value of current result of interpolation
   double current_ma_interpolated;
 
-  //Index
+  //Outside the datasheet range the current of the nearest edge is used
+  if (power_dBm <= power_dBm_lookup_table[0] || power_dBm >= power_dBm_lookup_table[n_elements - 1])
+    {
+      int edge = power_dBm <= power_dBm_lookup_table[0] ? 0 : n_elements - 1;
+      if (power_dBm != power_dBm_lookup_table[edge])
+        {
+          NS_LOG_WARN ("Input Power: " << power_dBm << " dBm out of table, current clamped to "
+                       << curruent_ma_lookup_table[edge] << " mA");
+        }
+      return curruent_ma_lookup_table[edge] / 1000;
+    }
+
+  //Index of the segment holding the power, the last one at most
   int index = 0;
-
-  NS_ASSERT ( power_dBm < power_dBm_lookup_table[n_elements - 1] || power_dBm  > power_dBm_lookup_table[0] );
-
-  while ( power_dBm >power_dBm_lookup_table[index +1] )
+  while (power_dBm > power_dBm_lookup_table[index + 1])
   {
     index++;
   }
@@ -50,11 +50,9 @@ public:
   InterpolatedLoraConsumptionModel ();
   virtual ~InterpolatedLoraConsumptionModel ();
 
+  //Linear interpolation of the datasheet table (7 to 20 dBm), clamped to
+  //the edge currents outside it
   double CalcTxCurrent (double txPowerDbm) const;
-
-
-private:
-  double m_txCurrent;
 };
 
 } // namespace ns3
@@ -0,0 +1,108 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#ifndef LORA_COUNTER_RNG_H
+#define LORA_COUNTER_RNG_H
+
+#include <stdint.h>
+#include <cmath>
+
+namespace ns3 {
+
+/**
+ * \ingroup energy
+ *
+ * \brief Counter-based random generator (Philox4x32-10)
+ *
+ * Every variate is a pure function of (seed, stream, index), so results do
+ * not depend on the order in which streams are queried and no state is
+ * taken from the global RngSeedManager. The stream is usually the node id.
+ */
+class LoraCounterRng
+{
+public:
+  LoraCounterRng (uint64_t seed, uint32_t stream)
+  {
+    m_key[0] = stream;
+    m_key[1] = static_cast<uint32_t> (seed);
+    m_seedHi = static_cast<uint32_t> (seed >> 32);
+  }
+
+  //Four 32-bit random words for the given counter value
+  void Generate (uint64_t counter, uint32_t words[4]) const
+  {
+    uint32_t ctr[4] = { static_cast<uint32_t> (counter),
+                        static_cast<uint32_t> (counter >> 32),
+                        m_seedHi,
+                        0 };
+    uint32_t key[2] = { m_key[0], m_key[1] };
+
+    for (int round = 0; round < 10; round++)
+      {
+        uint64_t p0 = static_cast<uint64_t> (0xD2511F53) * ctr[0];
+        uint64_t p1 = static_cast<uint64_t> (0xCD9E8D57) * ctr[2];
+        uint32_t next[4] = { static_cast<uint32_t> (p1 >> 32) ^ ctr[1] ^ key[0],
+                             static_cast<uint32_t> (p1),
+                             static_cast<uint32_t> (p0 >> 32) ^ ctr[3] ^ key[1],
+                             static_cast<uint32_t> (p0) };
+        ctr[0] = next[0];
+        ctr[1] = next[1];
+        ctr[2] = next[2];
+        ctr[3] = next[3];
+        key[0] += 0x9E3779B9;
+        key[1] += 0xBB67AE85;
+      }
+
+    words[0] = ctr[0];
+    words[1] = ctr[1];
+    words[2] = ctr[2];
+    words[3] = ctr[3];
+  }
+
+  //Uniform variate in (0,1) for the given draw index
+  double GetUniform (uint64_t index) const
+  {
+    uint32_t words[4];
+    Generate (index, words);
+    return ToUnit (words[0]);
+  }
+
+  //Standard normal variate for the given draw index (Box-Muller)
+  double GetNormal (uint64_t index) const
+  {
+    uint32_t words[4];
+    Generate (index, words);
+    double u1 = ToUnit (words[0]);
+    double u2 = ToUnit (words[1]);
+    return std::sqrt (-2.0 * std::log (u1)) * std::cos (2.0 * M_PI * u2);
+  }
+
+private:
+  //Map a 32-bit word to the open interval (0,1)
+  static double ToUnit (uint32_t word)
+  {
+    return (static_cast<double> (word) + 0.5) / 4294967296.0;
+  }
+
+  uint32_t m_key[2];
+  uint32_t m_seedHi;
+};
+
+} //namespace ns3
+
+#endif /* LORA_COUNTER_RNG_H */
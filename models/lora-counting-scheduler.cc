@@ -0,0 +1,95 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#include "lora-counting-scheduler.h"
+#include "ns3/log.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LoraCountingScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED (LoraCountingScheduler);
+
+std::atomic<bool> LoraCountingScheduler::s_installed (false);
+std::atomic<uint64_t> LoraCountingScheduler::s_pending (0);
+std::atomic<uint64_t> LoraCountingScheduler::s_inserted (0);
+
+TypeId
+LoraCountingScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LoraCountingScheduler")
+    .SetParent<MapScheduler> ()
+    .SetGroupName ("Energy")
+    .AddConstructor<LoraCountingScheduler> ()
+  ;
+  return tid;
+}
+
+LoraCountingScheduler::LoraCountingScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+  s_installed.store (true, std::memory_order_relaxed);
+}
+
+LoraCountingScheduler::~LoraCountingScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+LoraCountingScheduler::Insert (const Event &ev)
+{
+  MapScheduler::Insert (ev);
+  //Single writer (the simulation thread), relaxed is enough for readers
+  s_pending.store (s_pending.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  s_inserted.store (s_inserted.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+Scheduler::Event
+LoraCountingScheduler::RemoveNext (void)
+{
+  s_pending.store (s_pending.load (std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+  return MapScheduler::RemoveNext ();
+}
+
+void
+LoraCountingScheduler::Remove (const Event &ev)
+{
+  s_pending.store (s_pending.load (std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+  MapScheduler::Remove (ev);
+}
+
+bool
+LoraCountingScheduler::IsInstalled (void)
+{
+  return s_installed.load (std::memory_order_relaxed);
+}
+
+uint64_t
+LoraCountingScheduler::GetPendingEvents (void)
+{
+  return s_pending.load (std::memory_order_relaxed);
+}
+
+uint64_t
+LoraCountingScheduler::GetInsertedEvents (void)
+{
+  return s_inserted.load (std::memory_order_relaxed);
+}
+
+} // namespace ns3
@@ -0,0 +1,63 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#ifndef LORA_COUNTING_SCHEDULER_H
+#define LORA_COUNTING_SCHEDULER_H
+
+#include "ns3/map-scheduler.h"
+#include <stdint.h>
+#include <atomic>
+
+namespace ns3 {
+
+/**
+ * \ingroup energy
+ *
+ * \brief Map scheduler that keeps the number of pending events
+ *
+ * ns-3 does not expose the size of the event queue. Installed with
+ * Simulator::SetScheduler (ObjectFactory ("ns3::LoraCountingScheduler")),
+ * it counts insertions and removals in atomics that other threads (metrics,
+ * progress) may read. Cancelled events stay pending until they are popped,
+ * as in the underlying queue.
+ */
+class LoraCountingScheduler : public MapScheduler
+{
+public:
+  static TypeId GetTypeId (void);
+  LoraCountingScheduler ();
+  virtual ~LoraCountingScheduler ();
+
+  virtual void Insert (const Event &ev);
+  virtual Event RemoveNext (void);
+  virtual void Remove (const Event &ev);
+
+  //True once an instance has been created
+  static bool IsInstalled (void);
+  static uint64_t GetPendingEvents (void);
+  static uint64_t GetInsertedEvents (void);
+
+private:
+  static std::atomic<bool> s_installed;
+  static std::atomic<uint64_t> s_pending;
+  static std::atomic<uint64_t> s_inserted;
+};
+
+} // namespace ns3
+
+#endif /* LORA_COUNTING_SCHEDULER_H */
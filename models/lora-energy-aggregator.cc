@@ -0,0 +1,229 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#include "lora-energy-aggregator.h"
+#include "ns3/log.h"
+#include "ns3/double.h"
+#include "ns3/mobility-model.h"
+#include "ns3/mobility-building-info.h"
+#include <fstream>
+#include <sstream>
+
+#define MIN_SF      7
+#define MAX_SF     12
+#define OUTDOOR     0
+#define INDOOR      1
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LoraEnergyAggregator");
+
+NS_OBJECT_ENSURE_REGISTERED (LoraEnergyAggregator);
+
+TypeId
+LoraEnergyAggregator::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LoraEnergyAggregator")
+    .SetParent<Object> ()
+    .SetGroupName ("Energy")
+    .AddConstructor<LoraEnergyAggregator> ()
+    .AddAttribute ("Compression",
+                   "t-digest compression, higher is more accurate and uses more memory.",
+                   DoubleValue (100),
+                   MakeDoubleAccessor (&LoraEnergyAggregator::m_compression),
+                   MakeDoubleChecker<double> (20))
+  ;
+  return tid;
+}
+
+LoraEnergyAggregator::LoraEnergyAggregator ()
+  : m_compression (100)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+LoraEnergyAggregator::~LoraEnergyAggregator ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+LoraEnergyAggregator::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_bySf.clear ();
+  m_byPlacement.clear ();
+  m_byGateway.clear ();
+  Object::DoDispose ();
+}
+
+void
+LoraEnergyAggregator::SetGateways (NodeContainer gateways)
+{
+  NS_LOG_FUNCTION (this);
+  m_gatewayPositions.clear ();
+  m_gatewayIds.clear ();
+  for (NodeContainer::Iterator i = gateways.Begin (); i != gateways.End (); ++i)
+    {
+      Ptr<MobilityModel> mobility = (*i)->GetObject<MobilityModel> ();
+      NS_ASSERT (mobility != NULL);
+      m_gatewayPositions.push_back (mobility->GetPosition ());
+      m_gatewayIds.push_back ((*i)->GetId ());
+    }
+  Reset ();
+}
+
+void
+LoraEnergyAggregator::Reset (void)
+{
+  NS_LOG_FUNCTION (this);
+  //Groups are rebuilt so the Compression attribute is honoured
+  Group empty;
+  empty.digest = LoraTDigest (m_compression);
+  m_all = empty;
+  m_bySf.assign (MAX_SF - MIN_SF + 1, empty);
+  m_byPlacement.assign (2, empty);
+  m_byGateway.assign (m_gatewayPositions.size (), empty);
+}
+
+void
+LoraEnergyAggregator::AddToGroup (Group &group, double energyJ)
+{
+  group.stats.Add (energyJ);
+  group.digest.Add (energyJ);
+}
+
+void
+LoraEnergyAggregator::Add (uint8_t spreadingFactor, bool indoor, uint32_t gateway, double energyJ)
+{
+  if (m_bySf.empty ())
+    {
+      Reset ();
+    }
+  NS_ASSERT (spreadingFactor >= MIN_SF && spreadingFactor <= MAX_SF);
+  AddToGroup (m_all, energyJ);
+  AddToGroup (m_bySf[spreadingFactor - MIN_SF], energyJ);
+  AddToGroup (m_byPlacement[indoor ? INDOOR : OUTDOOR], energyJ);
+  if (gateway < m_byGateway.size ())
+    {
+      AddToGroup (m_byGateway[gateway], energyJ);
+    }
+}
+
+uint32_t
+LoraEnergyAggregator::GetNearestGateway (const Vector &position) const
+{
+  uint32_t nearest = m_gatewayPositions.size ();
+  double best = 0;
+  for (uint32_t g = 0; g < m_gatewayPositions.size (); g++)
+    {
+      double distance = CalculateDistance (position, m_gatewayPositions[g]);
+      if (g == 0 || distance < best)
+        {
+          best = distance;
+          nearest = g;
+        }
+    }
+  return nearest;
+}
+
+void
+LoraEnergyAggregator::Collect (Ptr<LoraEnergyMonitor> monitor)
+{
+  NS_LOG_FUNCTION (this << monitor);
+  for (LoraEnergyMonitor::Iterator i = monitor->Begin (); i != monitor->End (); ++i)
+    {
+      NS_ASSERT (i->mac != NULL);
+      uint8_t spreadingFactor = i->mac->GetSfFromDataRate (i->mac->GetDataRate ());
+
+      //Placement, outdoor if the buildings module is not installed
+      bool indoor = false;
+      uint32_t gateway = m_gatewayPositions.size ();
+      if (i->mobility != NULL)
+        {
+          Ptr<MobilityBuildingInfo> buildingInfo = i->mobility->GetObject<MobilityBuildingInfo> ();
+          indoor = buildingInfo != NULL && buildingInfo->IsIndoor ();
+          gateway = GetNearestGateway (i->mobility->GetPosition ());
+        }
+
+      Add (spreadingFactor, indoor, gateway, i->model->GetTotalEnergyConsumption ());
+    }
+}
+
+void
+LoraEnergyAggregator::ReportGroup (std::ostream &os, std::string group, std::string key, Group &g)
+{
+  if (g.stats.GetCount () == 0)
+    {
+      return;
+    }
+  os << group                        << " "
+     << key                          << " "
+     << g.stats.GetCount ()          << " "
+     << g.stats.GetMean ()           << " "
+     << g.stats.GetStdDev ()         << " "
+     << g.stats.GetMin ()            << " "
+     << g.stats.GetMax ()            << " "
+     << g.digest.GetQuantile (0.50)  << " "
+     << g.digest.GetQuantile (0.90)  << " "
+     << g.digest.GetQuantile (0.99)  << " "
+     << "\n";
+}
+
+void
+LoraEnergyAggregator::Report (std::string fileName)
+{
+  NS_LOG_FUNCTION (this << fileName);
+  if (m_bySf.empty ())
+    {
+      Reset ();
+    }
+  std::ofstream file (fileName.c_str (), std::ios_base::out | std::ios_base::trunc);
+  NS_ASSERT (file.is_open () == true);
+
+  //Print column info
+  file << "#group"            << " "
+       << "key"               << " "
+       << "count"             << " "
+       << "meanConsumedJ"     << " "
+       << "stdDevConsumedJ"   << " "
+       << "minConsumedJ"      << " "
+       << "maxConsumedJ"      << " "
+       << "p50ConsumedJ"      << " "
+       << "p90ConsumedJ"      << " "
+       << "p99ConsumedJ"      << " "
+       << "\n";
+
+  ReportGroup (file, "ALL", "-", m_all);
+  for (uint32_t sf = MIN_SF; sf <= MAX_SF; sf++)
+    {
+      std::ostringstream key;
+      key << sf;
+      ReportGroup (file, "SF", key.str (), m_bySf[sf - MIN_SF]);
+    }
+  ReportGroup (file, "PLACEMENT", "outdoor", m_byPlacement[OUTDOOR]);
+  ReportGroup (file, "PLACEMENT", "indoor", m_byPlacement[INDOOR]);
+  for (uint32_t g = 0; g < m_byGateway.size (); g++)
+    {
+      std::ostringstream key;
+      key << m_gatewayIds[g];
+      ReportGroup (file, "GW", key.str (), m_byGateway[g]);
+    }
+}
+
+} // namespace ns3
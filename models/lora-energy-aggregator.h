@@ -0,0 +1,86 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#ifndef LORA_ENERGY_AGGREGATOR_H
+#define LORA_ENERGY_AGGREGATOR_H
+
+#include "ns3/object.h"
+#include "ns3/vector.h"
+#include "ns3/node-container.h"
+#include "ns3/lora-energy-monitor.h"
+#include "ns3/lora-streaming-stats.h"
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup energy
+ *
+ * \brief Online aggregates of consumed energy per SF, placement and gateway
+ *
+ * Each group keeps a Welford accumulator (mean, variance, min, max) and a
+ * t-digest (percentiles). Groups are SF7..SF12, indoor/outdoor (from the
+ * MobilityBuildingInfo of the node) and nearest gateway, plus the whole
+ * fleet. Memory depends on the number of gateways and the compression,
+ * not on the number of devices, so nodes never need to be dumped.
+ */
+class LoraEnergyAggregator : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+  LoraEnergyAggregator ();
+  virtual ~LoraEnergyAggregator ();
+
+  //Gateways used to find the nearest one, set before adding samples
+  void SetGateways (NodeContainer gateways);
+
+  //Add one sample, gateway is an index in the gateway container
+  void Add (uint8_t spreadingFactor, bool indoor, uint32_t gateway, double energyJ);
+  //Add the consumed energy of every device of the monitor in one pass
+  void Collect (Ptr<LoraEnergyMonitor> monitor);
+  //Drop all samples, keep the gateways
+  void Reset (void);
+
+  //One row per non-empty group: count, mean, std dev, min, max, percentiles
+  void Report (std::string fileName);
+
+private:
+  struct Group
+  {
+    LoraRunningStats stats;
+    LoraTDigest digest;
+  };
+
+  void DoDispose (void);
+  void AddToGroup (Group &group, double energyJ);
+  uint32_t GetNearestGateway (const Vector &position) const;
+  void ReportGroup (std::ostream &os, std::string group, std::string key, Group &g);
+
+  double m_compression;
+  std::vector<Vector> m_gatewayPositions;
+  std::vector<uint32_t> m_gatewayIds;
+
+  Group m_all;
+  std::vector<Group> m_bySf;
+  std::vector<Group> m_byPlacement;
+  std::vector<Group> m_byGateway;
+};
+
+} // namespace ns3
+
+#endif /* LORA_ENERGY_AGGREGATOR_H */
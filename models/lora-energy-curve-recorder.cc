@@ -0,0 +1,285 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#include "lora-energy-curve-recorder.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+//Lowest tolerance used when compacting, relative to the energy range of
+//the curve and absolute (J)
+#define COMPACT_RELATIVE_FLOOR  1e-6
+#define COMPACT_ABSOLUTE_FLOOR  1e-12
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LoraEnergyCurveRecorder");
+
+NS_OBJECT_ENSURE_REGISTERED (LoraEnergyCurveRecorder);
+
+TypeId
+LoraEnergyCurveRecorder::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LoraEnergyCurveRecorder")
+    .SetParent<Object> ()
+    .SetGroupName ("Energy")
+    .AddConstructor<LoraEnergyCurveRecorder> ()
+    .AddAttribute ("MaxPoints",
+                   "Maximum number of vertices kept per node.",
+                   UintegerValue (256),
+                   MakeUintegerAccessor (&LoraEnergyCurveRecorder::m_maxPoints),
+                   MakeUintegerChecker<uint32_t> (4))
+    .AddAttribute ("Tolerance",
+                   "Initial maximum distance (J) between curve and samples.",
+                   DoubleValue (1e-3),
+                   MakeDoubleAccessor (&LoraEnergyCurveRecorder::m_tolerance),
+                   MakeDoubleChecker<double> (0))
+  ;
+  return tid;
+}
+
+LoraEnergyCurveRecorder::LoraEnergyCurveRecorder ()
+  : m_maxPoints (256),
+    m_tolerance (1e-3)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+LoraEnergyCurveRecorder::~LoraEnergyCurveRecorder ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+LoraEnergyCurveRecorder::ForwardWithNodeId (LoraEnergyCurveRecorder *recorder, uint32_t nodeId,
+                                            double oldValue, double newValue)
+{
+  recorder->RecordRemainingEnergy (nodeId, oldValue, newValue);
+}
+
+void
+LoraEnergyCurveRecorder::Install (Ptr<LoraEnergyMonitor> monitor)
+{
+  NS_LOG_FUNCTION (this << monitor);
+  for (LoraEnergyMonitor::Iterator i = monitor->Begin (); i != monitor->End (); ++i)
+    {
+      uint32_t nodeId = i->node->GetId ();
+      Add (nodeId, Simulator::Now ().GetSeconds (), i->source->GetRemainingEnergy ());
+      //Raw pointer, the recorder must outlive the simulation like the monitor
+      i->source->ConnectRemainingEnergy (MakeBoundCallback (&LoraEnergyCurveRecorder::ForwardWithNodeId,
+                                                            this, nodeId));
+    }
+}
+
+void
+LoraEnergyCurveRecorder::RecordRemainingEnergy (uint32_t nodeId, double oldValue, double newValue)
+{
+  Add (nodeId, Simulator::Now ().GetSeconds (), newValue);
+}
+
+void
+LoraEnergyCurveRecorder::Add (uint32_t nodeId, double timeS, double energyJ)
+{
+  if (nodeId >= m_curves.size ())
+    {
+      m_curves.resize (nodeId + 1);
+    }
+  Curve &curve = m_curves[nodeId];
+  if (curve.vertices.empty ())
+    {
+      curve.tolerance = m_tolerance;
+      curve.errorBound = m_tolerance;
+    }
+  Point sample = { timeS, energyJ };
+  Simplify (curve, sample);
+  if (curve.vertices.size () >= m_maxPoints)
+    {
+      Compact (curve);
+    }
+}
+
+void
+LoraEnergyCurveRecorder::Simplify (Curve &curve, const Point &sample)
+{
+  if (curve.vertices.empty ())
+    {
+      curve.vertices.push_back (sample);
+      curve.pending = false;
+      return;
+    }
+
+  const Point &anchor = curve.vertices.back ();
+  double dt = sample.timeS - anchor.timeS;
+  if (dt <= 0)
+    {
+      //Step at the anchor time, kept as a vertical segment
+      if (!curve.pending && std::abs (sample.energyJ - anchor.energyJ) > curve.tolerance)
+        {
+          curve.vertices.push_back (sample);
+        }
+      return;
+    }
+
+  double low = (sample.energyJ - curve.tolerance - anchor.energyJ) / dt;
+  double high = (sample.energyJ + curve.tolerance - anchor.energyJ) / dt;
+  if (!curve.pending)
+    {
+      curve.slopeLow = low;
+      curve.slopeHigh = high;
+      curve.last = sample;
+      curve.pending = true;
+      return;
+    }
+
+  low = std::max (low, curve.slopeLow);
+  high = std::min (high, curve.slopeHigh);
+  if (low <= high)
+    {
+      //Door still open, extend the segment
+      curve.slopeLow = low;
+      curve.slopeHigh = high;
+      curve.last = sample;
+      return;
+    }
+
+  //Door closed: end the segment at the last sample on a line inside the door
+  double dtLast = curve.last.timeS - anchor.timeS;
+  double slope = std::min (curve.slopeHigh,
+                           std::max (curve.slopeLow, (curve.last.energyJ - anchor.energyJ) / dtLast));
+  Point vertex = { curve.last.timeS, anchor.energyJ + slope * dtLast };
+  curve.vertices.push_back (vertex);
+  curve.pending = false;
+  Simplify (curve, sample);
+}
+
+void
+LoraEnergyCurveRecorder::Compact (Curve &curve) const
+{
+  //Close the open segment so no sample is lost
+  std::vector<Point> points = curve.vertices;
+  if (curve.pending)
+    {
+      const Point &anchor = points.back ();
+      double dtLast = curve.last.timeS - anchor.timeS;
+      double slope = std::min (curve.slopeHigh,
+                               std::max (curve.slopeLow, (curve.last.energyJ - anchor.energyJ) / dtLast));
+      Point vertex = { curve.last.timeS, anchor.energyJ + slope * dtLast };
+      points.push_back (vertex);
+    }
+
+  //Doubling starts from a floor relative to the energy range, so it ends
+  //even with Tolerance 0: at a tolerance above the range the curve is a
+  //single segment
+  double low = points[0].energyJ;
+  double high = points[0].energyJ;
+  for (std::size_t p = 1; p < points.size (); p++)
+    {
+      low = std::min (low, points[p].energyJ);
+      high = std::max (high, points[p].energyJ);
+    }
+  double floor = std::max ((high - low) * COMPACT_RELATIVE_FLOOR, COMPACT_ABSOLUTE_FLOOR);
+
+  //Coarser tolerance until half the budget is free (amortised)
+  Curve coarse;
+  coarse.tolerance = std::max (curve.tolerance, floor / 2);
+  coarse.errorBound = curve.errorBound;
+  do
+    {
+      double tolerance = coarse.tolerance * 2;
+      double errorBound = curve.errorBound + tolerance;
+      coarse = Curve ();
+      coarse.tolerance = tolerance;
+      coarse.errorBound = errorBound;
+      for (std::size_t p = 0; p < points.size (); p++)
+        {
+          Simplify (coarse, points[p]);
+        }
+    }
+  while (coarse.vertices.size () > m_maxPoints / 2);
+
+  NS_LOG_DEBUG ("Curve compacted from " << points.size () << " to " << coarse.vertices.size ()
+                << " vertices, tolerance " << coarse.tolerance << " J");
+  curve = coarse;
+}
+
+std::vector<LoraEnergyCurveRecorder::Point>
+LoraEnergyCurveRecorder::GetCurve (uint32_t nodeId) const
+{
+  std::vector<Point> points;
+  if (nodeId >= m_curves.size ())
+    {
+      return points;
+    }
+  const Curve &curve = m_curves[nodeId];
+  points = curve.vertices;
+  if (curve.pending)
+    {
+      const Point &anchor = curve.vertices.back ();
+      double dtLast = curve.last.timeS - anchor.timeS;
+      double slope = std::min (curve.slopeHigh,
+                               std::max (curve.slopeLow, (curve.last.energyJ - anchor.energyJ) / dtLast));
+      Point vertex = { curve.last.timeS, anchor.energyJ + slope * dtLast };
+      points.push_back (vertex);
+    }
+  return points;
+}
+
+double
+LoraEnergyCurveRecorder::GetErrorBound (uint32_t nodeId) const
+{
+  NS_ASSERT (nodeId < m_curves.size ());
+  return m_curves[nodeId].errorBound;
+}
+
+void
+LoraEnergyCurveRecorder::WriteCurves (std::string fileName) const
+{
+  NS_LOG_FUNCTION (this << fileName);
+  std::ofstream file (fileName.c_str (), std::ios_base::out | std::ios_base::trunc);
+  NS_ASSERT (file.is_open () == true);
+
+  //Print column info
+  file << "#nodeId" << " "
+       << "timeS" << " "
+       << "remainingEnergyJ" << " "
+       << "errorBoundJ" << " "
+       << "\n";
+  for (uint32_t nodeId = 0; nodeId < m_curves.size (); nodeId++)
+    {
+      if (m_curves[nodeId].vertices.empty ())
+        {
+          continue;
+        }
+      std::vector<Point> points = GetCurve (nodeId);
+      for (std::size_t p = 0; p < points.size (); p++)
+        {
+          file << nodeId << " "
+               << points[p].timeS << " "
+               << points[p].energyJ << " "
+               << m_curves[nodeId].errorBound << " "
+               << "\n";
+        }
+      file << "\n\n";
+    }
+}
+
+} // namespace ns3
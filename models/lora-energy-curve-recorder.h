@@ -0,0 +1,100 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#ifndef LORA_ENERGY_CURVE_RECORDER_H
+#define LORA_ENERGY_CURVE_RECORDER_H
+
+#include "ns3/object.h"
+#include "ns3/callback.h"
+#include "ns3/lora-energy-monitor.h"
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup energy
+ *
+ * \brief Remaining-energy discharge curve of every node in bounded memory
+ *
+ * Samples of the RemainingEnergy trace are simplified online into a
+ * piecewise-linear curve (swing door): a vertex is only stored when no
+ * single line from the previous vertex stays within Tolerance of all the
+ * samples seen since. If a curve reaches MaxPoints vertices the tolerance
+ * of that node is doubled (starting from a small fraction of the energy
+ * range if Tolerance is 0) and its vertices simplified again, so memory is
+ * bounded by MaxPoints per node whatever the length of the run. The error
+ * bound actually reached is kept per node.
+ */
+class LoraEnergyCurveRecorder : public Object
+{
+public:
+  struct Point
+  {
+    double timeS;
+    double energyJ;
+  };
+
+  static TypeId GetTypeId (void);
+  LoraEnergyCurveRecorder ();
+  virtual ~LoraEnergyCurveRecorder ();
+
+  //Record the current level and connect to RemainingEnergy of every source
+  void Install (Ptr<LoraEnergyMonitor> monitor);
+  //Sink compatible with LoraEnergySourceHelper::ConnectRemainingEnergy
+  void RecordRemainingEnergy (uint32_t nodeId, double oldValue, double newValue);
+  //Add a sample directly
+  void Add (uint32_t nodeId, double timeS, double energyJ);
+
+  //Vertices of a node curve, last sample included
+  std::vector<Point> GetCurve (uint32_t nodeId) const;
+  //Maximum distance between the curve and the recorded samples
+  double GetErrorBound (uint32_t nodeId) const;
+
+  //Curves of every node, blank lines between nodes (gnuplot index)
+  void WriteCurves (std::string fileName) const;
+
+private:
+  struct Curve
+  {
+    Curve () : tolerance (0), errorBound (0), slopeLow (0), slopeHigh (0), pending (false)
+    {
+    }
+    std::vector<Point> vertices;
+    double tolerance;
+    double errorBound;
+    //Swing door of the open segment, starting at vertices.back ()
+    double slopeLow;
+    double slopeHigh;
+    Point last;
+    bool pending;
+  };
+
+  static void ForwardWithNodeId (LoraEnergyCurveRecorder *recorder, uint32_t nodeId,
+                                 double oldValue, double newValue);
+  static void Simplify (Curve &curve, const Point &sample);
+  void Compact (Curve &curve) const;
+
+  uint32_t m_maxPoints;
+  double m_tolerance;
+  //Curves by node id
+  std::vector<Curve> m_curves;
+};
+
+} // namespace ns3
+
+#endif /* LORA_ENERGY_CURVE_RECORDER_H */
@@ -0,0 +1,271 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#include "lora-energy-invariant-checker.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/simulator.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/lora-counter-rng.h"
+#include "ns3/lora-energy-source.h"
+#include "ns3/lora-radio-energy-model.h"
+#include "ns3/rng-seed-manager.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LoraEnergyInvariantChecker");
+
+NS_OBJECT_ENSURE_REGISTERED (LoraEnergyInvariantChecker);
+
+TypeId
+LoraEnergyInvariantChecker::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LoraEnergyInvariantChecker")
+    .SetParent<Object> ()
+    .SetGroupName ("Energy")
+    .AddConstructor<LoraEnergyInvariantChecker> ()
+    .AddAttribute ("SamplingRatio",
+                   "Fraction of end devices checked, 0 disables the checker.",
+                   DoubleValue (0),
+                   MakeDoubleAccessor (&LoraEnergyInvariantChecker::m_samplingRatio),
+                   MakeDoubleChecker<double> (0, 1))
+    .AddAttribute ("Seed",
+                   "Seed of the node sampling, 0 derives it from the global seed and run.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&LoraEnergyInvariantChecker::m_seed),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Interval",
+                   "Sim-time between checks.",
+                   TimeValue (Seconds (600)),
+                   MakeTimeAccessor (&LoraEnergyInvariantChecker::m_interval),
+                   MakeTimeChecker ())
+    .AddAttribute ("RelativeTolerance",
+                   "Allowed energy mismatch relative to the compared value.",
+                   DoubleValue (1e-9),
+                   MakeDoubleAccessor (&LoraEnergyInvariantChecker::m_relativeTolerance),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("AbsoluteTolerance",
+                   "Allowed energy mismatch in Joules.",
+                   DoubleValue (1e-12),
+                   MakeDoubleAccessor (&LoraEnergyInvariantChecker::m_absoluteTolerance),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("FatalOnViolation",
+                   "Abort the simulation on the first violation.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&LoraEnergyInvariantChecker::m_fatal),
+                   MakeBooleanChecker ())
+  ;
+  return tid;
+}
+
+LoraEnergyInvariantChecker::LoraEnergyInvariantChecker ()
+  : m_samplingRatio (0),
+    m_seed (0),
+    m_interval (Seconds (600)),
+    m_relativeTolerance (1e-9),
+    m_absoluteTolerance (1e-12),
+    m_fatal (false),
+    m_nChecks (0),
+    m_nViolations (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+LoraEnergyInvariantChecker::~LoraEnergyInvariantChecker ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+LoraEnergyInvariantChecker::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_checkEvent.Cancel ();
+  m_samples.clear ();
+  Object::DoDispose ();
+}
+
+bool
+LoraEnergyInvariantChecker::IsSampled (uint32_t nodeId) const
+{
+  uint64_t seed = m_seed;
+  if (seed == 0)
+    {
+      seed = (static_cast<uint64_t> (RngSeedManager::GetSeed ()) << 32) ^ RngSeedManager::GetRun ();
+    }
+  return LoraCounterRng (seed, nodeId).GetUniform (0) < m_samplingRatio;
+}
+
+Time
+LoraEnergyInvariantChecker::GetStateTime (Ptr<LoraRadioEnergyModel> model)
+{
+  return model->GetTotalTxTime () + model->GetTotalRxTime ()
+         + model->GetTotalStandbyTime () + model->GetTotalSleepTime ();
+}
+
+void
+LoraEnergyInvariantChecker::Install (Ptr<LoraEnergyMonitor> monitor)
+{
+  NS_LOG_FUNCTION (this << monitor);
+  NS_ASSERT (m_samples.empty ());
+  if (m_samplingRatio <= 0)
+    {
+      return;
+    }
+  NS_ASSERT (m_interval.IsStrictlyPositive ());
+
+  for (LoraEnergyMonitor::Iterator i = monitor->Begin (); i != monitor->End (); ++i)
+    {
+      uint32_t nodeId = i->node->GetId ();
+      if (!IsSampled (nodeId))
+        {
+          continue;
+        }
+      Sample sample;
+      sample.nodeId = nodeId;
+      sample.model = i->model;
+      sample.source = i->source;
+      //Source first, as in CheckSample
+      sample.remainingJ = i->source->GetRemainingEnergy ();
+      sample.consumedJ = i->model->GetTotalEnergyConsumption ();
+      sample.stateTime = GetStateTime (i->model);
+      sample.stampTime = i->model->GetLastStampTime ();
+      //The source has already drawn the segment pending at Install
+      sample.consumedJ += i->model->GetCurrentA () * i->source->GetSupplyVoltage ()
+        * (Simulator::Now () - sample.stampTime).GetSeconds ();
+      m_samples.push_back (sample);
+    }
+  NS_LOG_INFO ("Checking energy invariants of " << m_samples.size () << " of "
+               << monitor->GetN () << " end devices every " << m_interval.GetSeconds () << " s");
+
+  if (!m_samples.empty ())
+    {
+      m_checkEvent = Simulator::Schedule (m_interval, &LoraEnergyInvariantChecker::Check, this);
+    }
+}
+
+void
+LoraEnergyInvariantChecker::Stop (void)
+{
+  NS_LOG_FUNCTION (this);
+  //Sources are not updated once the run is over, the last periodic check
+  //is then the final one
+  if (m_checkEvent.IsRunning () && !Simulator::IsFinished ())
+    {
+      m_checkEvent.Cancel ();
+      Check ();
+    }
+  m_checkEvent.Cancel ();
+  NS_LOG_INFO ("Energy invariants: " << m_nChecks << " checks, " << m_nViolations << " violations");
+}
+
+uint32_t
+LoraEnergyInvariantChecker::GetNSampledNodes (void) const
+{
+  return m_samples.size ();
+}
+
+uint64_t
+LoraEnergyInvariantChecker::GetNChecks (void) const
+{
+  return m_nChecks;
+}
+
+uint64_t
+LoraEnergyInvariantChecker::GetNViolations (void) const
+{
+  return m_nViolations;
+}
+
+void
+LoraEnergyInvariantChecker::Check (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (uint32_t i = 0; i < m_samples.size (); i++)
+    {
+      CheckSample (m_samples[i]);
+    }
+  m_checkEvent = Simulator::Schedule (m_interval, &LoraEnergyInvariantChecker::Check, this);
+}
+
+bool
+LoraEnergyInvariantChecker::Equal (double a, double b) const
+{
+  return std::fabs (a - b) <= m_absoluteTolerance + m_relativeTolerance * std::max (std::fabs (a), std::fabs (b));
+}
+
+void
+LoraEnergyInvariantChecker::Violation (uint32_t nodeId, std::string what, double value, double expected)
+{
+  m_nViolations++;
+  if (m_fatal)
+    {
+      NS_FATAL_ERROR ("Node " << nodeId << ": " << what << " is " << value << ", expected " << expected);
+    }
+  NS_LOG_WARN ("Node " << nodeId << ": " << what << " is " << value << ", expected " << expected);
+}
+
+void
+LoraEnergyInvariantChecker::CheckSample (const Sample &sample)
+{
+  Ptr<LoraRadioEnergyModel> model = sample.model;
+  m_nChecks++;
+
+  //Read first: the source update may notify the model (depletion,
+  //recharge), the totals and stamp read below then include its effect
+  double remaining = sample.source->GetRemainingEnergy ();
+
+  //Per-state energies add up to the total
+  double total = model->GetTotalEnergyConsumption ();
+  double states = model->GetTxEnergyConsumption () + model->GetRxEnergyConsumption ()
+    + model->GetStandbyEnergyConsumption () + model->GetSleepEnergyConsumption ();
+  if (!Equal (states, total))
+    {
+      Violation (sample.nodeId, "sum of per-state energies (J)", states, total);
+    }
+
+  //Per-state times plus the pending segment add up to the elapsed time
+  Time now = Simulator::Now ();
+  Time stamp = model->GetLastStampTime ();
+  Time accounted = GetStateTime (model) - sample.stateTime + (now - stamp);
+  if (accounted != now - sample.stampTime)
+    {
+      Violation (sample.nodeId, "sum of per-state times (s)", accounted.GetSeconds (),
+                 (now - sample.stampTime).GetSeconds ());
+    }
+
+  //Source drop matches the model, pending segment at the current of its
+  //state; not meaningful once the source has run out
+  if (sample.source->IsDepleted ())
+    {
+      return;
+    }
+  double pending = model->GetCurrentA () * sample.source->GetSupplyVoltage () * (now - stamp).GetSeconds ();
+  double drop = sample.remainingJ - remaining;
+  double consumed = total - sample.consumedJ + pending;
+  if (!Equal (drop, consumed))
+    {
+      Violation (sample.nodeId, "drop of source remaining energy (J)", drop, consumed);
+    }
+}
+
+} // namespace ns3
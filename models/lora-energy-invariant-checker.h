@@ -0,0 +1,103 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#ifndef LORA_ENERGY_INVARIANT_CHECKER_H
+#define LORA_ENERGY_INVARIANT_CHECKER_H
+
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/lora-energy-monitor.h"
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup energy
+ *
+ * \brief Periodic energy-conservation checks on sampled end devices
+ *
+ * Every Interval, for each sampled device (same counter-based draw on the
+ * node id as LoraRadioStateTrace), checks against the values at Install:
+ *
+ *  - TX + RX + STANDBY + SLEEP energy equals the total consumption;
+ *  - TX + RX + STANDBY + SLEEP time plus the pending segment (since the
+ *    last state change) equals the elapsed time;
+ *  - the drop of the source remaining energy equals the consumption of the
+ *    model plus the pending segment at the current of its state.
+ *
+ * Energies are compared within AbsoluteTolerance + RelativeTolerance times
+ * the compared value. A violation is logged and counted, or is fatal with
+ * FatalOnViolation. With SamplingRatio 0, Install returns without sampling
+ * any device or scheduling any event.
+ */
+class LoraEnergyInvariantChecker : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+  LoraEnergyInvariantChecker ();
+  virtual ~LoraEnergyInvariantChecker ();
+
+  //Take the baselines of the sampled devices and schedule the first check
+  //one Interval from now
+  void Install (Ptr<LoraEnergyMonitor> monitor);
+  //Run a last check (if the simulation is still running) and cancel the
+  //pending one
+  void Stop (void);
+
+  uint32_t GetNSampledNodes (void) const;
+  uint64_t GetNChecks (void) const;
+  uint64_t GetNViolations (void) const;
+
+private:
+  //Sampled device and its values at Install
+  struct Sample
+  {
+    uint32_t nodeId;
+    Ptr<LoraRadioEnergyModel> model;
+    Ptr<LoraEnergySource> source;
+    double consumedJ;
+    double remainingJ;
+    Time stateTime;
+    Time stampTime;
+  };
+
+  void DoDispose (void);
+  bool IsSampled (uint32_t nodeId) const;
+  void Check (void);
+  void CheckSample (const Sample &sample);
+  bool Equal (double a, double b) const;
+  void Violation (uint32_t nodeId, std::string what, double value, double expected);
+  static Time GetStateTime (Ptr<LoraRadioEnergyModel> model);
+
+  double m_samplingRatio;
+  uint32_t m_seed;
+  Time m_interval;
+  double m_relativeTolerance;
+  double m_absoluteTolerance;
+  bool m_fatal;
+
+  std::vector<Sample> m_samples;
+  EventId m_checkEvent;
+  uint64_t m_nChecks;
+  uint64_t m_nViolations;
+};
+
+} // namespace ns3
+
+#endif /* LORA_ENERGY_INVARIANT_CHECKER_H */
@@ -0,0 +1,169 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#include "lora-energy-monitor.h"
+#include "ns3/log.h"
+#include "ns3/lora-net-device.h"
+#include "ns3/energy-source-container.h"
+#include "ns3/device-energy-model-container.h"
+
+#define NO_INDEX    0xFFFFFFFF
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LoraEnergyMonitor");
+
+NS_OBJECT_ENSURE_REGISTERED (LoraEnergyMonitor);
+
+TypeId
+LoraEnergyMonitor::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LoraEnergyMonitor")
+    .SetParent<Object> ()
+    .SetGroupName ("Energy")
+    .AddConstructor<LoraEnergyMonitor> ()
+  ;
+  return tid;
+}
+
+LoraEnergyMonitor::LoraEnergyMonitor ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+LoraEnergyMonitor::~LoraEnergyMonitor ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+LoraEnergyMonitor::Reserve (uint32_t n)
+{
+  NS_LOG_FUNCTION (this << n);
+  m_entries.reserve (m_entries.size () + n);
+}
+
+uint32_t
+LoraEnergyMonitor::Add (Ptr<Node> node, Ptr<LoraEnergySource> source,
+                        Ptr<LoraRadioEnergyModel> model, Ptr<EndDeviceLoraMac> mac,
+                        Ptr<MobilityModel> mobility)
+{
+  NS_ASSERT (node != NULL);
+  NS_ASSERT (source != NULL);
+  NS_ASSERT (model != NULL);
+  uint32_t nodeId = node->GetId ();
+  NS_ASSERT_MSG (!Contains (nodeId), "Node " << nodeId << " already registered");
+
+  Entry entry;
+  entry.node     = node;
+  entry.source   = source;
+  entry.model    = model;
+  entry.mac      = mac;
+  entry.mobility = mobility;
+  m_entries.push_back (entry);
+
+  if (nodeId >= m_indexOfNode.size ())
+    {
+      m_indexOfNode.resize (nodeId + 1, NO_INDEX);
+    }
+  m_indexOfNode[nodeId] = m_entries.size () - 1;
+  return m_entries.size () - 1;
+}
+
+uint32_t
+LoraEnergyMonitor::Add (Ptr<Node> node)
+{
+  NS_LOG_FUNCTION (this << node);
+  NS_ASSERT (node != NULL);
+
+  //Get energy info
+  Ptr<EnergySourceContainer> energySourceContainer = node->GetObject<EnergySourceContainer>();
+  NS_ASSERT (energySourceContainer != NULL);
+  Ptr<LoraEnergySource> loraEnergySource = DynamicCast<LoraEnergySource>(energySourceContainer->Get(0));
+  NS_ASSERT (loraEnergySource != NULL);
+  DeviceEnergyModelContainer deviceEnergyModelContainer = loraEnergySource->FindDeviceEnergyModels("ns3::LoraRadioEnergyModel");
+  Ptr<LoraRadioEnergyModel> loraRadioEnergyModel = DynamicCast<LoraRadioEnergyModel>(deviceEnergyModelContainer.Get(0));
+  NS_ASSERT (loraRadioEnergyModel != NULL);
+
+  //Get lora-protocol info
+  Ptr<LoraNetDevice> loraNetDevice = node->GetDevice(0)->GetObject<LoraNetDevice>();
+  NS_ASSERT(loraNetDevice != NULL);
+  Ptr<EndDeviceLoraMac> edMac = loraNetDevice->GetMac()->GetObject<EndDeviceLoraMac>();
+
+  return Add (node, loraEnergySource, loraRadioEnergyModel, edMac, node->GetObject<MobilityModel> ());
+}
+
+void
+LoraEnergyMonitor::Add (NodeContainer c)
+{
+  NS_LOG_FUNCTION (this);
+  Reserve (c.GetN ());
+  for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+    {
+      Add (*i);
+    }
+}
+
+uint32_t
+LoraEnergyMonitor::GetN (void) const
+{
+  return m_entries.size ();
+}
+
+const LoraEnergyMonitor::Entry &
+LoraEnergyMonitor::Get (uint32_t index) const
+{
+  NS_ASSERT (index < m_entries.size ());
+  return m_entries[index];
+}
+
+LoraEnergyMonitor::Iterator
+LoraEnergyMonitor::Begin (void) const
+{
+  return m_entries.begin ();
+}
+
+LoraEnergyMonitor::Iterator
+LoraEnergyMonitor::End (void) const
+{
+  return m_entries.end ();
+}
+
+bool
+LoraEnergyMonitor::Contains (uint32_t nodeId) const
+{
+  return nodeId < m_indexOfNode.size () && m_indexOfNode[nodeId] != NO_INDEX;
+}
+
+uint32_t
+LoraEnergyMonitor::GetIndex (uint32_t nodeId) const
+{
+  NS_ASSERT_MSG (Contains (nodeId), "Node " << nodeId << " not registered");
+  return m_indexOfNode[nodeId];
+}
+
+void
+LoraEnergyMonitor::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_entries.clear ();
+  m_indexOfNode.clear ();
+  Object::DoDispose ();
+}
+
+} // namespace ns3
@@ -0,0 +1,92 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#ifndef LORA_ENERGY_MONITOR_H
+#define LORA_ENERGY_MONITOR_H
+
+#include "ns3/object.h"
+#include "ns3/node.h"
+#include "ns3/mobility-model.h"
+#include "ns3/end-device-lora-mac.h"
+#include "ns3/lora-energy-source.h"
+#include "ns3/lora-radio-energy-model.h"
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup energy
+ *
+ * \brief Registry of the energy objects of every end device
+ *
+ * Filled at install time by LoraRadioEnergyModelHelper, it keeps a dense
+ * vector of typed handles (source, radio model, MAC, mobility) so stats,
+ * traces and checks iterate the fleet in O(N) without object lookups.
+ */
+class LoraEnergyMonitor : public Object
+{
+public:
+
+  //Typed handles of one end device
+  struct Entry
+  {
+    Ptr<Node> node;
+    Ptr<LoraEnergySource> source;
+    Ptr<LoraRadioEnergyModel> model;
+    Ptr<EndDeviceLoraMac> mac;
+    Ptr<MobilityModel> mobility;
+  };
+
+  typedef std::vector<Entry>::const_iterator Iterator;
+
+  static TypeId GetTypeId (void);
+  LoraEnergyMonitor ();
+  virtual ~LoraEnergyMonitor ();
+
+  //Pre-size for n devices
+  void Reserve (uint32_t n);
+
+  //Register a device with known handles, return its dense index
+  uint32_t Add (Ptr<Node> node, Ptr<LoraEnergySource> source,
+                Ptr<LoraRadioEnergyModel> model, Ptr<EndDeviceLoraMac> mac,
+                Ptr<MobilityModel> mobility);
+  //Register a node whose energy model was installed elsewhere (handles
+  //are looked up once here)
+  uint32_t Add (Ptr<Node> node);
+  void Add (NodeContainer c);
+
+  uint32_t GetN (void) const;
+  const Entry & Get (uint32_t index) const;
+  Iterator Begin (void) const;
+  Iterator End (void) const;
+
+  //Dense index of a node
+  bool Contains (uint32_t nodeId) const;
+  uint32_t GetIndex (uint32_t nodeId) const;
+
+private:
+  void DoDispose (void);
+
+  std::vector<Entry> m_entries;
+  //Dense index by node id
+  std::vector<uint32_t> m_indexOfNode;
+};
+
+} // namespace ns3
+
+#endif /* LORA_ENERGY_MONITOR_H */
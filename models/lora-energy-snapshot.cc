@@ -0,0 +1,404 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#include "lora-energy-snapshot.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include <chrono>
+#include <cstring>
+
+#define SNAPSHOT_MAGIC          "LORASNP1"
+#define SNAPSHOT_VERSION        1
+#define SNAPSHOT_WAKE_MS        10
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LoraEnergySnapshot");
+
+NS_OBJECT_ENSURE_REGISTERED (LoraEnergySnapshot);
+
+namespace {
+
+uint64_t
+ToBits (double value)
+{
+  uint64_t bits;
+  std::memcpy (&bits, &value, sizeof (bits));
+  return bits;
+}
+
+double
+FromBits (uint64_t bits)
+{
+  double value;
+  std::memcpy (&value, &bits, sizeof (value));
+  return value;
+}
+
+void
+PutVarint (std::vector<char> &buffer, uint64_t value)
+{
+  while (value >= 0x80)
+    {
+      buffer.push_back (static_cast<char> ((value & 0x7F) | 0x80));
+      value >>= 7;
+    }
+  buffer.push_back (static_cast<char> (value));
+}
+
+//Return false if the varint runs past the end of the buffer
+bool
+GetVarint (const std::vector<char> &buffer, std::size_t &position, uint64_t &value)
+{
+  value = 0;
+  for (uint32_t shift = 0; shift < 64 && position < buffer.size (); shift += 7)
+    {
+      uint8_t byte = static_cast<uint8_t> (buffer[position++]);
+      value |= static_cast<uint64_t> (byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0)
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+} // anonymous namespace
+
+TypeId
+LoraEnergySnapshot::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LoraEnergySnapshot")
+    .SetParent<Object> ()
+    .SetGroupName ("Energy")
+    .AddConstructor<LoraEnergySnapshot> ()
+    .AddAttribute ("Interval",
+                   "Simulation time between two snapshots.",
+                   TimeValue (Seconds (3600)),
+                   MakeTimeAccessor (&LoraEnergySnapshot::m_interval),
+                   MakeTimeChecker ())
+    .AddAttribute ("FileName",
+                   "Snapshot file written by the background thread.",
+                   StringValue ("energy-snapshots.snp"),
+                   MakeStringAccessor (&LoraEnergySnapshot::m_fileName),
+                   MakeStringChecker ())
+  ;
+  return tid;
+}
+
+LoraEnergySnapshot::LoraEnergySnapshot ()
+  : m_running (false),
+    m_nextFrame (0),
+    m_stop (false),
+    m_captured (0),
+    m_dropped (0),
+    m_written (0)
+{
+  NS_LOG_FUNCTION (this);
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      m_frames[i].timeNs = 0;
+      m_frames[i].sequence = 0;
+      m_frames[i].busy = false;
+    }
+}
+
+LoraEnergySnapshot::~LoraEnergySnapshot ()
+{
+  NS_LOG_FUNCTION (this);
+  //A joinable std::thread must not be destroyed
+  Stop ();
+}
+
+void
+LoraEnergySnapshot::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  Stop ();
+  m_monitor = 0;
+  Object::DoDispose ();
+}
+
+void
+LoraEnergySnapshot::SetMonitor (Ptr<LoraEnergyMonitor> monitor)
+{
+  NS_LOG_FUNCTION (this << monitor);
+  NS_ASSERT_MSG (!m_running, "Monitor cannot change while snapshots are running");
+  m_monitor = monitor;
+}
+
+void
+LoraEnergySnapshot::Start (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (m_monitor != NULL);
+  NS_ASSERT (!m_running);
+  NS_ASSERT (m_interval.IsStrictlyPositive ());
+
+  uint32_t nNodes = m_monitor->GetN ();
+  uint32_t nFields = N_FIELDS;
+
+  //Preallocate the arena, nothing is allocated per snapshot afterwards
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      m_frames[i].values.assign (nNodes * nFields, 0.0);
+      m_frames[i].busy = false;
+    }
+  m_previous.assign (nNodes * nFields, 0);
+  m_payload.reserve (nNodes * nFields * 10);
+
+  m_file.open (m_fileName.c_str (), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+  if (!m_file.is_open ())
+    {
+      NS_FATAL_ERROR ("Cannot open snapshot file " << m_fileName);
+    }
+  uint32_t version = SNAPSHOT_VERSION;
+  uint32_t reserved = 0;
+  m_file.write (SNAPSHOT_MAGIC, 8);
+  m_file.write (reinterpret_cast<const char *> (&version), sizeof (version));
+  m_file.write (reinterpret_cast<const char *> (&nNodes), sizeof (nNodes));
+  m_file.write (reinterpret_cast<const char *> (&nFields), sizeof (nFields));
+  m_file.write (reinterpret_cast<const char *> (&reserved), sizeof (reserved));
+  for (LoraEnergyMonitor::Iterator i = m_monitor->Begin (); i != m_monitor->End (); ++i)
+    {
+      uint32_t nodeId = i->node->GetId ();
+      m_file.write (reinterpret_cast<const char *> (&nodeId), sizeof (nodeId));
+    }
+  m_file.flush ();
+
+  m_stop = false;
+  m_running = true;
+  m_writer = std::thread (&LoraEnergySnapshot::WriterLoop, this);
+  m_captureEvent = Simulator::Schedule (m_interval, &LoraEnergySnapshot::Capture, this);
+}
+
+void
+LoraEnergySnapshot::Stop (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (!m_running)
+    {
+      return;
+    }
+  m_captureEvent.Cancel ();
+  m_stop = true;
+  m_wake.notify_one ();
+  m_writer.join ();
+  m_file.close ();
+  m_running = false;
+  NS_LOG_INFO ("Snapshots captured " << m_captured << ", written " << m_written
+               << ", dropped " << m_dropped);
+}
+
+void
+LoraEnergySnapshot::Capture (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_captureEvent = Simulator::Schedule (m_interval, &LoraEnergySnapshot::Capture, this);
+
+  Frame &frame = m_frames[m_nextFrame];
+  if (frame.busy.load (std::memory_order_acquire))
+    {
+      //Writer is behind on both frames
+      m_dropped++;
+      NS_LOG_DEBUG ("Snapshot dropped at " << Simulator::Now ().GetSeconds () << " s");
+      return;
+    }
+
+  NS_ASSERT_MSG (frame.values.size () == m_monitor->GetN () * N_FIELDS,
+                 "Devices added to the monitor after Start");
+  frame.timeNs = Simulator::Now ().GetNanoSeconds ();
+  frame.sequence = m_captured++;
+  double *values = &frame.values[0];
+  Time now = Simulator::Now ();
+  for (LoraEnergyMonitor::Iterator i = m_monitor->Begin (); i != m_monitor->End (); ++i)
+    {
+      values[REMAINING_ENERGY] = i->source->GetRemainingEnergy ();
+      values[TX_ENERGY]        = i->model->GetTxEnergyConsumption ();
+      values[RX_ENERGY]        = i->model->GetRxEnergyConsumption ();
+      values[STANDBY_ENERGY]   = i->model->GetStandbyEnergyConsumption ();
+      values[SLEEP_ENERGY]     = i->model->GetSleepEnergyConsumption ();
+      //Model totals stop at the last state change, add the segment still
+      //open in the current state (already drawn from the source)
+      double pendingJ = (now - i->model->GetLastStampTime ()).GetSeconds () * i->model->GetCurrentA ()
+        * i->source->GetSupplyVoltage ();
+      switch (i->model->GetCurrentState ())
+        {
+        case EndDeviceLoraPhy::TX:
+          values[TX_ENERGY] += pendingJ;
+          break;
+        case EndDeviceLoraPhy::RX:
+          values[RX_ENERGY] += pendingJ;
+          break;
+        case EndDeviceLoraPhy::STANDBY:
+          values[STANDBY_ENERGY] += pendingJ;
+          break;
+        case EndDeviceLoraPhy::SLEEP:
+          values[SLEEP_ENERGY] += pendingJ;
+          break;
+        }
+      values += N_FIELDS;
+    }
+
+  frame.busy.store (true, std::memory_order_relaxed);
+  bool pushed = m_queue.Push (m_nextFrame);
+  NS_ASSERT (pushed);
+  (void) pushed;
+  m_nextFrame ^= 1;
+  m_wake.notify_one ();
+}
+
+void
+LoraEnergySnapshot::WriterLoop (void)
+{
+  uint32_t index;
+  while (true)
+    {
+      while (m_queue.Pop (index))
+        {
+          WriteFrame (m_frames[index]);
+          m_frames[index].busy.store (false, std::memory_order_release);
+          m_written++;
+        }
+      if (m_stop.load () && m_queue.IsEmpty ())
+        {
+          break;
+        }
+      //Timed wait, the producer notifies without taking the mutex
+      std::unique_lock<std::mutex> lock (m_wakeMutex);
+      m_wake.wait_for (lock, std::chrono::milliseconds (SNAPSHOT_WAKE_MS));
+    }
+}
+
+void
+LoraEnergySnapshot::WriteFrame (const Frame &frame)
+{
+  m_payload.clear ();
+  for (std::size_t v = 0; v < frame.values.size (); v++)
+    {
+      uint64_t bits = ToBits (frame.values[v]);
+      PutVarint (m_payload, bits ^ m_previous[v]);
+      m_previous[v] = bits;
+    }
+
+  uint32_t length = m_payload.size ();
+  m_file.write (reinterpret_cast<const char *> (&frame.timeNs), sizeof (frame.timeNs));
+  m_file.write (reinterpret_cast<const char *> (&frame.sequence), sizeof (frame.sequence));
+  m_file.write (reinterpret_cast<const char *> (&length), sizeof (length));
+  if (length > 0)
+    {
+      m_file.write (&m_payload[0], length);
+    }
+  m_file.flush ();
+}
+
+uint64_t
+LoraEnergySnapshot::GetCaptured (void) const
+{
+  return m_captured;
+}
+
+uint64_t
+LoraEnergySnapshot::GetWritten (void) const
+{
+  return m_written.load ();
+}
+
+uint64_t
+LoraEnergySnapshot::GetDropped (void) const
+{
+  return m_dropped;
+}
+
+void
+LoraEnergySnapshot::DecodeToText (std::string binaryName, std::string textName)
+{
+  std::ifstream in (binaryName.c_str (), std::ios_base::in | std::ios_base::binary);
+  if (!in.is_open ())
+    {
+      NS_FATAL_ERROR ("Cannot open snapshot file " << binaryName);
+    }
+  char magic[8];
+  uint32_t version, nNodes, nFields, reserved;
+  if (!in.read (magic, 8) || std::memcmp (magic, SNAPSHOT_MAGIC, 8) != 0)
+    {
+      NS_FATAL_ERROR ("Not a snapshot file: " << binaryName);
+    }
+  in.read (reinterpret_cast<char *> (&version), sizeof (version));
+  in.read (reinterpret_cast<char *> (&nNodes), sizeof (nNodes));
+  in.read (reinterpret_cast<char *> (&nFields), sizeof (nFields));
+  in.read (reinterpret_cast<char *> (&reserved), sizeof (reserved));
+  if (!in || version != SNAPSHOT_VERSION || nFields != N_FIELDS)
+    {
+      NS_FATAL_ERROR ("Unsupported snapshot file " << binaryName);
+    }
+  std::vector<uint32_t> nodeIds (nNodes);
+  if (nNodes > 0 && !in.read (reinterpret_cast<char *> (&nodeIds[0]), nNodes * sizeof (uint32_t)))
+    {
+      NS_FATAL_ERROR ("Truncated snapshot header in " << binaryName);
+    }
+
+  std::ofstream out (textName.c_str (), std::ios_base::out | std::ios_base::trunc);
+  NS_ASSERT (out.is_open () == true);
+  out << "#timeS" << " "
+      << "sequence" << " "
+      << "nodeId" << " "
+      << "remainingEnergyJ" << " "
+      << "txConsumedEnergy" << " "
+      << "rxConsumedEnergy" << " "
+      << "standbyConsumedEnergy" << " "
+      << "sleepConsumedEnergy" << " "
+      << "\n";
+
+  std::vector<uint64_t> previous (nNodes * nFields, 0);
+  std::vector<char> payload;
+  int64_t timeNs;
+  uint64_t sequence;
+  uint32_t length;
+  while (in.read (reinterpret_cast<char *> (&timeNs), sizeof (timeNs))
+         && in.read (reinterpret_cast<char *> (&sequence), sizeof (sequence))
+         && in.read (reinterpret_cast<char *> (&length), sizeof (length)))
+    {
+      payload.resize (length);
+      if (length > 0 && !in.read (&payload[0], length))
+        {
+          //Last frame cut by an aborted run
+          NS_LOG_WARN ("Truncated frame " << sequence << " ignored");
+          break;
+        }
+      std::size_t position = 0;
+      for (uint32_t n = 0; n < nNodes; n++)
+        {
+          out << timeNs / 1e9 << " " << sequence << " " << nodeIds[n] << " ";
+          for (uint32_t f = 0; f < nFields; f++)
+            {
+              uint64_t delta;
+              if (!GetVarint (payload, position, delta))
+                {
+                  NS_FATAL_ERROR ("Corrupted frame " << sequence << " in " << binaryName);
+                }
+              previous[n * nFields + f] ^= delta;
+              out << FromBits (previous[n * nFields + f]) << " ";
+            }
+          out << "\n";
+        }
+    }
+}
+
+} // namespace ns3
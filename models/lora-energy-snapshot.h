@@ -0,0 +1,135 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#ifndef LORA_ENERGY_SNAPSHOT_H
+#define LORA_ENERGY_SNAPSHOT_H
+
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/lora-energy-monitor.h"
+#include "ns3/lora-spsc-queue.h"
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup energy
+ *
+ * \brief Periodic snapshots of the fleet energy written while the simulation runs
+ *
+ * Every Interval the remaining energy and the per-state consumed energy of
+ * each device in the monitor are copied into one of two preallocated
+ * frames. The frame index is handed to a writer thread through a lock-free
+ * SPSC queue, so the event loop never waits on disk. If the writer still
+ * holds both frames the snapshot is dropped and counted.
+ *
+ * Each value is stored as the XOR of its bits with the previous written
+ * frame, as a LEB128 varint: unchanged values take one byte. File layout:
+ *
+ *   header : char magic[8] = "LORASNP1", uint32 version, uint32 nNodes,
+ *            uint32 nFields, uint32 reserved, uint32 nodeId[nNodes]
+ *   frame  : int64 time (ns), uint64 sequence, uint32 payload length,
+ *            payload = nNodes * nFields varints
+ *
+ * Frames are flushed one by one, so a run that aborts keeps every frame
+ * written so far.
+ */
+class LoraEnergySnapshot : public Object
+{
+public:
+
+  //Values stored per node and frame
+  enum Field
+  {
+    REMAINING_ENERGY = 0,
+    TX_ENERGY,
+    RX_ENERGY,
+    STANDBY_ENERGY,
+    SLEEP_ENERGY,
+    N_FIELDS
+  };
+
+  static TypeId GetTypeId (void);
+  LoraEnergySnapshot ();
+  virtual ~LoraEnergySnapshot ();
+
+  void SetMonitor (Ptr<LoraEnergyMonitor> monitor);
+
+  //Open the file, start the writer and schedule the first capture one
+  //Interval from now. Devices must not be added to the monitor afterwards.
+  void Start (void);
+  //Cancel pending captures, drain the queue and join the writer
+  void Stop (void);
+
+  uint64_t GetCaptured (void) const;
+  uint64_t GetWritten (void) const;
+  uint64_t GetDropped (void) const;
+
+  //Decode a snapshot file into "time nodeId field..." rows
+  static void DecodeToText (std::string binaryName, std::string textName);
+
+private:
+  struct Frame
+  {
+    int64_t timeNs;
+    uint64_t sequence;
+    std::vector<double> values;
+    //Owned by the writer while true
+    std::atomic<bool> busy;
+  };
+
+  void DoDispose (void);
+  void Capture (void);
+  void WriterLoop (void);
+  void WriteFrame (const Frame &frame);
+
+  Time m_interval;
+  std::string m_fileName;
+  Ptr<LoraEnergyMonitor> m_monitor;
+  EventId m_captureEvent;
+  bool m_running;
+
+  //Double-buffered arena, frame indices travel through the queue
+  Frame m_frames[2];
+  uint32_t m_nextFrame;
+  LoraSpscQueue<uint32_t, 4> m_queue;
+
+  //Writer side, only touched by the writer thread once started
+  std::ofstream m_file;
+  std::vector<uint64_t> m_previous;
+  std::vector<char> m_payload;
+
+  std::thread m_writer;
+  std::mutex m_wakeMutex;
+  std::condition_variable m_wake;
+  std::atomic<bool> m_stop;
+
+  uint64_t m_captured;
+  uint64_t m_dropped;
+  std::atomic<uint64_t> m_written;
+};
+
+} // namespace ns3
+
+#endif /* LORA_ENERGY_SNAPSHOT_H */
@@ -18,9 +18,17 @@
 
 #include "lora-energy-source-helper.h"
 #include "ns3/lora-energy-source.h"
+#include "ns3/log.h"
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <algorithm>
+#include <limits>
 
 namespace ns3 {
 
+NS_LOG_COMPONENT_DEFINE ("LoraEnergySourceHelper");
+
 LoraEnergySourceHelper::LoraEnergySourceHelper ()
 {
   m_loraEnergySource.SetTypeId ("ns3::LoraEnergySource");
@@ -36,6 +44,327 @@ LoraEnergySourceHelper::Set (std::string name, const AttributeValue &v)
   m_loraEnergySource.Set (name, v);
 }
 
+void
+LoraEnergySourceHelper::SetRandom (std::string name, Ptr<RandomVariableStream> rv)
+{
+  NS_ASSERT (rv != NULL);
+  if (name == "LoraEnergySourceInitialEnergyJ")
+    {
+      m_initialEnergyRv = rv;
+    }
+  else if (name == "StateOfCharge")
+    {
+      m_stateOfChargeRv = rv;
+    }
+  else if (name == "LoraEnergySupplyVoltageV")
+    {
+      m_supplyVoltageRv = rv;
+    }
+  else if (name == "LoraEnergyLowBatteryThreshold")
+    {
+      m_lowBatteryThRv = rv;
+    }
+  else if (name == "LoraEnergyHighBatteryThreshold")
+    {
+      m_highBatteryThRv = rv;
+    }
+  else
+    {
+      NS_FATAL_ERROR ("Unknown provisioning parameter: " << name);
+    }
+}
+
+int64_t
+LoraEnergySourceHelper::AssignStreams (int64_t stream)
+{
+  int64_t currentStream = stream;
+  Ptr<RandomVariableStream> rvs[5] = { m_initialEnergyRv, m_stateOfChargeRv, m_supplyVoltageRv,
+                                       m_lowBatteryThRv, m_highBatteryThRv };
+  for (int i = 0; i < 5; i++)
+    {
+      if (rvs[i] != NULL)
+        {
+          rvs[i]->SetStream (currentStream++);
+        }
+    }
+  return (currentStream - stream);
+}
+
+void
+LoraEnergySourceHelper::SetProvisioningFile (std::string fileName)
+{
+  std::ifstream provisioningFile (fileName.c_str ());
+  if (!provisioningFile.is_open ())
+    {
+      NS_FATAL_ERROR ("Cannot open provisioning file " << fileName);
+    }
+
+  std::string line;
+  uint32_t lineNumber = 0;
+  while (std::getline (provisioningFile, line))
+    {
+      lineNumber++;
+      if (line.empty () || line[0] == '#')
+        {
+          continue;
+        }
+      std::istringstream fields (line);
+      std::string field;
+      double value[6] = { 0, 0, 0, 0, 0, 0 };
+      bool present[6] = { false, false, false, false, false, false };
+      uint32_t column = 0;
+      while (std::getline (fields, field, ',') && column < 6)
+        {
+          if (!field.empty ())
+            {
+              char *end;
+              value[column] = std::strtod (field.c_str (), &end);
+              if (end == field.c_str () || value[column] < 0)
+                {
+                  NS_FATAL_ERROR ("Invalid value '" << field << "' in " << fileName << ":" << lineNumber);
+                }
+              present[column] = true;
+            }
+          column++;
+        }
+      if (!present[0])
+        {
+          NS_FATAL_ERROR ("Missing node id in " << fileName << ":" << lineNumber);
+        }
+      if (present[3] && value[3] == 0)
+        {
+          NS_FATAL_ERROR ("Invalid supply voltage in " << fileName << ":" << lineNumber);
+        }
+      if (present[1] && present[2] && value[2] > value[1])
+        {
+          NS_FATAL_ERROR ("Remaining energy above the initial energy in " << fileName << ":" << lineNumber);
+        }
+      const uint32_t fieldFlags[6] = { 0, INITIAL_ENERGY, REMAINING_ENERGY, SUPPLY_VOLTAGE,
+                                       LOW_BATTERY_TH, HIGH_BATTERY_TH };
+      BatteryState state;
+      state.provisioned = 0;
+      for (uint32_t i = 1; i < 6; i++)
+        {
+          if (present[i])
+            {
+              state.provisioned |= fieldFlags[i];
+            }
+        }
+      state.initialEnergyJ   = value[1];
+      state.stateOfCharge    = 0;
+      state.remainingEnergyJ = value[2];
+      state.supplyVoltageV   = value[3];
+      state.lowBatteryTh     = value[4];
+      state.highBatteryTh    = value[5];
+      m_provisioned[static_cast<uint32_t> (value[0])] = state;
+    }
+  NS_LOG_INFO ("Battery state provisioned for " << m_provisioned.size () << " nodes");
+}
+
+double
+LoraEnergySourceHelper::Draw (Ptr<RandomVariableStream> rv, double min, double max)
+{
+  double value = rv->GetValue ();
+  if (value < min || value > max)
+    {
+      NS_LOG_DEBUG ("Drawn value " << value << " clamped to [" << min << ", " << max << "]");
+    }
+  return std::min (std::max (value, min), max);
+}
+
+void
+LoraEnergySourceHelper::Provision (Ptr<LoraEnergySource> source, uint32_t nodeId) const
+{
+  const double unbounded = std::numeric_limits<double>::max ();
+  BatteryState state;
+  state.provisioned = 0;
+  if (m_initialEnergyRv != NULL)
+    {
+      state.initialEnergyJ = Draw (m_initialEnergyRv, 0, unbounded);
+      state.provisioned |= INITIAL_ENERGY;
+    }
+  if (m_stateOfChargeRv != NULL)
+    {
+      state.stateOfCharge = Draw (m_stateOfChargeRv, 0, 1);
+      state.provisioned |= STATE_OF_CHARGE;
+    }
+  if (m_supplyVoltageRv != NULL)
+    {
+      state.supplyVoltageV = m_supplyVoltageRv->GetValue ();
+      if (state.supplyVoltageV <= 0)
+        {
+          NS_FATAL_ERROR ("Non-positive supply voltage " << state.supplyVoltageV << " drawn for node " << nodeId);
+        }
+      state.provisioned |= SUPPLY_VOLTAGE;
+    }
+  if (m_lowBatteryThRv != NULL)
+    {
+      state.lowBatteryTh = Draw (m_lowBatteryThRv, 0, 1);
+      state.provisioned |= LOW_BATTERY_TH;
+    }
+  if (m_highBatteryThRv != NULL)
+    {
+      state.highBatteryTh = Draw (m_highBatteryThRv, 0, 1);
+      state.provisioned |= HIGH_BATTERY_TH;
+    }
+
+  //File entries override drawn values field by field
+  std::map<uint32_t, BatteryState>::const_iterator entry = m_provisioned.find (nodeId);
+  if (entry != m_provisioned.end ())
+    {
+      const BatteryState &fileState = entry->second;
+      if (fileState.provisioned & INITIAL_ENERGY)
+        {
+          state.initialEnergyJ = fileState.initialEnergyJ;
+          state.provisioned |= INITIAL_ENERGY;
+        }
+      if (fileState.provisioned & REMAINING_ENERGY)
+        {
+          state.remainingEnergyJ = fileState.remainingEnergyJ;
+          state.provisioned |= REMAINING_ENERGY;
+          state.provisioned &= ~STATE_OF_CHARGE;
+        }
+      if (fileState.provisioned & SUPPLY_VOLTAGE)
+        {
+          state.supplyVoltageV = fileState.supplyVoltageV;
+          state.provisioned |= SUPPLY_VOLTAGE;
+        }
+      if (fileState.provisioned & LOW_BATTERY_TH)
+        {
+          state.lowBatteryTh = fileState.lowBatteryTh;
+          state.provisioned |= LOW_BATTERY_TH;
+        }
+      if (fileState.provisioned & HIGH_BATTERY_TH)
+        {
+          state.highBatteryTh = fileState.highBatteryTh;
+          state.provisioned |= HIGH_BATTERY_TH;
+        }
+    }
+
+  //Drained/recharged hysteresis needs low < high, either one may come
+  //from the source attributes
+  double lowBatteryTh = state.provisioned & LOW_BATTERY_TH
+    ? state.lowBatteryTh : source->GetLowBatteryThreshold ();
+  double highBatteryTh = state.provisioned & HIGH_BATTERY_TH
+    ? state.highBatteryTh : source->GetHighBatteryThreshold ();
+  if (lowBatteryTh >= highBatteryTh)
+    {
+      NS_FATAL_ERROR ("Low battery threshold " << lowBatteryTh << " of node " << nodeId
+                      << " not below its high battery threshold " << highBatteryTh);
+    }
+
+  //Initial energy first, it resets the remaining energy
+  if (state.provisioned & INITIAL_ENERGY)
+    {
+      source->SetInitialEnergy (state.initialEnergyJ);
+    }
+  if (state.provisioned & STATE_OF_CHARGE)
+    {
+      source->SetRemainingEnergy (state.stateOfCharge * source->GetInitialEnergy ());
+    }
+  if (state.provisioned & REMAINING_ENERGY)
+    {
+      //The initial energy may come from attributes or a distribution
+      if (state.remainingEnergyJ > source->GetInitialEnergy ())
+        {
+          NS_FATAL_ERROR ("Remaining energy " << state.remainingEnergyJ << " J of node " << nodeId
+                          << " above its initial energy " << source->GetInitialEnergy () << " J");
+        }
+      source->SetRemainingEnergy (state.remainingEnergyJ);
+    }
+  if (state.provisioned & SUPPLY_VOLTAGE)
+    {
+      source->SetSupplyVoltage (state.supplyVoltageV);
+    }
+  if (state.provisioned & LOW_BATTERY_TH)
+    {
+      source->SetLowBatteryThreshold (state.lowBatteryTh);
+    }
+  if (state.provisioned & HIGH_BATTERY_TH)
+    {
+      source->SetHighBatteryThreshold (state.highBatteryTh);
+    }
+}
+
+void
+LoraEnergySourceHelper::ForwardWithNodeId (NodeTraceSink sink, uint32_t nodeId,
+                                           double oldValue, double newValue)
+{
+  sink (nodeId, oldValue, newValue);
+}
+
+uint32_t
+LoraEnergySourceHelper::ConnectRemainingEnergy (EnergySourceContainer sources, NodeTraceSink sink,
+                                                uint32_t stride) const
+{
+  NS_ASSERT (!sink.IsNull ());
+  NS_ASSERT (stride > 0);
+  uint32_t connected = 0;
+  for (uint32_t i = 0; i < sources.GetN (); i += stride)
+    {
+      Ptr<LoraEnergySource> source = DynamicCast<LoraEnergySource> (sources.Get (i));
+      NS_ASSERT (source != NULL);
+      source->ConnectRemainingEnergy (MakeBoundCallback (&LoraEnergySourceHelper::ForwardWithNodeId,
+                                                         sink, source->GetNode ()->GetId ()));
+      connected++;
+    }
+  return connected;
+}
+
+EnergySourceContainer
+LoraEnergySourceHelper::BulkInstall (NodeContainer c) const
+{
+  EnergySourceContainer container;
+  if (c.GetN () == 0)
+    {
+      return container;
+    }
+  LoraObjectPool<LoraEnergySource>::Reserve (c.GetN ());
+
+  //Attributes are resolved once on a prototype and copied to the rest
+  Ptr<LoraEnergySource> prototype = m_loraEnergySource.Create<LoraEnergySource> ();
+  NS_ASSERT (prototype != NULL);
+  double initialEnergyJ   = prototype->GetInitialEnergy ();
+  double initialChargemAh = prototype->GetInitialCharge ();
+  double supplyVoltageV   = prototype->GetSupplyVoltage ();
+  double lowBatteryTh     = prototype->GetLowBatteryThreshold ();
+  double highBatteryTh    = prototype->GetHighBatteryThreshold ();
+  Time updateInterval     = prototype->GetEnergyUpdateInterval ();
+
+  for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+    {
+      Ptr<Node> node = *i;
+      NS_ASSERT (node != NULL);
+      Ptr<LoraEnergySource> source = prototype;
+      if (i != c.Begin ())
+        {
+          source = CreateObject<LoraEnergySource> ();
+          source->SetInitialEnergy (initialEnergyJ);
+          source->SetInitialCharge (initialChargemAh);
+          source->SetSupplyVoltage (supplyVoltageV);
+          source->SetLowBatteryThreshold (lowBatteryTh);
+          source->SetHighBatteryThreshold (highBatteryTh);
+          source->SetEnergyUpdateInterval (updateInterval);
+        }
+      Provision (source, node->GetId ());
+      source->SetNode (node);
+      container.Add (source);
+
+      //Same aggregation as EnergySourceHelper::Install
+      Ptr<EnergySourceContainer> sourcesOnNode = node->GetObject<EnergySourceContainer> ();
+      if (sourcesOnNode == NULL)
+        {
+          sourcesOnNode = CreateObject<EnergySourceContainer> ();
+          sourcesOnNode->Add (source);
+          node->AggregateObject (sourcesOnNode);
+        }
+      else
+        {
+          sourcesOnNode->Add (source);
+        }
+    }
+  return container;
+}
 
 
 
@@ -43,8 +372,9 @@ Ptr<EnergySource>
 LoraEnergySourceHelper::DoInstall (Ptr<Node> node) const
 {
   NS_ASSERT (node != NULL);
-  Ptr<EnergySource> source = m_loraEnergySource.Create<LoraEnergySource> ();
+  Ptr<LoraEnergySource> source = m_loraEnergySource.Create<LoraEnergySource> ();
   NS_ASSERT (source != NULL);
+  Provision (source, node->GetId ());
   source->SetNode (node);
   return source;
 }
@@ -21,9 +21,13 @@
 
 #include "ns3/energy-model-helper.h"
 #include "ns3/node.h"
+#include "ns3/random-variable-stream.h"
+#include <map>
 
 namespace ns3 {
 
+class LoraEnergySource;
+
 /**
  * \ingroup energy
  * \brief Creates a LoraEnergySource object. Based on BasicEnergySourceHelper
@@ -37,12 +41,83 @@ public:
 
   void Set (std::string name, const AttributeValue &v);
 
+  //Draw a per-node value from a distribution at install time. Valid names:
+  //LoraEnergySourceInitialEnergyJ, LoraEnergySupplyVoltageV,
+  //LoraEnergyLowBatteryThreshold, LoraEnergyHighBatteryThreshold and
+  //StateOfCharge (remaining energy as a fraction of the initial energy).
+  //Draws are clamped to the valid range (energies >= 0, fractions in
+  //[0, 1]); a non-positive supply voltage is fatal.
+  void SetRandom (std::string name, Ptr<RandomVariableStream> rv);
+  //Assign fixed random variable streams, return number of streams used
+  int64_t AssignStreams (int64_t stream);
+
+  //Per-node battery state read from a CSV file with one line per node:
+  //nodeId,initialEnergyJ,remainingEnergyJ,supplyVoltageV,lowTh,highTh
+  //Lines starting with '#' are ignored and empty fields keep the value
+  //given by attributes/distributions. File entries take precedence.
+  //Negative values, and a remaining energy above the initial energy of the
+  //node, are fatal.
+  void SetProvisioningFile (std::string fileName);
+
+  //Trace sink receiving the node id as context (old and new value)
+  typedef Callback<void, uint32_t, double, double> NodeTraceSink;
+
+  //Connect a single sink to RemainingEnergy of every stride-th source,
+  //without Config paths. Return the number of connected sources.
+  uint32_t ConnectRemainingEnergy (EnergySourceContainer sources, NodeTraceSink sink,
+                                   uint32_t stride = 1) const;
+
+  //Bulk installation for large fleets. Attributes are resolved once and
+  //sources are allocated from a pooled arena reserved for the whole set.
+  EnergySourceContainer BulkInstall (NodeContainer c) const;
+
 private:
+  //Fields of BatteryState that are provisioned
+  enum BatteryField
+  {
+    INITIAL_ENERGY  = 1 << 0,
+    STATE_OF_CHARGE = 1 << 1,
+    REMAINING_ENERGY = 1 << 2,
+    SUPPLY_VOLTAGE  = 1 << 3,
+    LOW_BATTERY_TH  = 1 << 4,
+    HIGH_BATTERY_TH = 1 << 5
+  };
+
+  //Battery state of one node, only the fields flagged in provisioned are set
+  struct BatteryState
+  {
+    uint32_t provisioned;
+    double initialEnergyJ;
+    double stateOfCharge;
+    double remainingEnergyJ;
+    double supplyVoltageV;
+    double lowBatteryTh;
+    double highBatteryTh;
+  };
+
+  //Forward a trace to the sink adding the node id
+  static void ForwardWithNodeId (NodeTraceSink sink, uint32_t nodeId,
+                                 double oldValue, double newValue);
+
+  //Draw a value, clamped to [min, max] (distributions may cross the bounds)
+  static double Draw (Ptr<RandomVariableStream> rv, double min, double max);
+
+  //Apply distributions and file entries to the source of a node
+  void Provision (Ptr<LoraEnergySource> source, uint32_t nodeId) const;
+
   virtual Ptr<EnergySource> DoInstall (Ptr<Node> node) const;
 
 private:
   ObjectFactory m_loraEnergySource;
 
+  //Per-node provisioning
+  Ptr<RandomVariableStream> m_initialEnergyRv;
+  Ptr<RandomVariableStream> m_stateOfChargeRv;
+  Ptr<RandomVariableStream> m_supplyVoltageRv;
+  Ptr<RandomVariableStream> m_lowBatteryThRv;
+  Ptr<RandomVariableStream> m_highBatteryThRv;
+  std::map<uint32_t, BatteryState> m_provisioned;
+
 };
 
 } // namespace ns3
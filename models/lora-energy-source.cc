@@ -23,6 +23,7 @@
 #include "ns3/trace-source-accessor.h"
 #include "ns3/simulator.h"
 #include "ns3/lora-utils.h"
+#include "ns3/lora-event-log.h"
 
 
 //Implementaton based on BasicEnergySource 
@@ -63,13 +64,15 @@ LoraEnergySource::GetTypeId (void)
     .AddAttribute ("LoraEnergyLowBatteryThreshold",
                    "Low battery threshold for basic energy source.",
                    DoubleValue (0.10), 
-                   MakeDoubleAccessor (&LoraEnergySource::m_lowBatteryTh),
-                   MakeDoubleChecker<double> ())
+                   MakeDoubleAccessor (&LoraEnergySource::SetLowBatteryThreshold,
+                                       &LoraEnergySource::GetLowBatteryThreshold),
+                   MakeDoubleChecker<double> (0, 1))
     .AddAttribute ("LoraEnergyHighBatteryThreshold",
                    "High battery threshold for basic energy source.",
                    DoubleValue (0.15),
-                   MakeDoubleAccessor (&LoraEnergySource::m_highBatteryTh),
-                   MakeDoubleChecker<double> ())
+                   MakeDoubleAccessor (&LoraEnergySource::SetHighBatteryThreshold,
+                                       &LoraEnergySource::GetHighBatteryThreshold),
+                   MakeDoubleChecker<double> (0, 1))
     .AddAttribute ("PeriodicEnergyUpdateInterval",
                    "Time between two consecutive periodic energy updates.",
                    TimeValue (Seconds (1.0)),
@@ -81,8 +84,8 @@ LoraEnergySource::GetTypeId (void)
                      MakeTraceSourceAccessor (&LoraEnergySource::m_remainingEnergyJ),
                      "ns3::TracedValueCallback::Double")
     .AddTraceSource ("RemainingCharge",
-                     "Remaining energy at LoraEnergySource.",
-                     MakeTraceSourceAccessor (&LoraEnergySource::m_remainingChargemAh),
+                     "Remaining charge (mAh) at LoraEnergySource.",
+                     MakeLoraLazyTraceAccessor (&LoraEnergySource::GetRemainingChargeTrace),
                      "ns3::TracedValueCallback::Double")
   ;
   return tid;
@@ -100,6 +103,28 @@ LoraEnergySource::~LoraEnergySource ()
   NS_LOG_FUNCTION (this);
 }
 
+TracedCallback<double, double> &
+LoraEnergySource::GetRemainingChargeTrace (LoraEnergySource *source)
+{
+  if (!source->m_remainingChargeTrace)
+    {
+      source->m_remainingChargeTrace.reset (new TracedCallback<double, double>);
+    }
+  return *source->m_remainingChargeTrace;
+}
+
+void *
+LoraEnergySource::operator new (std::size_t size)
+{
+  return LoraObjectPool<LoraEnergySource>::Allocate (size);
+}
+
+void
+LoraEnergySource::operator delete (void *p, std::size_t size)
+{
+  LoraObjectPool<LoraEnergySource>::Release (p, size);
+}
+
 void
 LoraEnergySource::SetInitialEnergy (double initialEnergyJ)
 {
@@ -110,13 +135,24 @@ LoraEnergySource::SetInitialEnergy (double initialEnergyJ)
 
 }
 
+void
+LoraEnergySource::SetRemainingEnergy (double remainingEnergyJ)
+{
+  NS_LOG_FUNCTION (this << remainingEnergyJ);
+  if (remainingEnergyJ < 0 || remainingEnergyJ > m_initialEnergyJ)
+    {
+      NS_FATAL_ERROR ("Remaining energy " << remainingEnergyJ << " J out of [0, "
+                      << m_initialEnergyJ << "] J");
+    }
+  m_remainingEnergyJ = remainingEnergyJ;
+}
+
 void
 LoraEnergySource::SetInitialCharge (double initialChargemAh)
 {
   NS_LOG_FUNCTION (this << initialChargemAh);
   NS_ASSERT (initialChargemAh >= 0);
   m_initialChargemAh = initialChargemAh;
-  m_remainingChargemAh = m_initialChargemAh;
 }
 
 void
@@ -140,6 +176,56 @@ LoraEnergySource::GetEnergyUpdateInterval (void) const
   return m_energyUpdateInterval;
 }
 
+void
+LoraEnergySource::ConnectRemainingEnergy (Callback<void, double, double> cb)
+{
+  NS_LOG_FUNCTION (this);
+  m_remainingEnergyJ.ConnectWithoutContext (cb);
+}
+
+void
+LoraEnergySource::SetLowBatteryThreshold (double threshold)
+{
+  NS_LOG_FUNCTION (this << threshold);
+  if (threshold < 0 || threshold > 1)
+    {
+      NS_FATAL_ERROR ("Low battery threshold " << threshold << " outside [0, 1]");
+    }
+  m_lowBatteryTh = threshold;
+}
+
+void
+LoraEnergySource::SetHighBatteryThreshold (double threshold)
+{
+  NS_LOG_FUNCTION (this << threshold);
+  if (threshold < 0 || threshold > 1)
+    {
+      NS_FATAL_ERROR ("High battery threshold " << threshold << " outside [0, 1]");
+    }
+  m_highBatteryTh = threshold;
+}
+
+double
+LoraEnergySource::GetLowBatteryThreshold (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_lowBatteryTh;
+}
+
+double
+LoraEnergySource::GetHighBatteryThreshold (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_highBatteryTh;
+}
+
+bool
+LoraEnergySource::IsDepleted (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_depleted;
+}
+
 double
 LoraEnergySource::GetSupplyVoltage (void) const
 {
@@ -178,7 +264,8 @@ LoraEnergySource::GetRemainingCharge (void)
   NS_LOG_FUNCTION (this);
 
   UpdateEnergySource ();
-  return m_remainingChargemAh;
+  //Derived from remaining energy, not stored per source
+  return (m_remainingEnergyJ / m_supplyVoltageV) * 1000;
 }
 
 
@@ -250,6 +337,7 @@ LoraEnergySource::HandleEnergyDrainedEvent (void)
 {
   NS_LOG_FUNCTION (this);
   NS_LOG_DEBUG ("LoraEnergySource:Energy depleted!");
+  LoraEventLog::Write (LoraEventLog::SOURCE_DRAINED, m_remainingEnergyJ);
   NotifyEnergyDrained (); 
 }
 
@@ -258,6 +346,7 @@ LoraEnergySource::HandleEnergyRechargedEvent (void)
 {
   NS_LOG_FUNCTION (this);
   NS_LOG_DEBUG ("LoraEnergySource:Energy recharged!");
+  LoraEventLog::Write (LoraEventLog::SOURCE_RECHARGED, m_remainingEnergyJ);
   NotifyEnergyRecharged (); 
 }
 
@@ -270,14 +359,20 @@ LoraEnergySource::CalculateRemaining(void)
   NS_ASSERT (duration.IsPositive ());
  
   double energyToDecreaseJ = (totalCurrentA * m_supplyVoltageV * duration.GetNanoSeconds ()) / 1e9;
+  double remainingEnergyJ = m_remainingEnergyJ;
   if(m_remainingEnergyJ <= energyToDecreaseJ)
   {
     m_remainingEnergyJ = 0.0;
   }
   m_remainingEnergyJ -= energyToDecreaseJ;
   NS_LOG_DEBUG ("LoraEnergySource:Remaining energy = " << m_remainingEnergyJ);
-  m_remainingChargemAh = (m_remainingEnergyJ/m_supplyVoltageV)*1000;
-  NS_LOG_DEBUG ("LoraEnergySource:Remaining charge = " << m_remainingChargemAh);
+  if (m_remainingChargeTrace)
+    {
+      //Charge is derived from the remaining energy
+      (*m_remainingChargeTrace) ((remainingEnergyJ / m_supplyVoltageV) * 1000,
+                                 (m_remainingEnergyJ / m_supplyVoltageV) * 1000);
+    }
+  LoraEventLog::Write (LoraEventLog::SOURCE_UPDATE, m_remainingEnergyJ, totalCurrentA);
 }
 
 
@@ -23,6 +23,9 @@
 #include "ns3/nstime.h"
 #include "ns3/event-id.h"
 #include "ns3/energy-source.h"
+#include "ns3/lora-object-pool.h"
+#include "ns3/lora-lazy-trace.h"
+#include <memory>
 
 namespace ns3 {
 
@@ -39,6 +42,10 @@ public:
   LoraEnergySource ();
   virtual ~LoraEnergySource ();
 
+  //Sources are served from a pooled arena (see LoraObjectPool)
+  static void * operator new (std::size_t size);
+  static void operator delete (void *p, std::size_t size);
+
 
   virtual double GetInitialEnergy (void) const;
   virtual double GetInitialCharge (void) const;
@@ -56,6 +63,8 @@ public:
   virtual void UpdateEnergySource (void);
 
   void SetInitialEnergy (double initialEnergyJ);
+  //Start from a partially drained battery (after SetInitialEnergy)
+  void SetRemainingEnergy (double remainingEnergyJ);
   void SetInitialCharge (double initialChargeC);
 
   void SetSupplyVoltage (double supplyVoltageV);
@@ -64,6 +73,17 @@ public:
 
   Time GetEnergyUpdateInterval (void) const;
 
+  //Typed connection to RemainingEnergy trace (no TypeId or path lookup)
+  void ConnectRemainingEnergy (Callback<void, double, double> cb);
+
+  //Battery thresholds, as a fraction of the initial energy
+  void SetLowBatteryThreshold (double threshold);
+  void SetHighBatteryThreshold (double threshold);
+  double GetLowBatteryThreshold (void) const;
+  double GetHighBatteryThreshold (void) const;
+  //Below the low threshold and not yet recharged above the high one
+  bool IsDepleted (void) const;
+
 
 private:
 
@@ -74,30 +94,29 @@ private:
   void CalculateRemaining(void);
   void CalculateConsumedEnergy(void);
   void CalculateConsumedCharge(void);
+  //RemainingCharge trace source, allocated on first connection
+  static TracedCallback<double, double> & GetRemainingChargeTrace (LoraEnergySource *source);
 
 private:
   //initial energy, in Joules
-  double m_initialEnergyJ;  
+  double m_initialEnergyJ;
   //initial charge in mAh
-  double m_initialChargemAh;  
+  double m_initialChargemAh;
   //suply voltage  (volts)
-  double m_supplyVoltageV;     
-  //Thresholds  
-  double m_lowBatteryTh;                 
-  double m_highBatteryTh; 
-  //depleted flag  
-  bool m_depleted;                       
-                                        
-  // remaining energy, in Joules
-  TracedValue<double> m_remainingEnergyJ; 
-  // remaining charge, in  mAh
-  TracedValue<double> m_remainingChargemAh; 
+  double m_supplyVoltageV;
+  //Thresholds
+  double m_lowBatteryTh;
+  double m_highBatteryTh;
+  // remaining energy, in Joules (remaining charge is derived from it)
+  TracedValue<double> m_remainingEnergyJ;
+  //Trace of the remaining charge (mAh), only allocated once connected
+  std::unique_ptr<TracedCallback<double, double> > m_remainingChargeTrace;
   // Internal variables
-  EventId m_energyUpdateEvent;            
-  Time m_lastUpdateTime;                 
-  Time m_energyUpdateInterval;         
-
-
+  EventId m_energyUpdateEvent;
+  Time m_lastUpdateTime;
+  Time m_energyUpdateInterval;
+  //depleted flag
+  bool m_depleted;
 };
 
 } // namespace ns3
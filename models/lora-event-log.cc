@@ -0,0 +1,196 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#include "lora-event-log.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/simulator.h"
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LoraEventLog");
+
+std::atomic<bool> LoraEventLog::s_enabled (false);
+
+namespace {
+
+//Shared file, blocks of the thread buffers are appended under the mutex.
+//blockRecords and generation are also read by Append without it.
+struct LogFile
+{
+  LogFile () : file (0), blockRecords (4096), generation (0)
+  {
+  }
+  ~LogFile ()
+  {
+    if (file != 0)
+      {
+        fclose (file);
+      }
+  }
+
+  std::mutex mutex;
+  FILE *file;
+  std::atomic<uint32_t> blockRecords;
+  //Incremented on every Enable, so that buffers of a closed file are dropped
+  std::atomic<uint64_t> generation;
+};
+
+LogFile g_logFile;
+
+//Buffer of one thread, written when full and when the thread ends
+struct ThreadBuffer
+{
+  ThreadBuffer () : generation (0)
+  {
+  }
+  ~ThreadBuffer ()
+  {
+    Flush ();
+  }
+
+  void Flush (void)
+  {
+    if (records.empty ())
+      {
+        return;
+      }
+    std::lock_guard<std::mutex> lock (g_logFile.mutex);
+    if (g_logFile.file != 0 && generation == g_logFile.generation.load ())
+      {
+        fwrite (records.data (), sizeof (LoraEventLog::Record), records.size (), g_logFile.file);
+      }
+    records.clear ();
+  }
+
+  std::vector<LoraEventLog::Record> records;
+  uint64_t generation;
+};
+
+thread_local ThreadBuffer t_buffer;
+
+} // namespace
+
+void
+LoraEventLog::Enable (std::string fileName, uint32_t blockRecords)
+{
+  NS_LOG_FUNCTION (fileName << blockRecords);
+  NS_ASSERT (blockRecords > 0);
+  Disable ();
+
+  std::lock_guard<std::mutex> lock (g_logFile.mutex);
+  g_logFile.file = fopen (fileName.c_str (), "wb");
+  if (g_logFile.file == 0)
+    {
+      NS_FATAL_ERROR ("Cannot open " << fileName);
+    }
+  char magic[8] = { 'L', 'O', 'R', 'A', 'E', 'V', 'T', '1' };
+  uint32_t header[2] = { VERSION, sizeof (Record) };
+  fwrite (magic, sizeof (magic), 1, g_logFile.file);
+  fwrite (header, sizeof (header), 1, g_logFile.file);
+  //blockRecords is published by the generation change
+  g_logFile.blockRecords.store (blockRecords, std::memory_order_relaxed);
+  g_logFile.generation.fetch_add (1, std::memory_order_release);
+  s_enabled.store (true);
+}
+
+void
+LoraEventLog::Disable (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  if (!s_enabled.exchange (false))
+    {
+      return;
+    }
+  t_buffer.Flush ();
+
+  std::lock_guard<std::mutex> lock (g_logFile.mutex);
+  if (g_logFile.file != 0)
+    {
+      fclose (g_logFile.file);
+      g_logFile.file = 0;
+    }
+}
+
+void
+LoraEventLog::Append (Code code, double a, double b)
+{
+  ThreadBuffer &buffer = t_buffer;
+  uint64_t generation = g_logFile.generation.load (std::memory_order_acquire);
+  uint32_t blockRecords = g_logFile.blockRecords.load (std::memory_order_relaxed);
+  if (buffer.generation != generation)
+    {
+      //First record of this thread for the current file
+      buffer.records.clear ();
+      buffer.records.reserve (blockRecords);
+      buffer.generation = generation;
+    }
+  Record record;
+  record.timeNs = Simulator::Now ().GetNanoSeconds ();
+  record.node = Simulator::GetContext ();
+  record.code = code;
+  record.reserved = 0;
+  record.a = a;
+  record.b = b;
+  buffer.records.push_back (record);
+  if (buffer.records.size () >= blockRecords)
+    {
+      buffer.Flush ();
+    }
+}
+
+const char *
+LoraEventLog::GetCodeName (uint16_t code)
+{
+  switch (code)
+    {
+    case MODEL_STATE_CHANGE:
+      return "MODEL_STATE_CHANGE";
+    case MODEL_ENERGY_DECREMENT:
+      return "MODEL_ENERGY_DECREMENT";
+    case MODEL_TX_CURRENT:
+      return "MODEL_TX_CURRENT";
+    case MODEL_ENERGY_DEPLETED:
+      return "MODEL_ENERGY_DEPLETED";
+    case MODEL_ENERGY_RECHARGED:
+      return "MODEL_ENERGY_RECHARGED";
+    case SOURCE_UPDATE:
+      return "SOURCE_UPDATE";
+    case SOURCE_DRAINED:
+      return "SOURCE_DRAINED";
+    case SOURCE_RECHARGED:
+      return "SOURCE_RECHARGED";
+    case LISTENER_TX_START:
+      return "LISTENER_TX_START";
+    case LISTENER_RX_START:
+      return "LISTENER_RX_START";
+    case LISTENER_STANDBY:
+      return "LISTENER_STANDBY";
+    case LISTENER_SLEEP:
+      return "LISTENER_SLEEP";
+    default:
+      return "UNKNOWN";
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,111 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#ifndef LORA_EVENT_LOG_H
+#define LORA_EVENT_LOG_H
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+
+namespace ns3 {
+
+/**
+ * \ingroup energy
+ *
+ * \brief Binary event log of the energy components
+ *
+ * Replacement for running LoraRadioEnergyModel, LoraEnergySource and the
+ * energy PHY listener with LOG_LEVEL_ALL: each event is a fixed-size record
+ * appended to a buffer of the calling thread, written to the file one block
+ * at a time. No text is formatted while the simulation runs; the
+ * lora-event-log-decoder tool turns the file into a readable log. When the
+ * log is not enabled Write costs one test of a flag.
+ *
+ * File layout:
+ *
+ *   header : char magic[8] = "LORAEVT1", uint32 version, uint32 recordSize
+ *   record : int64 time (ns), uint32 node (simulator context), uint16 code,
+ *            uint16 reserved, double a, double b
+ */
+class LoraEventLog
+{
+public:
+  //Event codes and meaning of the payload values
+  enum Code
+  {
+    MODEL_STATE_CHANGE = 1,     //a: previous state, b: new state
+    MODEL_ENERGY_DECREMENT,     //a: energy of the closed segment (J), b: total (J)
+    MODEL_TX_CURRENT,           //a: TX power (dBm), b: TX current (A)
+    MODEL_ENERGY_DEPLETED,      //a, b: 0
+    MODEL_ENERGY_RECHARGED,     //a, b: 0
+    SOURCE_UPDATE,              //a: remaining energy (J), b: total current (A)
+    SOURCE_DRAINED,             //a: remaining energy (J), b: 0
+    SOURCE_RECHARGED,           //a: remaining energy (J), b: 0
+    LISTENER_TX_START,          //a: TX power (dBm), b: 0
+    LISTENER_RX_START,          //a, b: 0
+    LISTENER_STANDBY,           //a, b: 0
+    LISTENER_SLEEP              //a, b: 0
+  };
+
+  struct Record
+  {
+    int64_t timeNs;
+    uint32_t node;
+    uint16_t code;
+    uint16_t reserved;
+    double a;
+    double b;
+  };
+  //Fixed layout shared with lora-event-log-decoder
+  static_assert (sizeof (Record) == 32, "LoraEventLog::Record must be 32 bytes");
+
+  static const uint32_t VERSION = 1;
+
+  //Open the file; records are written in blocks of blockRecords
+  static void Enable (std::string fileName, uint32_t blockRecords = 4096);
+  //Write the buffer of the calling thread and close the file. Other
+  //threads write their buffers when full or when they end: records they
+  //still hold at Disable are dropped, so end them before.
+  static void Disable (void);
+
+  static bool IsEnabled (void)
+  {
+    return s_enabled.load (std::memory_order_relaxed);
+  }
+
+  static void Write (Code code, double a = 0, double b = 0)
+  {
+    if (s_enabled.load (std::memory_order_relaxed))
+      {
+        Append (code, a, b);
+      }
+  }
+
+  //Readable name of a code, "UNKNOWN" if not valid
+  static const char * GetCodeName (uint16_t code);
+
+private:
+  static void Append (Code code, double a, double b);
+
+  static std::atomic<bool> s_enabled;
+};
+
+} // namespace ns3
+
+#endif /* LORA_EVENT_LOG_H */
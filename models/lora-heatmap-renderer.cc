@@ -0,0 +1,477 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#include "lora-heatmap-renderer.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/buildings-module.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <thread>
+
+#define SECONDS_PER_DAY       86400.0
+#define MIN_SF                      7
+#define MAX_SF                     12
+#define EMPTY_CELL_GREY           235
+#define PNG_STORED_BLOCK        65535
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LoraHeatmapRenderer");
+
+namespace {
+
+//Viridis colour map sampled at 5 points, t in [0,1]
+void
+MapColour (double t, uint8_t rgb[3])
+{
+  static const double stops[5][3] = { { 68, 1, 84 },
+                                       { 59, 82, 139 },
+                                       { 33, 145, 140 },
+                                       { 94, 201, 98 },
+                                       { 253, 231, 37 } };
+  t = std::min (1.0, std::max (0.0, t)) * 4;
+  int i = std::min (3, static_cast<int> (t));
+  double f = t - i;
+  for (int c = 0; c < 3; c++)
+    {
+      rgb[c] = static_cast<uint8_t> (stops[i][c] + f * (stops[i + 1][c] - stops[i][c]) + 0.5);
+    }
+}
+
+uint32_t
+Crc32 (const uint8_t *data, std::size_t length, uint32_t crc = 0)
+{
+  static uint32_t table[256];
+  static bool ready = false;
+  if (!ready)
+    {
+      for (uint32_t n = 0; n < 256; n++)
+        {
+          uint32_t c = n;
+          for (int k = 0; k < 8; k++)
+            {
+              c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            }
+          table[n] = c;
+        }
+      ready = true;
+    }
+  crc = ~crc;
+  for (std::size_t i = 0; i < length; i++)
+    {
+      crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+  return ~crc;
+}
+
+void
+PutBigEndian (std::vector<uint8_t> &out, uint32_t value)
+{
+  out.push_back (value >> 24);
+  out.push_back (value >> 16);
+  out.push_back (value >> 8);
+  out.push_back (value);
+}
+
+void
+WriteChunk (std::ofstream &file, const char type[4], const std::vector<uint8_t> &data)
+{
+  std::vector<uint8_t> chunk;
+  chunk.reserve (data.size () + 12);
+  PutBigEndian (chunk, data.size ());
+  chunk.insert (chunk.end (), type, type + 4);
+  chunk.insert (chunk.end (), data.begin (), data.end ());
+  //CRC over type and data
+  PutBigEndian (chunk, Crc32 (&chunk[4], data.size () + 4));
+  file.write (reinterpret_cast<const char *> (&chunk[0]), chunk.size ());
+}
+
+} // anonymous namespace
+
+LoraHeatmapRenderer::LoraHeatmapRenderer ()
+  : m_width (1024),
+    m_height (1024),
+    m_threads (0),
+    m_drawBuildings (true),
+    m_fixedArea (false),
+    m_xMin (0),
+    m_xMax (0),
+    m_yMin (0),
+    m_yMax (0)
+{
+}
+
+LoraHeatmapRenderer::~LoraHeatmapRenderer ()
+{
+}
+
+void
+LoraHeatmapRenderer::SetResolution (uint32_t width, uint32_t height)
+{
+  NS_ASSERT (width > 0 && height > 0);
+  m_width = width;
+  m_height = height;
+}
+
+void
+LoraHeatmapRenderer::SetArea (double xMin, double xMax, double yMin, double yMax)
+{
+  NS_ASSERT (xMax > xMin && yMax > yMin);
+  m_xMin = xMin;
+  m_xMax = xMax;
+  m_yMin = yMin;
+  m_yMax = yMax;
+  m_fixedArea = true;
+}
+
+void
+LoraHeatmapRenderer::SetThreads (uint32_t threads)
+{
+  m_threads = threads;
+}
+
+void
+LoraHeatmapRenderer::SetDrawBuildings (bool drawBuildings)
+{
+  m_drawBuildings = drawBuildings;
+}
+
+void
+LoraHeatmapRenderer::Render (std::string fileName, Ptr<LoraEnergyMonitor> monitor, Metric metric)
+{
+  NS_LOG_FUNCTION (this << fileName << metric);
+
+  //Extraction touches simulation objects, so it stays on this thread
+  std::vector<Sample> samples;
+  samples.reserve (monitor->GetN ());
+  double elapsedS = Simulator::Now ().GetSeconds ();
+  for (LoraEnergyMonitor::Iterator i = monitor->Begin (); i != monitor->End (); ++i)
+    {
+      NS_ASSERT (i->mobility != NULL);
+      Vector position = i->mobility->GetPosition ();
+      Sample sample;
+      sample.x = position.x;
+      sample.y = position.y;
+      switch (metric)
+        {
+        case CONSUMED_ENERGY:
+          sample.value = i->model->GetTotalEnergyConsumption ();
+          break;
+        case SPREADING_FACTOR:
+          NS_ASSERT (i->mac != NULL);
+          sample.value = i->mac->GetSfFromDataRate (i->mac->GetDataRate ());
+          break;
+        case PROJECTED_LIFETIME:
+          {
+            double consumedJ = i->model->GetTotalEnergyConsumption ();
+            if (consumedJ <= 0 || elapsedS <= 0)
+              {
+                //Nothing drawn yet, lifetime unknown
+                continue;
+              }
+            sample.value = i->source->GetRemainingEnergy () / (consumedJ / elapsedS) / SECONDS_PER_DAY;
+            break;
+          }
+        }
+      samples.push_back (sample);
+    }
+  Render (fileName, samples, metric);
+}
+
+void
+LoraHeatmapRenderer::Render (std::string fileName, const std::vector<Sample> &samples, Metric metric)
+{
+  NS_LOG_FUNCTION (this << fileName << samples.size ());
+  if (!m_fixedArea)
+    {
+      FitArea (samples);
+    }
+
+  std::vector<Cell> grid;
+  Bin (samples, grid);
+  std::vector<uint8_t> rgb;
+  Colour (grid, metric, rgb);
+  if (m_drawBuildings)
+    {
+      DrawBuildings (rgb);
+    }
+
+  std::string extension = fileName.size () >= 4 ? fileName.substr (fileName.size () - 4) : "";
+  if (extension == ".png")
+    {
+      WritePng (fileName, rgb);
+    }
+  else if (extension == ".ppm")
+    {
+      WritePpm (fileName, rgb);
+    }
+  else
+    {
+      NS_FATAL_ERROR ("Unknown image format: " << fileName);
+    }
+}
+
+void
+LoraHeatmapRenderer::FitArea (const std::vector<Sample> &samples)
+{
+  double inf = std::numeric_limits<double>::infinity ();
+  m_xMin = inf;
+  m_yMin = inf;
+  m_xMax = -inf;
+  m_yMax = -inf;
+  for (std::size_t i = 0; i < samples.size (); i++)
+    {
+      m_xMin = std::min (m_xMin, samples[i].x);
+      m_xMax = std::max (m_xMax, samples[i].x);
+      m_yMin = std::min (m_yMin, samples[i].y);
+      m_yMax = std::max (m_yMax, samples[i].y);
+    }
+  if (m_drawBuildings)
+    {
+      for (BuildingList::Iterator i = BuildingList::Begin (); i != BuildingList::End (); ++i)
+        {
+          Box box = (*i)->GetBoundaries ();
+          m_xMin = std::min (m_xMin, box.xMin);
+          m_xMax = std::max (m_xMax, box.xMax);
+          m_yMin = std::min (m_yMin, box.yMin);
+          m_yMax = std::max (m_yMax, box.yMax);
+        }
+    }
+  if (m_xMin > m_xMax)
+    {
+      //Nothing to draw
+      m_xMin = m_yMin = 0;
+      m_xMax = m_yMax = 1;
+    }
+  //Avoid a degenerate area with a single device
+  if (m_xMax - m_xMin <= 0)
+    {
+      m_xMin -= 0.5;
+      m_xMax += 0.5;
+    }
+  if (m_yMax - m_yMin <= 0)
+    {
+      m_yMin -= 0.5;
+      m_yMax += 0.5;
+    }
+}
+
+void
+LoraHeatmapRenderer::Bin (const std::vector<Sample> &samples, std::vector<Cell> &grid) const
+{
+  uint32_t threads = m_threads > 0 ? m_threads : std::thread::hardware_concurrency ();
+  threads = std::max (1u, std::min<uint32_t> (threads, samples.size () / 4096 + 1));
+  //Each thread owns a band of rows, at least one row each
+  threads = std::min (threads, m_height);
+  Cell empty = { 0, 0 };
+  grid.assign (static_cast<std::size_t> (m_width) * m_height, empty);
+
+  //Threads scan all samples and only accumulate into the rows of their
+  //band, so the single grid is shared without locks or a merge
+  std::vector<std::thread> workers;
+  double xScale = m_width / (m_xMax - m_xMin);
+  double yScale = m_height / (m_yMax - m_yMin);
+  for (uint32_t t = 0; t < threads; t++)
+    {
+      uint32_t firstRow = static_cast<uint64_t> (m_height) * t / threads;
+      uint32_t endRow = static_cast<uint64_t> (m_height) * (t + 1) / threads;
+      workers.push_back (std::thread ([&, firstRow, endRow, xScale, yScale]
+      {
+        for (std::size_t i = 0; i < samples.size (); i++)
+          {
+            const Sample &s = samples[i];
+            if (s.x < m_xMin || s.x > m_xMax || s.y < m_yMin || s.y > m_yMax)
+              {
+                continue;
+              }
+            //Image rows grow downwards, y grows upwards
+            uint32_t py = std::min<uint32_t> (m_height - 1, (s.y - m_yMin) * yScale);
+            uint32_t row = m_height - 1 - py;
+            if (row < firstRow || row >= endRow)
+              {
+                continue;
+              }
+            uint32_t px = std::min<uint32_t> (m_width - 1, (s.x - m_xMin) * xScale);
+            Cell &cell = grid[static_cast<std::size_t> (row) * m_width + px];
+            cell.sum += s.value;
+            cell.count++;
+          }
+      }));
+    }
+  for (uint32_t t = 0; t < threads; t++)
+    {
+      workers[t].join ();
+    }
+}
+
+void
+LoraHeatmapRenderer::Colour (const std::vector<Cell> &grid, Metric metric, std::vector<uint8_t> &rgb) const
+{
+  //Colour range, fixed for SF, from the cell means otherwise
+  double low = MIN_SF;
+  double high = MAX_SF;
+  if (metric != SPREADING_FACTOR)
+    {
+      low = std::numeric_limits<double>::infinity ();
+      high = -low;
+      for (std::size_t c = 0; c < grid.size (); c++)
+        {
+          if (grid[c].count > 0)
+            {
+              double mean = grid[c].sum / grid[c].count;
+              low = std::min (low, mean);
+              high = std::max (high, mean);
+            }
+        }
+    }
+  NS_LOG_INFO ("Heatmap metric " << metric << " range [" << low << ", " << high << "]");
+  double span = high > low ? high - low : 1;
+
+  rgb.assign (grid.size () * 3, EMPTY_CELL_GREY);
+  for (std::size_t c = 0; c < grid.size (); c++)
+    {
+      if (grid[c].count > 0)
+        {
+          MapColour ((grid[c].sum / grid[c].count - low) / span, &rgb[c * 3]);
+        }
+    }
+}
+
+void
+LoraHeatmapRenderer::DrawLine (std::vector<uint8_t> &rgb, int x0, int y0, int x1, int y1) const
+{
+  //Bresenham, clipped per pixel
+  int dx = std::abs (x1 - x0), sx = x0 < x1 ? 1 : -1;
+  int dy = -std::abs (y1 - y0), sy = y0 < y1 ? 1 : -1;
+  int err = dx + dy;
+  while (true)
+    {
+      if (x0 >= 0 && y0 >= 0 && x0 < static_cast<int> (m_width) && y0 < static_cast<int> (m_height))
+        {
+          std::size_t p = (static_cast<std::size_t> (y0) * m_width + x0) * 3;
+          rgb[p] = rgb[p + 1] = rgb[p + 2] = 0;
+        }
+      if (x0 == x1 && y0 == y1)
+        {
+          break;
+        }
+      int e2 = 2 * err;
+      if (e2 >= dy)
+        {
+          err += dy;
+          x0 += sx;
+        }
+      if (e2 <= dx)
+        {
+          err += dx;
+          y0 += sy;
+        }
+    }
+}
+
+void
+LoraHeatmapRenderer::DrawBuildings (std::vector<uint8_t> &rgb) const
+{
+  double xScale = m_width / (m_xMax - m_xMin);
+  double yScale = m_height / (m_yMax - m_yMin);
+  for (BuildingList::Iterator i = BuildingList::Begin (); i != BuildingList::End (); ++i)
+    {
+      Box box = (*i)->GetBoundaries ();
+      int x0 = static_cast<int> ((box.xMin - m_xMin) * xScale);
+      int x1 = static_cast<int> ((box.xMax - m_xMin) * xScale);
+      int y0 = static_cast<int> (m_height - 1 - (box.yMin - m_yMin) * yScale);
+      int y1 = static_cast<int> (m_height - 1 - (box.yMax - m_yMin) * yScale);
+      DrawLine (rgb, x0, y0, x1, y0);
+      DrawLine (rgb, x1, y0, x1, y1);
+      DrawLine (rgb, x1, y1, x0, y1);
+      DrawLine (rgb, x0, y1, x0, y0);
+    }
+}
+
+void
+LoraHeatmapRenderer::WritePpm (std::string fileName, const std::vector<uint8_t> &rgb) const
+{
+  std::ofstream file (fileName.c_str (), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+  NS_ASSERT (file.is_open () == true);
+  file << "P6\n" << m_width << " " << m_height << "\n255\n";
+  file.write (reinterpret_cast<const char *> (&rgb[0]), rgb.size ());
+}
+
+void
+LoraHeatmapRenderer::WritePng (std::string fileName, const std::vector<uint8_t> &rgb) const
+{
+  std::ofstream file (fileName.c_str (), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+  NS_ASSERT (file.is_open () == true);
+  static const uint8_t signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+  file.write (reinterpret_cast<const char *> (signature), 8);
+
+  //Header: 8 bit RGB, no interlace
+  std::vector<uint8_t> header;
+  PutBigEndian (header, m_width);
+  PutBigEndian (header, m_height);
+  header.push_back (8);
+  header.push_back (2);
+  header.push_back (0);
+  header.push_back (0);
+  header.push_back (0);
+  WriteChunk (file, "IHDR", header);
+
+  //Scanlines with filter type 0
+  std::size_t stride = static_cast<std::size_t> (m_width) * 3;
+  std::vector<uint8_t> raw;
+  raw.reserve ((stride + 1) * m_height);
+  for (uint32_t y = 0; y < m_height; y++)
+    {
+      raw.push_back (0);
+      raw.insert (raw.end (), rgb.begin () + y * stride, rgb.begin () + (y + 1) * stride);
+    }
+
+  //zlib stream of stored deflate blocks and Adler-32
+  std::vector<uint8_t> zlib;
+  zlib.reserve (raw.size () + raw.size () / PNG_STORED_BLOCK * 5 + 16);
+  zlib.push_back (0x78);
+  zlib.push_back (0x01);
+  std::size_t position = 0;
+  do
+    {
+      std::size_t length = std::min<std::size_t> (PNG_STORED_BLOCK, raw.size () - position);
+      bool last = position + length == raw.size ();
+      zlib.push_back (last ? 1 : 0);
+      zlib.push_back (length & 0xFF);
+      zlib.push_back (length >> 8);
+      zlib.push_back (~length & 0xFF);
+      zlib.push_back ((~length >> 8) & 0xFF);
+      zlib.insert (zlib.end (), raw.begin () + position, raw.begin () + position + length);
+      position += length;
+    }
+  while (position < raw.size ());
+  uint32_t a = 1, b = 0;
+  for (std::size_t i = 0; i < raw.size (); i++)
+    {
+      a = (a + raw[i]) % 65521;
+      b = (b + a) % 65521;
+    }
+  PutBigEndian (zlib, (b << 16) | a);
+  WriteChunk (file, "IDAT", zlib);
+  WriteChunk (file, "IEND", std::vector<uint8_t> ());
+}
+
+} // namespace ns3
@@ -0,0 +1,102 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#ifndef LORA_HEATMAP_RENDERER_H
+#define LORA_HEATMAP_RENDERER_H
+
+#include "ns3/lora-energy-monitor.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup energy
+ *
+ * \brief Raster energy map of the end devices, without gnuplot
+ *
+ * Devices are binned into a width x height grid by several threads (one
+ * band of rows each, no private grids) and every cell is coloured by the
+ * mean of the chosen metric. Building footprints are drawn on top. The
+ * image is written as binary PPM or as PNG (uncompressed deflate blocks,
+ * no zlib dependency), chosen by the file extension.
+ */
+class LoraHeatmapRenderer
+{
+public:
+  enum Metric
+  {
+    CONSUMED_ENERGY,     //J
+    SPREADING_FACTOR,    //7..12
+    PROJECTED_LIFETIME   //days, at the mean power drawn so far
+  };
+
+  //One device already reduced to position and metric value
+  struct Sample
+  {
+    double x;
+    double y;
+    double value;
+  };
+
+  LoraHeatmapRenderer ();
+  ~LoraHeatmapRenderer ();
+
+  void SetResolution (uint32_t width, uint32_t height);
+  //Area covered by the image, by default the bounding box of devices and buildings
+  void SetArea (double xMin, double xMax, double yMin, double yMax);
+  //Binning threads, 0 uses all hardware threads (at most one per row)
+  void SetThreads (uint32_t threads);
+  void SetDrawBuildings (bool drawBuildings);
+
+  //Render the devices of the monitor, ".png" or ".ppm" file
+  void Render (std::string fileName, Ptr<LoraEnergyMonitor> monitor, Metric metric);
+  //Render already extracted samples
+  void Render (std::string fileName, const std::vector<Sample> &samples, Metric metric);
+
+private:
+  //Sum and count per cell
+  struct Cell
+  {
+    double sum;
+    uint32_t count;
+  };
+
+  void FitArea (const std::vector<Sample> &samples);
+  void Bin (const std::vector<Sample> &samples, std::vector<Cell> &grid) const;
+  void Colour (const std::vector<Cell> &grid, Metric metric, std::vector<uint8_t> &rgb) const;
+  void DrawBuildings (std::vector<uint8_t> &rgb) const;
+  void DrawLine (std::vector<uint8_t> &rgb, int x0, int y0, int x1, int y1) const;
+  void WritePpm (std::string fileName, const std::vector<uint8_t> &rgb) const;
+  void WritePng (std::string fileName, const std::vector<uint8_t> &rgb) const;
+
+  uint32_t m_width;
+  uint32_t m_height;
+  uint32_t m_threads;
+  bool m_drawBuildings;
+  bool m_fixedArea;
+  double m_xMin;
+  double m_xMax;
+  double m_yMin;
+  double m_yMax;
+};
+
+} // namespace ns3
+
+#endif /* LORA_HEATMAP_RENDERER_H */
@@ -0,0 +1,108 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#ifndef LORA_LAZY_TRACE_H
+#define LORA_LAZY_TRACE_H
+
+#include "ns3/trace-source-accessor.h"
+#include "ns3/traced-callback.h"
+#include "ns3/object-base.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup energy
+ *
+ * \brief Accessor of a trace source allocated on its first connection
+ *
+ * Same callback signature as a TracedValue<double> trace source
+ * (ns3::TracedValueCallback::Double), but the owner only keeps a pointer
+ * until somebody connects: the getter allocates the TracedCallback and the
+ * owner fires it only if it exists. Used for per-device trace sources that
+ * are rarely connected.
+ */
+template <typename T>
+class LoraLazyTraceAccessor : public TraceSourceAccessor
+{
+public:
+  //Returns the trace of the object, allocating it if needed
+  typedef TracedCallback<double, double> & (*Getter) (T *object);
+
+  LoraLazyTraceAccessor (Getter getter)
+    : m_getter (getter)
+  {
+  }
+
+  virtual bool ConnectWithoutContext (ObjectBase *obj, const CallbackBase &cb) const
+  {
+    T *object = dynamic_cast<T *> (obj);
+    if (object == 0)
+      {
+        return false;
+      }
+    m_getter (object).ConnectWithoutContext (cb);
+    return true;
+  }
+
+  virtual bool Connect (ObjectBase *obj, std::string context, const CallbackBase &cb) const
+  {
+    T *object = dynamic_cast<T *> (obj);
+    if (object == 0)
+      {
+        return false;
+      }
+    m_getter (object).Connect (cb, context);
+    return true;
+  }
+
+  virtual bool DisconnectWithoutContext (ObjectBase *obj, const CallbackBase &cb) const
+  {
+    T *object = dynamic_cast<T *> (obj);
+    if (object == 0)
+      {
+        return false;
+      }
+    m_getter (object).DisconnectWithoutContext (cb);
+    return true;
+  }
+
+  virtual bool Disconnect (ObjectBase *obj, std::string context, const CallbackBase &cb) const
+  {
+    T *object = dynamic_cast<T *> (obj);
+    if (object == 0)
+      {
+        return false;
+      }
+    m_getter (object).Disconnect (cb, context);
+    return true;
+  }
+
+private:
+  Getter m_getter;
+};
+
+template <typename T>
+Ptr<const TraceSourceAccessor>
+MakeLoraLazyTraceAccessor (TracedCallback<double, double> & (*getter) (T *object))
+{
+  return Ptr<const TraceSourceAccessor> (new LoraLazyTraceAccessor<T> (getter), false);
+}
+
+} // namespace ns3
+
+#endif /* LORA_LAZY_TRACE_H */
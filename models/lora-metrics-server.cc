@@ -0,0 +1,390 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#include "lora-metrics-server.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "ns3/string.h"
+#include "ns3/lora-counting-scheduler.h"
+#include "ns3/lora-process-info.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LoraMetricsServer");
+
+NS_OBJECT_ENSURE_REGISTERED (LoraMetricsServer);
+
+TypeId
+LoraMetricsServer::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LoraMetricsServer")
+    .SetParent<Object> ()
+    .SetGroupName ("Energy")
+    .AddConstructor<LoraMetricsServer> ()
+    .AddAttribute ("Port",
+                   "TCP port on 127.0.0.1 (unused if SocketPath is set).",
+                   UintegerValue (9464),
+                   MakeUintegerAccessor (&LoraMetricsServer::m_port),
+                   MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("SocketPath",
+                   "Unix socket path, empty to listen on TCP.",
+                   StringValue (""),
+                   MakeStringAccessor (&LoraMetricsServer::m_socketPath),
+                   MakeStringChecker ())
+    .AddAttribute ("Interval",
+                   "Simulation time between two samples of the counters.",
+                   TimeValue (Seconds (10)),
+                   MakeTimeAccessor (&LoraMetricsServer::m_interval),
+                   MakeTimeChecker ())
+  ;
+  return tid;
+}
+
+LoraMetricsServer::LoraMetricsServer ()
+  : m_port (9464),
+    m_interval (Seconds (10)),
+    m_lastEvents (0),
+    m_events (0),
+    m_eventsPerSecond (0),
+    m_simTimeS (0),
+    m_speedRatio (0),
+    m_nodes (0),
+    m_meanSoc (0),
+    m_minSoc (0),
+    m_depleted (0),
+    m_fleetRequested (false),
+    m_listenFd (-1),
+    m_stop (false)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+LoraMetricsServer::~LoraMetricsServer ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+LoraMetricsServer::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  Stop ();
+  m_monitor = 0;
+  Object::DoDispose ();
+}
+
+void
+LoraMetricsServer::SetMonitor (Ptr<LoraEnergyMonitor> monitor)
+{
+  m_monitor = monitor;
+}
+
+int
+LoraMetricsServer::OpenSocket (void)
+{
+  int fd;
+  if (!m_socketPath.empty ())
+    {
+      struct sockaddr_un address;
+      memset (&address, 0, sizeof (address));
+      address.sun_family = AF_UNIX;
+      if (m_socketPath.size () >= sizeof (address.sun_path))
+        {
+          NS_LOG_WARN ("Socket path too long: " << m_socketPath);
+          return -1;
+        }
+      strcpy (address.sun_path, m_socketPath.c_str ());
+      unlink (m_socketPath.c_str ());
+      fd = socket (AF_UNIX, SOCK_STREAM, 0);
+      if (fd < 0 || bind (fd, reinterpret_cast<struct sockaddr *> (&address), sizeof (address)) != 0)
+        {
+          NS_LOG_WARN ("Cannot bind " << m_socketPath << ": " << strerror (errno));
+          if (fd >= 0)
+            {
+              close (fd);
+            }
+          return -1;
+        }
+    }
+  else
+    {
+      struct sockaddr_in address;
+      memset (&address, 0, sizeof (address));
+      address.sin_family = AF_INET;
+      address.sin_port = htons (m_port);
+      address.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+      fd = socket (AF_INET, SOCK_STREAM, 0);
+      int reuse = 1;
+      if (fd >= 0)
+        {
+          setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof (reuse));
+        }
+      if (fd < 0 || bind (fd, reinterpret_cast<struct sockaddr *> (&address), sizeof (address)) != 0)
+        {
+          NS_LOG_WARN ("Cannot bind 127.0.0.1:" << m_port << ": " << strerror (errno));
+          if (fd >= 0)
+            {
+              close (fd);
+            }
+          return -1;
+        }
+    }
+  if (listen (fd, 4) != 0)
+    {
+      close (fd);
+      return -1;
+    }
+  return fd;
+}
+
+bool
+LoraMetricsServer::Start (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!m_server.joinable ());
+  m_listenFd = OpenSocket ();
+  if (m_listenFd < 0)
+    {
+      return false;
+    }
+
+  m_startWall = std::chrono::steady_clock::now ();
+  m_lastWall = m_startWall;
+  m_lastEvents = Simulator::GetEventCount ();
+  m_lastSimTime = Simulator::Now ();
+  //First sample, before the server thread can answer a scrape
+  m_events.store (m_lastEvents, std::memory_order_relaxed);
+  m_simTimeS.store (m_lastSimTime.GetSeconds (), std::memory_order_relaxed);
+  SampleFleet ();
+
+  m_stop.store (false);
+  m_server = std::thread (&LoraMetricsServer::ServerLoop, this);
+  m_sampleEvent = Simulator::Schedule (m_interval, &LoraMetricsServer::Sample, this);
+  if (m_socketPath.empty ())
+    {
+      NS_LOG_INFO ("Metrics on http://127.0.0.1:" << m_port << "/metrics");
+    }
+  else
+    {
+      NS_LOG_INFO ("Metrics on unix socket " << m_socketPath);
+    }
+  return true;
+}
+
+void
+LoraMetricsServer::Stop (void)
+{
+  NS_LOG_FUNCTION (this);
+  Simulator::Cancel (m_sampleEvent);
+  m_stop.store (true);
+  if (m_server.joinable ())
+    {
+      m_server.join ();
+    }
+  if (m_listenFd >= 0)
+    {
+      close (m_listenFd);
+      m_listenFd = -1;
+      if (!m_socketPath.empty ())
+        {
+          unlink (m_socketPath.c_str ());
+        }
+    }
+}
+
+void
+LoraMetricsServer::Sample (void)
+{
+  if (m_stop.load ())
+    {
+      return;
+    }
+  std::chrono::steady_clock::time_point wall = std::chrono::steady_clock::now ();
+  uint64_t events = Simulator::GetEventCount ();
+  Time now = Simulator::Now ();
+
+  double wallS = std::chrono::duration<double> (wall - m_lastWall).count ();
+  if (wallS > 0)
+    {
+      m_eventsPerSecond.store ((events - m_lastEvents) / wallS, std::memory_order_relaxed);
+      m_speedRatio.store ((now - m_lastSimTime).GetSeconds () / wallS, std::memory_order_relaxed);
+    }
+  m_events.store (events, std::memory_order_relaxed);
+  m_simTimeS.store (now.GetSeconds (), std::memory_order_relaxed);
+  m_lastWall = wall;
+  m_lastEvents = events;
+  m_lastSimTime = now;
+
+  if (m_fleetRequested.exchange (false))
+    {
+      SampleFleet ();
+    }
+  m_sampleEvent = Simulator::Schedule (m_interval, &LoraMetricsServer::Sample, this);
+}
+
+void
+LoraMetricsServer::SampleFleet (void)
+{
+  if (m_monitor == 0 || m_monitor->GetN () == 0)
+    {
+      return;
+    }
+  double sum = 0;
+  double minimum = std::numeric_limits<double>::infinity ();
+  uint64_t depleted = 0;
+  for (LoraEnergyMonitor::Iterator i = m_monitor->Begin (); i != m_monitor->End (); ++i)
+    {
+      double soc = i->source->GetEnergyFraction ();
+      sum += soc;
+      minimum = std::min (minimum, soc);
+      depleted += i->source->IsDepleted () ? 1 : 0;
+    }
+  m_nodes.store (m_monitor->GetN (), std::memory_order_relaxed);
+  m_meanSoc.store (sum / m_monitor->GetN (), std::memory_order_relaxed);
+  m_minSoc.store (minimum, std::memory_order_relaxed);
+  m_depleted.store (depleted, std::memory_order_relaxed);
+}
+
+std::string
+LoraMetricsServer::Render (void) const
+{
+  std::ostringstream out;
+  out << "# HELP lora_sim_events_total Events executed by the simulator.\n"
+      << "# TYPE lora_sim_events_total counter\n"
+      << "lora_sim_events_total " << m_events.load (std::memory_order_relaxed) << "\n"
+      << "# HELP lora_sim_events_per_second Events executed per wall-clock second.\n"
+      << "# TYPE lora_sim_events_per_second gauge\n"
+      << "lora_sim_events_per_second " << m_eventsPerSecond.load (std::memory_order_relaxed) << "\n"
+      << "# HELP lora_sim_time_seconds Current simulation time.\n"
+      << "# TYPE lora_sim_time_seconds gauge\n"
+      << "lora_sim_time_seconds " << m_simTimeS.load (std::memory_order_relaxed) << "\n"
+      << "# HELP lora_sim_speed_ratio Simulation seconds per wall-clock second.\n"
+      << "# TYPE lora_sim_speed_ratio gauge\n"
+      << "lora_sim_speed_ratio " << m_speedRatio.load (std::memory_order_relaxed) << "\n";
+  if (LoraCountingScheduler::IsInstalled ())
+    {
+      out << "# HELP lora_sim_pending_events Events waiting in the event queue.\n"
+          << "# TYPE lora_sim_pending_events gauge\n"
+          << "lora_sim_pending_events " << LoraCountingScheduler::GetPendingEvents () << "\n";
+    }
+  if (m_nodes.load (std::memory_order_relaxed) > 0)
+    {
+      out << "# HELP lora_fleet_nodes End devices with an energy model.\n"
+          << "# TYPE lora_fleet_nodes gauge\n"
+          << "lora_fleet_nodes " << m_nodes.load (std::memory_order_relaxed) << "\n"
+          << "# HELP lora_fleet_soc_mean Mean state of charge of the fleet (0-1).\n"
+          << "# TYPE lora_fleet_soc_mean gauge\n"
+          << "lora_fleet_soc_mean " << m_meanSoc.load (std::memory_order_relaxed) << "\n"
+          << "# HELP lora_fleet_soc_min Lowest state of charge of the fleet (0-1).\n"
+          << "# TYPE lora_fleet_soc_min gauge\n"
+          << "lora_fleet_soc_min " << m_minSoc.load (std::memory_order_relaxed) << "\n"
+          << "# HELP lora_fleet_depleted_nodes End devices below the low battery threshold.\n"
+          << "# TYPE lora_fleet_depleted_nodes gauge\n"
+          << "lora_fleet_depleted_nodes " << m_depleted.load (std::memory_order_relaxed) << "\n";
+    }
+  out << "# HELP process_resident_memory_bytes Resident memory size.\n"
+      << "# TYPE process_resident_memory_bytes gauge\n"
+      << "process_resident_memory_bytes " << LoraProcessInfo::GetResidentBytes () << "\n"
+      << "# HELP process_peak_resident_memory_bytes Peak resident memory size.\n"
+      << "# TYPE process_peak_resident_memory_bytes gauge\n"
+      << "process_peak_resident_memory_bytes " << LoraProcessInfo::GetPeakResidentBytes () << "\n";
+  return out.str ();
+}
+
+void
+LoraMetricsServer::ServerLoop (void)
+{
+  while (!m_stop.load ())
+    {
+      //Short timeout so that Stop is noticed
+      struct pollfd listening = { m_listenFd, POLLIN, 0 };
+      if (poll (&listening, 1, 200) <= 0)
+        {
+          continue;
+        }
+      int client = accept (m_listenFd, 0, 0);
+      if (client < 0)
+        {
+          continue;
+        }
+      struct timeval timeout = { 1, 0 };
+      setsockopt (client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof (timeout));
+
+      //Read the request head, only the request line matters
+      char request[2048];
+      std::size_t length = 0;
+      while (length < sizeof (request) - 1)
+        {
+          ssize_t n = recv (client, request + length, sizeof (request) - 1 - length, 0);
+          if (n <= 0)
+            {
+              break;
+            }
+          length += n;
+          request[length] = '\0';
+          if (strstr (request, "\r\n\r\n") != 0 || strstr (request, "\n\n") != 0)
+            {
+              break;
+            }
+        }
+      request[length] = '\0';
+
+      std::string response;
+      if (strncmp (request, "GET /metrics", 12) == 0 || strncmp (request, "GET / ", 6) == 0)
+        {
+          std::string body = Render ();
+          std::ostringstream head;
+          head << "HTTP/1.0 200 OK\r\n"
+               << "Content-Type: text/plain; version=0.0.4\r\n"
+               << "Content-Length: " << body.size () << "\r\n"
+               << "Connection: close\r\n\r\n";
+          response = head.str () + body;
+          m_fleetRequested.store (true);
+        }
+      else
+        {
+          response = "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        }
+
+      std::size_t sent = 0;
+      while (sent < response.size ())
+        {
+          ssize_t n = send (client, response.data () + sent, response.size () - sent, MSG_NOSIGNAL);
+          if (n <= 0)
+            {
+              break;
+            }
+          sent += n;
+        }
+      close (client);
+    }
+}
+
+} // namespace ns3
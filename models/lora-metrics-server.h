@@ -0,0 +1,100 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#ifndef LORA_METRICS_SERVER_H
+#define LORA_METRICS_SERVER_H
+
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/lora-energy-monitor.h"
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace ns3 {
+
+/**
+ * \ingroup energy
+ *
+ * \brief Live Prometheus metrics of a running simulation
+ *
+ * A side thread serves the Prometheus text format over HTTP, on localhost
+ * Port or, if SocketPath is set, on a unix socket. Every Interval of
+ * simulation time the event loop stores the simulator counters in atomics
+ * (events/s, sim/wall speed, pending events when LoraCountingScheduler is
+ * installed). The fleet state of charge and depleted count need a pass
+ * over the monitor, so they are only recomputed after a scrape asked for
+ * them: with nobody scraping the cost is one cheap event per Interval.
+ */
+class LoraMetricsServer : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+  LoraMetricsServer ();
+  virtual ~LoraMetricsServer ();
+
+  void SetMonitor (Ptr<LoraEnergyMonitor> monitor);
+
+  //Bind the socket, start the server thread and the sampling
+  bool Start (void);
+  //Stop the sampling and join the server thread
+  void Stop (void);
+
+private:
+  void DoDispose (void);
+  void Sample (void);
+  void SampleFleet (void);
+  int OpenSocket (void);
+  void ServerLoop (void);
+  std::string Render (void) const;
+
+  uint16_t m_port;
+  std::string m_socketPath;
+  Time m_interval;
+  Ptr<LoraEnergyMonitor> m_monitor;
+  EventId m_sampleEvent;
+
+  //Previous sample, simulation thread only
+  std::chrono::steady_clock::time_point m_startWall;
+  std::chrono::steady_clock::time_point m_lastWall;
+  uint64_t m_lastEvents;
+  Time m_lastSimTime;
+
+  //Written by the simulation thread, read by the server thread
+  std::atomic<uint64_t> m_events;
+  std::atomic<double> m_eventsPerSecond;
+  std::atomic<double> m_simTimeS;
+  std::atomic<double> m_speedRatio;
+  std::atomic<uint64_t> m_nodes;
+  std::atomic<double> m_meanSoc;
+  std::atomic<double> m_minSoc;
+  std::atomic<uint64_t> m_depleted;
+  //Set by the server thread, fleet refreshed on the next sample
+  std::atomic<bool> m_fleetRequested;
+
+  int m_listenFd;
+  std::thread m_server;
+  std::atomic<bool> m_stop;
+};
+
+} // namespace ns3
+
+#endif /* LORA_METRICS_SERVER_H */
@@ -0,0 +1,144 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#ifndef LORA_OBJECT_POOL_H
+#define LORA_OBJECT_POOL_H
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup energy
+ *
+ * \brief Pooled arena for fixed-size per-device energy objects
+ *
+ * Used through class-specific operator new/delete, so objects created by
+ * CreateObject/ObjectFactory and released by Ptr are served from large
+ * blocks instead of one heap allocation each. Freed slots are reused, but
+ * blocks are never returned to the heap since objects may outlive static
+ * destructors. Requests of any other size (e.g. derived classes) go to the
+ * global heap. Not thread-safe, like the rest of the simulation core.
+ */
+template <typename T>
+class LoraObjectPool
+{
+public:
+  //Make sure n objects can be served without further heap allocations
+  static void Reserve (std::size_t n)
+  {
+    State &state = GetState ();
+    if (n > state.freeSlots)
+      {
+        AddBlock (n - state.freeSlots);
+      }
+  }
+
+  static void * Allocate (std::size_t size)
+  {
+    if (size != sizeof (T))
+      {
+        return ::operator new (size);
+      }
+    State &state = GetState ();
+    if (state.freeList == 0)
+      {
+        //Grow geometrically to keep the number of blocks small
+        AddBlock (state.capacity > 0 ? state.capacity : 64);
+      }
+    Slot *slot = state.freeList;
+    state.freeList = slot->next;
+    state.freeSlots--;
+    return slot;
+  }
+
+  static void Release (void *p, std::size_t size)
+  {
+    if (p == 0)
+      {
+        return;
+      }
+    if (size != sizeof (T))
+      {
+        ::operator delete (p);
+        return;
+      }
+    State &state = GetState ();
+    Slot *slot = static_cast<Slot *> (p);
+    slot->next = state.freeList;
+    state.freeList = slot;
+    state.freeSlots++;
+  }
+
+  //Number of slots allocated in the arena
+  static std::size_t GetCapacity (void)
+  {
+    return GetState ().capacity;
+  }
+
+  //Number of slots currently in use
+  static std::size_t GetInUse (void)
+  {
+    State &state = GetState ();
+    return state.capacity - state.freeSlots;
+  }
+
+private:
+  union Slot
+  {
+    Slot *next;
+    alignas (T) unsigned char storage[sizeof (T)];
+  };
+
+  struct State
+  {
+    State () : freeList (0), freeSlots (0), capacity (0)
+    {
+    }
+    Slot *freeList;
+    std::size_t freeSlots;
+    std::size_t capacity;
+    std::vector<Slot *> blocks;
+  };
+
+  static State & GetState (void)
+  {
+    static State state;
+    return state;
+  }
+
+  static void AddBlock (std::size_t slots)
+  {
+    State &state = GetState ();
+    Slot *block = static_cast<Slot *> (::operator new (slots * sizeof (Slot)));
+    state.blocks.push_back (block);
+    for (std::size_t i = 0; i < slots; i++)
+      {
+        block[i].next = state.freeList;
+        state.freeList = &block[i];
+      }
+    state.freeSlots += slots;
+    state.capacity += slots;
+  }
+};
+
+} //namespace ns3
+
+#endif /* LORA_OBJECT_POOL_H */
@@ -0,0 +1,242 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#include "lora-parallel-setup.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/building.h"
+#include "ns3/building-list.h"
+#include "ns3/mobility-model.h"
+#include "ns3/mobility-building-info.h"
+#include "ns3/rng-seed-manager.h"
+#include "ns3/lora-counter-rng.h"
+#include "ns3/lora-building-export.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LoraParallelSetup");
+
+namespace {
+
+//Keeps position streams away from the node-id streams of other draws
+const uint32_t POSITION_STREAM_BASE = 0x80000000;
+//Draws per node before giving up (counter = node << 16 | attempt)
+const uint32_t MAX_ATTEMPTS = 0xFFFF;
+
+//Run fn (begin, end) on contiguous ranges of [0, n), one per thread
+template <typename Function>
+void
+ParallelFor (uint32_t n, uint32_t threads, Function fn)
+{
+  if (threads <= 1)
+    {
+      fn (0, n);
+      return;
+    }
+  std::vector<std::thread> workers;
+  for (uint32_t t = 0; t < threads; t++)
+    {
+      uint32_t begin = static_cast<uint64_t> (n) * t / threads;
+      uint32_t end = static_cast<uint64_t> (n) * (t + 1) / threads;
+      workers.push_back (std::thread (fn, begin, end));
+    }
+  for (uint32_t t = 0; t < threads; t++)
+    {
+      workers[t].join ();
+    }
+}
+
+double
+ToUnit (uint32_t word)
+{
+  return (static_cast<double> (word) + 0.5) / 4294967296.0;
+}
+
+//Result of the membership search of one node
+struct Membership
+{
+  int32_t building;
+  uint16_t floor;
+  uint16_t roomX;
+  uint16_t roomY;
+};
+
+} // namespace
+
+uint64_t
+LoraParallelSetup::GetSeed (uint64_t seed)
+{
+  if (seed == 0)
+    {
+      seed = (static_cast<uint64_t> (RngSeedManager::GetSeed ()) << 32) ^ RngSeedManager::GetRun ();
+    }
+  return seed;
+}
+
+uint32_t
+LoraParallelSetup::GetThreads (uint32_t threads, uint32_t n)
+{
+  if (threads == 0)
+    {
+      threads = std::max (1u, std::thread::hardware_concurrency ());
+    }
+  return std::max (1u, std::min (threads, n));
+}
+
+Ptr<ListPositionAllocator>
+LoraParallelSetup::OutdoorPositions (uint32_t n, const Box &area, uint64_t seed,
+                                     uint32_t stream, uint32_t threads)
+{
+  NS_LOG_FUNCTION (n << seed << stream << threads);
+  const std::vector<Box> buildings = LoraBuildingExport::GetBoxes ();
+  const LoraCounterRng rng (GetSeed (seed), POSITION_STREAM_BASE + stream);
+  std::vector<Vector> positions (n);
+
+  ParallelFor (n, GetThreads (threads, n), [&] (uint32_t begin, uint32_t end)
+    {
+      for (uint32_t i = begin; i < end; i++)
+        {
+          bool outside = false;
+          for (uint32_t attempt = 0; attempt < MAX_ATTEMPTS && !outside; attempt++)
+            {
+              uint32_t words[4];
+              rng.Generate ((static_cast<uint64_t> (i) << 16) | attempt, words);
+              Vector p (area.xMin + ToUnit (words[0]) * (area.xMax - area.xMin),
+                        area.yMin + ToUnit (words[1]) * (area.yMax - area.yMin),
+                        area.zMin + ToUnit (words[2]) * (area.zMax - area.zMin));
+              outside = true;
+              for (uint32_t b = 0; b < buildings.size () && outside; b++)
+                {
+                  outside = !buildings[b].IsInside (p);
+                }
+              positions[i] = p;
+            }
+          NS_ASSERT_MSG (outside, "No outdoor position found, area covered by buildings");
+        }
+    });
+
+  Ptr<ListPositionAllocator> allocator = CreateObject<ListPositionAllocator> ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      allocator->Add (positions[i]);
+    }
+  return allocator;
+}
+
+Ptr<ListPositionAllocator>
+LoraParallelSetup::IndoorPositions (uint32_t n, uint64_t seed, uint32_t stream, uint32_t threads)
+{
+  NS_LOG_FUNCTION (n << seed << stream << threads);
+  const std::vector<Box> buildings = LoraBuildingExport::GetBoxes ();
+  if (buildings.empty ())
+    {
+      NS_FATAL_ERROR ("Indoor positions requested without buildings");
+    }
+  const LoraCounterRng rng (GetSeed (seed), POSITION_STREAM_BASE + stream);
+  std::vector<Vector> positions (n);
+
+  ParallelFor (n, GetThreads (threads, n), [&] (uint32_t begin, uint32_t end)
+    {
+      for (uint32_t i = begin; i < end; i++)
+        {
+          uint32_t words[4];
+          rng.Generate (static_cast<uint64_t> (i) << 16, words);
+          uint32_t b = std::min<uint32_t> (ToUnit (words[0]) * buildings.size (), buildings.size () - 1);
+          const Box &box = buildings[b];
+          positions[i] = Vector (box.xMin + ToUnit (words[1]) * (box.xMax - box.xMin),
+                                 box.yMin + ToUnit (words[2]) * (box.yMax - box.yMin),
+                                 box.zMin + ToUnit (words[3]) * (box.zMax - box.zMin));
+        }
+    });
+
+  Ptr<ListPositionAllocator> allocator = CreateObject<ListPositionAllocator> ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      allocator->Add (positions[i]);
+    }
+  return allocator;
+}
+
+void
+LoraParallelSetup::MakeMobilityModelConsistent (NodeContainer nodes, uint32_t threads)
+{
+  NS_LOG_FUNCTION (nodes.GetN () << threads);
+  uint32_t n = nodes.GetN ();
+
+  //Snapshot on this thread: raw pointers, the Ptr counts are not atomic
+  std::vector<Building *> buildings;
+  buildings.reserve (BuildingList::GetNBuildings ());
+  for (BuildingList::Iterator i = BuildingList::Begin (); i != BuildingList::End (); ++i)
+    {
+      buildings.push_back (PeekPointer (*i));
+    }
+  std::vector<Ptr<MobilityBuildingInfo> > infos (n);
+  std::vector<Vector> positions (n);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      Ptr<MobilityModel> mobility = nodes.Get (i)->GetObject<MobilityModel> ();
+      if (mobility != 0)
+        {
+          infos[i] = mobility->GetObject<MobilityBuildingInfo> ();
+          positions[i] = mobility->GetPosition ();
+        }
+    }
+
+  std::vector<Membership> membership (n);
+  ParallelFor (n, GetThreads (threads, n), [&] (uint32_t begin, uint32_t end)
+    {
+      for (uint32_t i = begin; i < end; i++)
+        {
+          Membership &m = membership[i];
+          m.building = -1;
+          for (uint32_t b = 0; b < buildings.size (); b++)
+            {
+              if (buildings[b]->IsInside (positions[i]))
+                {
+                  NS_ASSERT_MSG (m.building < 0, "MobilityBuildingInfo already inside another building!");
+                  m.building = b;
+                  m.floor = buildings[b]->GetFloor (positions[i]);
+                  m.roomX = buildings[b]->GetRoomX (positions[i]);
+                  m.roomY = buildings[b]->GetRoomY (positions[i]);
+                }
+            }
+        }
+    });
+
+  for (uint32_t i = 0; i < n; i++)
+    {
+      if (infos[i] == 0)
+        {
+          continue;
+        }
+      const Membership &m = membership[i];
+      if (m.building >= 0)
+        {
+          infos[i]->SetIndoor (BuildingList::GetBuilding (m.building), m.floor, m.roomX, m.roomY);
+        }
+      else
+        {
+          infos[i]->SetOutdoor ();
+        }
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,64 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#ifndef LORA_PARALLEL_SETUP_H
+#define LORA_PARALLEL_SETUP_H
+
+#include "ns3/box.h"
+#include "ns3/node-container.h"
+#include "ns3/position-allocator.h"
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * \ingroup energy
+ *
+ * \brief Multi-threaded versions of the per-node scenario setup steps
+ *
+ * Positions are drawn with LoraCounterRng, a pure function of (seed,
+ * stream, node index), so every thread draws its own nodes and the result
+ * does not depend on the number of threads. Building membership is
+ * computed in parallel on read-only geometry (raw building pointers, no
+ * reference counting across threads) and applied to the nodes afterwards
+ * on the calling thread. A seed of 0 derives it from the global seed and
+ * run; 0 threads uses all hardware threads.
+ */
+class LoraParallelSetup
+{
+public:
+  //Uniform positions in area (z range included) outside every building,
+  //like OutdoorPositionAllocator
+  static Ptr<ListPositionAllocator> OutdoorPositions (uint32_t n, const Box &area, uint64_t seed,
+                                                     uint32_t stream, uint32_t threads);
+  //Uniform building, then uniform position inside it, like
+  //RandomBuildingPositionAllocator
+  static Ptr<ListPositionAllocator> IndoorPositions (uint32_t n, uint64_t seed,
+                                                    uint32_t stream, uint32_t threads);
+  //Same result as BuildingsHelper::MakeMobilityModelConsistent on the
+  //nodes (MobilityBuildingInfo must be installed)
+  static void MakeMobilityModelConsistent (NodeContainer nodes, uint32_t threads);
+
+private:
+  static uint64_t GetSeed (uint64_t seed);
+  static uint32_t GetThreads (uint32_t threads, uint32_t n);
+};
+
+} // namespace ns3
+
+#endif /* LORA_PARALLEL_SETUP_H */
@@ -0,0 +1,101 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#include "lora-phase-timer.h"
+#include "ns3/log.h"
+#include "ns3/lora-process-info.h"
+#include <fstream>
+#include <iomanip>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LoraPhaseTimer");
+
+LoraPhaseTimer::LoraPhaseTimer ()
+  : m_running (false),
+    m_rssBefore (0)
+{
+}
+
+void
+LoraPhaseTimer::Start (std::string name)
+{
+  Stop ();
+  m_current = name;
+  m_rssBefore = LoraProcessInfo::GetResidentBytes ();
+  m_running = true;
+  m_since = std::chrono::steady_clock::now ();
+}
+
+void
+LoraPhaseTimer::Stop (void)
+{
+  if (!m_running)
+    {
+      return;
+    }
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now ();
+  Phase phase;
+  phase.name = m_current;
+  phase.wallMs = std::chrono::duration<double, std::milli> (now - m_since).count ();
+  phase.rssBytes = LoraProcessInfo::GetResidentBytes ();
+  phase.rssDeltaBytes = static_cast<int64_t> (phase.rssBytes) - static_cast<int64_t> (m_rssBefore);
+  phase.peakRssBytes = LoraProcessInfo::GetPeakResidentBytes ();
+  m_phases.push_back (phase);
+  m_running = false;
+  NS_LOG_INFO ("Phase " << phase.name << ": " << phase.wallMs << " ms, RSS "
+               << (phase.rssDeltaBytes >= 0 ? "+" : "") << phase.rssDeltaBytes / 1048576.0 << " MiB");
+}
+
+const std::vector<LoraPhaseTimer::Phase> &
+LoraPhaseTimer::GetPhases (void) const
+{
+  return m_phases;
+}
+
+double
+LoraPhaseTimer::GetTotalMs (void) const
+{
+  double total = 0;
+  for (uint32_t i = 0; i < m_phases.size (); i++)
+    {
+      total += m_phases[i].wallMs;
+    }
+  return total;
+}
+
+void
+LoraPhaseTimer::Report (std::string fileName) const
+{
+  std::ofstream file (fileName.c_str ());
+  double total = GetTotalMs ();
+  file << "#phase wallMs share% rssMiB deltaRssMiB peakRssMiB\n";
+  file << std::fixed << std::setprecision (3);
+  for (uint32_t i = 0; i < m_phases.size (); i++)
+    {
+      const Phase &phase = m_phases[i];
+      file << phase.name << " " << phase.wallMs << " "
+           << (total > 0 ? 100.0 * phase.wallMs / total : 0) << " "
+           << phase.rssBytes / 1048576.0 << " "
+           << phase.rssDeltaBytes / 1048576.0 << " "
+           << phase.peakRssBytes / 1048576.0 << "\n";
+    }
+  file << "total " << total << " 100.000\n";
+}
+
+} // namespace ns3
@@ -0,0 +1,71 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#ifndef LORA_PHASE_TIMER_H
+#define LORA_PHASE_TIMER_H
+
+#include <stdint.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup energy
+ *
+ * \brief Wall time and memory of the phases of a scenario
+ *
+ * Start (name) closes the running phase, if any, and opens a new one.
+ * Each phase records its steady-clock duration, the change of resident
+ * memory and the peak resident memory at its end.
+ */
+class LoraPhaseTimer
+{
+public:
+  struct Phase
+  {
+    std::string name;
+    double wallMs;
+    int64_t rssDeltaBytes;
+    uint64_t rssBytes;
+    uint64_t peakRssBytes;
+  };
+
+  LoraPhaseTimer ();
+
+  void Start (std::string name);
+  void Stop (void);
+
+  const std::vector<Phase> & GetPhases (void) const;
+  double GetTotalMs (void) const;
+
+  //"#phase wallMs share% rssMiB deltaRssMiB peakRssMiB" table
+  void Report (std::string fileName) const;
+
+private:
+  std::vector<Phase> m_phases;
+  bool m_running;
+  std::string m_current;
+  std::chrono::steady_clock::time_point m_since;
+  uint64_t m_rssBefore;
+};
+
+} // namespace ns3
+
+#endif /* LORA_PHASE_TIMER_H */
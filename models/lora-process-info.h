@@ -0,0 +1,73 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#ifndef LORA_PROCESS_INFO_H
+#define LORA_PROCESS_INFO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace ns3 {
+
+/**
+ * \ingroup energy
+ *
+ * \brief Memory usage of the simulation process
+ *
+ * Safe to call from any thread. Both values are 0 where the information
+ * is not available.
+ */
+class LoraProcessInfo
+{
+public:
+  //Current resident set size (Linux /proc/self/statm)
+  static uint64_t GetResidentBytes (void)
+  {
+    FILE *statm = fopen ("/proc/self/statm", "r");
+    if (statm == 0)
+      {
+        return 0;
+      }
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    int fields = fscanf (statm, "%lu %lu", &size, &resident);
+    fclose (statm);
+    return fields == 2 ? static_cast<uint64_t> (resident) * sysconf (_SC_PAGESIZE) : 0;
+  }
+
+  //Peak resident set size
+  static uint64_t GetPeakResidentBytes (void)
+  {
+    struct rusage usage;
+    if (getrusage (RUSAGE_SELF, &usage) != 0)
+      {
+        return 0;
+      }
+#ifdef __APPLE__
+    return usage.ru_maxrss;          //bytes
+#else
+    return static_cast<uint64_t> (usage.ru_maxrss) * 1024;   //kilobytes
+#endif
+  }
+};
+
+} //namespace ns3
+
+#endif /* LORA_PROCESS_INFO_H */
@@ -0,0 +1,207 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#include "lora-profiling-scheduler.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/object-factory.h"
+#include "ns3/event-impl.h"
+#include <cxxabi.h>
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <typeinfo>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LoraProfilingScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED (LoraProfilingScheduler);
+
+std::string LoraProfilingScheduler::s_reportFile;
+bool LoraProfilingScheduler::s_draining = false;
+
+TypeId
+LoraProfilingScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LoraProfilingScheduler")
+    .SetParent<LoraCountingScheduler> ()
+    .SetGroupName ("Energy")
+    .AddConstructor<LoraProfilingScheduler> ()
+  ;
+  return tid;
+}
+
+LoraProfilingScheduler::LoraProfilingScheduler ()
+  : m_running (-1),
+    m_created (std::chrono::steady_clock::now ())
+{
+  NS_LOG_FUNCTION (this);
+}
+
+LoraProfilingScheduler::~LoraProfilingScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+  Charge ();
+  if (s_reportFile.empty ())
+    {
+      Report (std::cout);
+    }
+  else
+    {
+      std::ofstream file (s_reportFile.c_str ());
+      Report (file);
+    }
+}
+
+void
+LoraProfilingScheduler::Enable (std::string reportFile)
+{
+  s_reportFile = reportFile;
+  s_draining = false;
+  Simulator::SetScheduler (ObjectFactory ("ns3::LoraProfilingScheduler"));
+  Simulator::ScheduleDestroy (&LoraProfilingScheduler::StartDrain);
+}
+
+void
+LoraProfilingScheduler::StartDrain (void)
+{
+  s_draining = true;
+}
+
+uint32_t
+LoraProfilingScheduler::Lookup (const EventImpl *impl)
+{
+  std::type_index type (typeid (*impl));
+  std::unordered_map<std::type_index, uint32_t>::iterator it = m_index.find (type);
+  if (it != m_index.end ())
+    {
+      return it->second;
+    }
+  Census census = { type, 0, 0, 0, 0, 0, 0 };
+  m_census.push_back (census);
+  m_index.insert (std::make_pair (type, m_census.size () - 1));
+  return m_census.size () - 1;
+}
+
+void
+LoraProfilingScheduler::Charge (void) const
+{
+  if (m_running >= 0)
+    {
+      std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now ();
+      m_census[m_running].wallNs += std::chrono::duration_cast<std::chrono::nanoseconds> (now - m_runningSince).count ();
+      m_running = -1;
+    }
+}
+
+void
+LoraProfilingScheduler::Insert (const Event &ev)
+{
+  LoraCountingScheduler::Insert (ev);
+  Census &census = m_census[Lookup (ev.impl)];
+  census.scheduled++;
+  census.pending++;
+  census.peakPending = std::max (census.peakPending, census.pending);
+}
+
+bool
+LoraProfilingScheduler::IsEmpty (void) const
+{
+  //Checked by the run loop right after each event
+  Charge ();
+  return LoraCountingScheduler::IsEmpty ();
+}
+
+Scheduler::Event
+LoraProfilingScheduler::RemoveNext (void)
+{
+  Charge ();
+  Event ev = LoraCountingScheduler::RemoveNext ();
+  uint32_t slot = Lookup (ev.impl);
+  Census &census = m_census[slot];
+  census.pending--;
+  if (s_draining)
+    {
+      //Released by Simulator::Destroy, not run
+      return ev;
+    }
+  if (ev.impl->IsCancelled ())
+    {
+      //Popped but not run
+      census.cancelled++;
+      return ev;
+    }
+  census.executed++;
+  m_running = slot;
+  m_runningSince = std::chrono::steady_clock::now ();
+  return ev;
+}
+
+void
+LoraProfilingScheduler::Remove (const Event &ev)
+{
+  LoraCountingScheduler::Remove (ev);
+  Census &census = m_census[Lookup (ev.impl)];
+  census.pending--;
+  census.cancelled++;
+}
+
+void
+LoraProfilingScheduler::Report (std::ostream &os) const
+{
+  std::vector<const Census *> ranked;
+  uint64_t totalExecuted = 0;
+  int64_t totalNs = 0;
+  for (uint32_t i = 0; i < m_census.size (); i++)
+    {
+      ranked.push_back (&m_census[i]);
+      totalExecuted += m_census[i].executed;
+      totalNs += m_census[i].wallNs;
+    }
+  std::sort (ranked.begin (), ranked.end (),
+             [] (const Census *a, const Census *b) { return a->wallNs > b->wallNs; });
+  double lifetimeS = std::chrono::duration<double> (std::chrono::steady_clock::now () - m_created).count ();
+
+  os << "#Event profile: " << totalExecuted << " events, " << totalNs / 1e6 << " ms in handlers, "
+     << lifetimeS * 1e3 << " ms since the scheduler was installed" << std::endl;
+  os << "#rank executed events% wallMs wall% meanUs scheduled cancelled peakPending handler" << std::endl;
+  for (uint32_t r = 0; r < ranked.size (); r++)
+    {
+      const Census &census = *ranked[r];
+      int status = 0;
+      char *demangled = abi::__cxa_demangle (census.type.name (), 0, 0, &status);
+      std::string name = status == 0 ? demangled : census.type.name ();
+      std::free (demangled);
+
+      os << r + 1 << " " << census.executed << " "
+         << std::fixed << std::setprecision (2)
+         << (totalExecuted > 0 ? 100.0 * census.executed / totalExecuted : 0) << " "
+         << census.wallNs / 1e6 << " "
+         << (totalNs > 0 ? 100.0 * census.wallNs / totalNs : 0) << " "
+         << (census.executed > 0 ? census.wallNs / 1e3 / census.executed : 0) << " ";
+      os.unsetf (std::ios::floatfield);
+      os << std::setprecision (6)
+         << census.scheduled << " " << census.cancelled << " " << census.peakPending << " "
+         << name << std::endl;
+    }
+}
+
+} // namespace ns3
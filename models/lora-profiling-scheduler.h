@@ -0,0 +1,100 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#ifndef LORA_PROFILING_SCHEDULER_H
+#define LORA_PROFILING_SCHEDULER_H
+
+#include "ns3/lora-counting-scheduler.h"
+#include <stdint.h>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup energy
+ *
+ * \brief Event-queue census and wall time per event handler type
+ *
+ * Opt-in scheduler, installed with Enable (). Events are classified by the
+ * dynamic type of their EventImpl, which MakeEvent instantiates per
+ * handler signature and object type only: handlers of one class with the
+ * same signature share a row, so a row is a coarse group of handlers, not
+ * one function. For every type it keeps scheduled, executed and cancelled
+ * counts, current and peak pending events, and the wall time from pop to
+ * the next queue check, which the simulator does right after running each
+ * event. Events still queued at Simulator::Destroy are dropped from the
+ * pending counts without being counted or charged. The ranked report is
+ * printed when the scheduler is destroyed (Simulator::Destroy).
+ */
+class LoraProfilingScheduler : public LoraCountingScheduler
+{
+public:
+  static TypeId GetTypeId (void);
+  LoraProfilingScheduler ();
+  virtual ~LoraProfilingScheduler ();
+
+  //Install as the simulator scheduler, report to the file (standard
+  //output if empty) at Simulator::Destroy
+  static void Enable (std::string reportFile = "");
+
+  virtual void Insert (const Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Event RemoveNext (void);
+  virtual void Remove (const Event &ev);
+
+  //Types ranked by wall time
+  void Report (std::ostream &os) const;
+
+private:
+  struct Census
+  {
+    std::type_index type;
+    uint64_t scheduled;
+    uint64_t executed;
+    uint64_t cancelled;
+    uint64_t pending;
+    uint64_t peakPending;
+    int64_t wallNs;
+  };
+
+  uint32_t Lookup (const EventImpl *impl);
+  //Charge the running event up to now
+  void Charge (void) const;
+  //Destroy event, run before the simulator drains the remaining events
+  static void StartDrain (void);
+
+  static std::string s_reportFile;
+  //Set once Simulator::Destroy has started
+  static bool s_draining;
+
+  std::unordered_map<std::type_index, uint32_t> m_index;
+  mutable std::vector<Census> m_census;
+  //Event being run, -1 if none
+  mutable int32_t m_running;
+  mutable std::chrono::steady_clock::time_point m_runningSince;
+  std::chrono::steady_clock::time_point m_created;
+};
+
+} // namespace ns3
+
+#endif /* LORA_PROFILING_SCHEDULER_H */
@@ -18,8 +18,16 @@
 
 #include "lora-radio-energy-model-helper.h"
 #include "ns3/lora-net-device.h"
+#include "ns3/end-device-lora-mac.h"
+#include "ns3/lora-energy-source.h"
 #include "ns3/lora-consumption-model.h"
 #include "ns3/end-device-lora-phy.h"
+#include "ns3/lora-counter-rng.h"
+#include "ns3/rng-seed-manager.h"
+#include <algorithm>
+
+//Spread factors are clipped at this number of standard deviations
+#define SPREAD_CLIP_SIGMA    3.0
 
 namespace ns3 {
 
@@ -30,6 +38,9 @@ LoraRadioEnergyModelHelper::LoraRadioEnergyModelHelper ()
   m_energyDepletionCB.Nullify();
   m_energyRechargedCB.Nullify();
   m_energyChangedCB.Nullify();
+  //No device spread by default
+  m_currentSpread = 0.0;
+  m_spreadSeed = 0;
 }
 
 LoraRadioEnergyModelHelper::~LoraRadioEnergyModelHelper ()
@@ -80,6 +91,169 @@ LoraRadioEnergyModelHelper::SetConsumptionModel (std::string name,
   factory.Set (n3, v3);
   factory.Set (n4, v4);
   m_consumptionModel = factory;
+  m_sharedConsumptionModel = NULL;
+}
+
+Ptr<LoraConsumptionModel>
+LoraRadioEnergyModelHelper::GetSharedConsumptionModel (void) const
+{
+  if (m_sharedConsumptionModel == NULL && m_consumptionModel.GetTypeId ().GetUid ())
+    {
+      m_sharedConsumptionModel = m_consumptionModel.Create<LoraConsumptionModel> ();
+    }
+  return m_sharedConsumptionModel;
+}
+
+void
+LoraRadioEnergyModelHelper::SetMonitor (Ptr<LoraEnergyMonitor> monitor)
+{
+  NS_ASSERT (monitor != NULL);
+  m_monitor = monitor;
+}
+
+void
+LoraRadioEnergyModelHelper::RegisterInMonitor (Ptr<LoraNetDevice> device, Ptr<EnergySource> source,
+                                               Ptr<LoraRadioEnergyModel> model) const
+{
+  if (m_monitor == NULL)
+    {
+      return;
+    }
+  Ptr<Node> node = device->GetNode ();
+  Ptr<LoraEnergySource> loraSource = DynamicCast<LoraEnergySource> (source);
+  NS_ASSERT (loraSource != NULL);
+  Ptr<EndDeviceLoraMac> edMac = DynamicCast<EndDeviceLoraMac> (device->GetMac ());
+  m_monitor->Add (node, loraSource, model, edMac, node->GetObject<MobilityModel> ());
+}
+
+void
+LoraRadioEnergyModelHelper::SetCurrentSpread (double relativeSpread, uint64_t seed)
+{
+  //Clipped factors must stay positive
+  NS_ASSERT (relativeSpread >= 0 && relativeSpread * SPREAD_CLIP_SIGMA < 1.0);
+  m_currentSpread = relativeSpread;
+  m_spreadSeed = seed;
+}
+
+void
+LoraRadioEnergyModelHelper::ApplyCurrentSpread (Ptr<LoraRadioEnergyModel> model, uint32_t nodeId) const
+{
+  uint64_t seed = m_spreadSeed;
+  if (seed == 0)
+    {
+      seed = (static_cast<uint64_t> (RngSeedManager::GetSeed ()) << 32) ^ RngSeedManager::GetRun ();
+    }
+
+  //One draw index per mode: TX-RX-STANDBY-SLEEP
+  LoraCounterRng rng (seed, nodeId);
+  double factor[4];
+  for (uint32_t mode = 0; mode < 4; mode++)
+    {
+      double z = std::max (-SPREAD_CLIP_SIGMA, std::min (SPREAD_CLIP_SIGMA, rng.GetNormal (mode)));
+      factor[mode] = 1.0 + m_currentSpread * z;
+    }
+  model->ApplyCurrentSpread (factor[0], factor[1], factor[2], factor[3]);
+}
+
+void
+LoraRadioEnergyModelHelper::ForwardWithNodeId (NodeTraceSink sink, uint32_t nodeId,
+                                               double oldValue, double newValue)
+{
+  sink (nodeId, oldValue, newValue);
+}
+
+uint32_t
+LoraRadioEnergyModelHelper::ConnectTotalEnergyConsumption (DeviceEnergyModelContainer models, NodeTraceSink sink,
+                                                           uint32_t stride) const
+{
+  NS_ASSERT (!sink.IsNull ());
+  NS_ASSERT (stride > 0);
+  uint32_t connected = 0;
+  for (uint32_t i = 0; i < models.GetN (); i += stride)
+    {
+      Ptr<LoraRadioEnergyModel> model = DynamicCast<LoraRadioEnergyModel> (models.Get (i));
+      NS_ASSERT (model != NULL && model->GetEnergySource () != NULL);
+      uint32_t nodeId = model->GetEnergySource ()->GetNode ()->GetId ();
+      model->ConnectTotalEnergyConsumption (MakeBoundCallback (&LoraRadioEnergyModelHelper::ForwardWithNodeId,
+                                                               sink, nodeId));
+      connected++;
+    }
+  return connected;
+}
+
+DeviceEnergyModelContainer
+LoraRadioEnergyModelHelper::BulkInstall (NetDeviceContainer deviceContainer,
+                                         EnergySourceContainer sourceContainer) const
+{
+  NS_ASSERT (deviceContainer.GetN () <= sourceContainer.GetN ());
+  DeviceEnergyModelContainer container;
+  uint32_t nDevices = deviceContainer.GetN ();
+  if (nDevices == 0)
+    {
+      return container;
+    }
+  LoraObjectPool<LoraRadioEnergyModel>::Reserve (nDevices);
+  if (m_monitor != NULL)
+    {
+      m_monitor->Reserve (nDevices);
+    }
+
+  //Every model gets all the attributes of the factory; the first one also
+  //provides the consumption model when none is shared
+  Ptr<LoraRadioEnergyModel> first = m_energyModel.Create<LoraRadioEnergyModel> ();
+  NS_ASSERT (first != NULL);
+
+  //Consumption model has no per-device state, one instance serves all
+  Ptr<LoraConsumptionModel> consumption = GetSharedConsumptionModel ();
+  if (consumption == NULL)
+    {
+      consumption = first->GetConsumptionModel ();
+    }
+
+  for (uint32_t i = 0; i < nDevices; i++)
+    {
+      Ptr<LoraNetDevice> loraDevice = DynamicCast<LoraNetDevice> (deviceContainer.Get (i));
+      if (loraDevice == NULL)
+        {
+          NS_FATAL_ERROR ("NetDevice type is not LoraNetDevice!");
+        }
+      Ptr<EndDeviceLoraPhy> loraPhy = DynamicCast<EndDeviceLoraPhy> (loraDevice->GetPhy ());
+      NS_ASSERT (loraPhy != NULL);
+      Ptr<EnergySource> source = sourceContainer.Get (i);
+      NS_ASSERT (source != NULL);
+
+      Ptr<LoraRadioEnergyModel> model = i == 0 ? first : m_energyModel.Create<LoraRadioEnergyModel> ();
+      if (consumption != NULL)
+        {
+          model->SetConsumptionModel (consumption);
+        }
+      if (m_currentSpread > 0)
+        {
+          ApplyCurrentSpread (model, loraDevice->GetNode ()->GetId ());
+        }
+
+      //Link source, model and PHY listener
+      model->SetEnergySource (source);
+      source->AppendDeviceEnergyModel (model);
+      loraPhy->RegisterListener (model->GetPhyListener ());
+
+      //Register Energy-handling callbacks
+      if (!m_energyDepletionCB.IsNull ())
+        {
+          model->RegisterEnergyDepletionCB (m_energyDepletionCB);
+        }
+      if (!m_energyRechargedCB.IsNull ())
+        {
+          model->RegisterEnergyRechargedCB (m_energyRechargedCB);
+        }
+      if (!m_energyChangedCB.IsNull ())
+        {
+          model->RegisterEnergyChangedCB (m_energyChangedCB);
+        }
+      RegisterInMonitor (loraDevice, source, model);
+      container.Add (model);
+    }
+  return container;
 }
 
 Ptr<DeviceEnergyModel>
@@ -120,12 +294,20 @@ LoraRadioEnergyModelHelper::DoInstall (Ptr<NetDevice> device,
       model->RegisterEnergyChangedCB(m_energyChangedCB);
     }
 
-  //Set Consumption Model
-  if (m_consumptionModel.GetTypeId ().GetUid ())
+  //Set Consumption Model (shared, it has no per-device state)
+  Ptr<LoraConsumptionModel> consumption = GetSharedConsumptionModel ();
+  if (consumption != NULL)
     {
-      Ptr<LoraConsumptionModel> consumption = m_consumptionModel.Create<LoraConsumptionModel> ();
       model->SetConsumptionModel (consumption);
     }
+
+  //Apply device spread
+  if (m_currentSpread > 0)
+    {
+      ApplyCurrentSpread (model, node->GetId ());
+    }
+
+  RegisterInMonitor (loraDevice, source, model);
   return model;
 }
 
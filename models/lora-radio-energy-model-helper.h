@@ -21,8 +21,12 @@
 
 #include "ns3/energy-model-helper.h"
 #include "ns3/lora-radio-energy-model.h"
+#include "ns3/lora-energy-monitor.h"
 
 namespace ns3 {
+
+class LoraNetDevice;
+
 /**
  * \ingroup energy
  * \brief A LoRa radio energy helper based on WifiRadioEnergyHelper
@@ -49,15 +53,62 @@ public:
                             std::string n3 = "", const AttributeValue &v3 = EmptyAttributeValue (),
                             std::string n4 = "", const AttributeValue &v7 = EmptyAttributeValue ());
 
+  //Enable per-device manufacturing spread of the mode currents.
+  //relativeSpread is the relative standard deviation (e.g. 0.1 for 10%).
+  //Factors are drawn from a counter-based generator keyed by node id and
+  //seed, so they do not depend on installation order. A zero seed takes
+  //the run seed from RngSeedManager (read only, no stream is consumed).
+  void SetCurrentSpread (double relativeSpread, uint64_t seed = 0);
+
+  //Register every installed device in the given monitor
+  void SetMonitor (Ptr<LoraEnergyMonitor> monitor);
+
+  //Trace sink receiving the node id as context (old and new value)
+  typedef Callback<void, uint32_t, double, double> NodeTraceSink;
+
+  //Connect a single sink to TotalEnergyConsumption of every stride-th
+  //model, without Config paths. Return the number of connected models.
+  uint32_t ConnectTotalEnergyConsumption (DeviceEnergyModelContainer models, NodeTraceSink sink,
+                                          uint32_t stride = 1) const;
+
+  //Bulk installation for large fleets. Types are checked with a pointer
+  //cast instead of TypeId names, every model gets the attributes set on
+  //the helper, models are allocated from a pooled arena reserved for the
+  //whole set and share a single consumption model. PHY listeners are wired
+  //in the same pass.
+  DeviceEnergyModelContainer BulkInstall (NetDeviceContainer deviceContainer,
+                                          EnergySourceContainer sourceContainer) const;
+
 private:
+  //Forward a trace to the sink adding the node id
+  static void ForwardWithNodeId (NodeTraceSink sink, uint32_t nodeId,
+                                 double oldValue, double newValue);
+
+  //Consumption model instance shared by every installed device
+  Ptr<LoraConsumptionModel> GetSharedConsumptionModel (void) const;
+
+  //Draw the current spread factors of one device and apply them to the model
+  void ApplyCurrentSpread (Ptr<LoraRadioEnergyModel> model, uint32_t nodeId) const;
+  //Add an installed device to the monitor, if any
+  void RegisterInMonitor (Ptr<LoraNetDevice> device, Ptr<EnergySource> source,
+                          Ptr<LoraRadioEnergyModel> model) const;
+
   virtual Ptr<DeviceEnergyModel> DoInstall (Ptr<NetDevice> device,
                                             Ptr<EnergySource> source) const;
 
 private:
   //energy source
   ObjectFactory m_energyModel;
-  //consumption model
+  //consumption model (stateless, created once and shared)
   ObjectFactory m_consumptionModel;
+  mutable Ptr<LoraConsumptionModel> m_sharedConsumptionModel;
+
+  //Registry filled at install time
+  Ptr<LoraEnergyMonitor> m_monitor;
+
+  //Device spread configuration
+  double   m_currentSpread;
+  uint64_t m_spreadSeed;
 
   //Callback types to be registered for energy handling
   //Callbacks to handle state of energy source
@@ -21,13 +21,17 @@
 #include "ns3/log.h"
 #include "ns3/simulator.h"
 #include "ns3/pointer.h"
+#include "ns3/uinteger.h"
 #include "ns3/energy-source.h"
+#include "ns3/lora-event-log.h"
 #include "lora-radio-energy-model.h"
+#include <algorithm>
 
 #define TX_CURR_DEFAULT        43.5e-3
 #define RX_CURR_DEFAULT        11.2e-3
 #define STANDBY_CURR_DEFAULT   1.4e-3
 #define SLEEP_CURR_DEFAULT     1.8e-6
+#define ENERGY_WINDOW_COUNT_DEFAULT 24
 
 namespace ns3 {
 
@@ -72,32 +76,44 @@ LoraRadioEnergyModel::GetTypeId (void)
                    PointerValue (),
                    MakePointerAccessor (&LoraRadioEnergyModel::m_consumptionModel),
                    MakePointerChecker<LoraConsumptionModel> ())
+    .AddAttribute  ("EnergyWindowLength",
+                   "Length of the per-state energy windows, 0 disables them.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&LoraRadioEnergyModel::SetEnergyWindowLength,
+                                     &LoraRadioEnergyModel::GetEnergyWindowLength),
+                   MakeTimeChecker ())
+    .AddAttribute  ("EnergyWindowCount",
+                   "Number of per-state energy windows kept (ring).",
+                   UintegerValue (ENERGY_WINDOW_COUNT_DEFAULT),
+                   MakeUintegerAccessor (&LoraRadioEnergyModel::SetEnergyWindowCount,
+                                         &LoraRadioEnergyModel::GetEnergyWindowCount),
+                   MakeUintegerChecker<uint32_t> (1))
     .AddTraceSource("TotalEnergyConsumption",
                     "Total energy consumption of the radio device.",
                     MakeTraceSourceAccessor (&LoraRadioEnergyModel::m_totalEnergyConsumption),
                    "ns3::TracedValueCallback::Double")
     .AddTraceSource("TxEnergyConsumption",
-                    "Energy consumption in TX mode",
-                    MakeTraceSourceAccessor (&LoraRadioEnergyModel::m_txEnergyConsumption),
+                    "Energy consumption in TX mode.",
+                    MakeLoraLazyTraceAccessor (&LoraRadioEnergyModel::GetTxEnergyTrace),
                     "ns3::TracedValueCallback::Double")
     .AddTraceSource("RxEnergyConsumption",
-                    "Energy consumption in RX mode",
-                     MakeTraceSourceAccessor (&LoraRadioEnergyModel::m_rxEnergyConsumption),
+                    "Energy consumption in RX mode.",
+                    MakeLoraLazyTraceAccessor (&LoraRadioEnergyModel::GetRxEnergyTrace),
                     "ns3::TracedValueCallback::Double")
     .AddTraceSource("StandbyEnergyConsumption",
-                    "Energy consumption in STANDBY mode",
-                    MakeTraceSourceAccessor (&LoraRadioEnergyModel::m_standbyEnergyConsumption),
+                    "Energy consumption in STANDBY mode.",
+                    MakeLoraLazyTraceAccessor (&LoraRadioEnergyModel::GetStandbyEnergyTrace),
                     "ns3::TracedValueCallback::Double")
     .AddTraceSource("SleepEnergyConsumption",
-                    "Energy consumption in SLEEP mode",
-                    MakeTraceSourceAccessor (&LoraRadioEnergyModel::m_sleepEnergyConsumption),
+                    "Energy consumption in SLEEP mode.",
+                    MakeLoraLazyTraceAccessor (&LoraRadioEnergyModel::GetSleepEnergyTrace),
                     "ns3::TracedValueCallback::Double")
-
   ;
   return tid;
 }
 
 LoraRadioEnergyModel::LoraRadioEnergyModel ()
+  : m_loraEnergyPhyListener (this)
 {
   NS_LOG_FUNCTION (this);
   //Init State
@@ -116,6 +132,9 @@ LoraRadioEnergyModel::LoraRadioEnergyModel ()
   m_totalStandbyTime = Seconds(0.0);
   m_totalSleepTime   = Seconds(0.0);
 
+  //No device spread by default
+  m_txCurrentFactor = 1.0;
+
   //Initialize internal state variables
   m_lastStampTime = Seconds (0.0);
   m_energyDepleted = false;
@@ -125,18 +144,63 @@ LoraRadioEnergyModel::LoraRadioEnergyModel ()
   m_energyRechargedCB.Nullify ();
   m_energyChangedCB.Nullify ();
   m_source = NULL;
-
-  //Init listener and attach callbacks to monitor operation state
-  m_loraEnergyPhyListener = new LoraEnergyPhyListener;
-  m_loraEnergyPhyListener->RegisterNotifyTransitionCB(MakeCallback (&DeviceEnergyModel::ChangeState, this));
-  m_loraEnergyPhyListener->RegisterNotifyTxConsumptionCB(MakeCallback (&LoraRadioEnergyModel::CalcTxCurrentFromModel, this));
-
 }
 
 LoraRadioEnergyModel::~LoraRadioEnergyModel ()
 {
   NS_LOG_FUNCTION (this);
-  delete m_loraEnergyPhyListener;
+}
+
+TracedCallback<double, double> &
+LoraRadioEnergyModel::GetTxEnergyTrace (LoraRadioEnergyModel *model)
+{
+  if (!model->m_modeTraces)
+    {
+      model->m_modeTraces.reset (new ModeTraces);
+    }
+  return model->m_modeTraces->tx;
+}
+
+TracedCallback<double, double> &
+LoraRadioEnergyModel::GetRxEnergyTrace (LoraRadioEnergyModel *model)
+{
+  if (!model->m_modeTraces)
+    {
+      model->m_modeTraces.reset (new ModeTraces);
+    }
+  return model->m_modeTraces->rx;
+}
+
+TracedCallback<double, double> &
+LoraRadioEnergyModel::GetStandbyEnergyTrace (LoraRadioEnergyModel *model)
+{
+  if (!model->m_modeTraces)
+    {
+      model->m_modeTraces.reset (new ModeTraces);
+    }
+  return model->m_modeTraces->standby;
+}
+
+TracedCallback<double, double> &
+LoraRadioEnergyModel::GetSleepEnergyTrace (LoraRadioEnergyModel *model)
+{
+  if (!model->m_modeTraces)
+    {
+      model->m_modeTraces.reset (new ModeTraces);
+    }
+  return model->m_modeTraces->sleep;
+}
+
+void *
+LoraRadioEnergyModel::operator new (std::size_t size)
+{
+  return LoraObjectPool<LoraRadioEnergyModel>::Allocate (size);
+}
+
+void
+LoraRadioEnergyModel::operator delete (void *p, std::size_t size)
+{
+  LoraObjectPool<LoraRadioEnergyModel>::Release (p, size);
 }
 
 void
@@ -147,6 +211,13 @@ LoraRadioEnergyModel::SetEnergySource (Ptr<EnergySource> source)
   m_source = source;
 }
 
+Ptr<EnergySource>
+LoraRadioEnergyModel::GetEnergySource (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_source;
+}
+
 void
 LoraRadioEnergyModel::SetConsumptionModel (Ptr<LoraConsumptionModel> model)
 {
@@ -154,6 +225,13 @@ LoraRadioEnergyModel::SetConsumptionModel (Ptr<LoraConsumptionModel> model)
   m_consumptionModel = model;
 }
 
+Ptr<LoraConsumptionModel>
+LoraRadioEnergyModel::GetConsumptionModel (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_consumptionModel;
+}
+
 double LoraRadioEnergyModel::GetTxEnergyConsumption (void) const
 {
   NS_LOG_FUNCTION (this);
@@ -279,6 +357,33 @@ LoraRadioEnergyModel::SetSleepCurrentA (double sleepCurrentA)
   m_sleepCurrentA = sleepCurrentA;
 }
 
+void
+LoraRadioEnergyModel::ApplyCurrentSpread (double txFactor, double rxFactor,
+                                          double standbyFactor, double sleepFactor)
+{
+  NS_LOG_FUNCTION (this << txFactor << rxFactor << standbyFactor << sleepFactor);
+  NS_ASSERT (txFactor > 0 && rxFactor > 0 && standbyFactor > 0 && sleepFactor > 0);
+  m_txCurrentFactor  = txFactor;
+  m_txCurrentA      *= txFactor;
+  m_rxCurrentA      *= rxFactor;
+  m_standbyCurrentA *= standbyFactor;
+  m_sleepCurrentA   *= sleepFactor;
+}
+
+double
+LoraRadioEnergyModel::GetTxCurrentFactor (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_txCurrentFactor;
+}
+
+void
+LoraRadioEnergyModel::ConnectTotalEnergyConsumption (Callback<void, double, double> cb)
+{
+  NS_LOG_FUNCTION (this);
+  m_totalEnergyConsumption.ConnectWithoutContext (cb);
+}
+
 EndDeviceLoraPhy::State
 LoraRadioEnergyModel::GetCurrentState (void) const
 {
@@ -286,6 +391,13 @@ LoraRadioEnergyModel::GetCurrentState (void) const
   return m_currentState;
 }
 
+Time
+LoraRadioEnergyModel::GetLastStampTime (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_lastStampTime;
+}
+
 void
 LoraRadioEnergyModel::RegisterEnergyDepletionCB (LoraEnergyDepletionCB cb)
 {
@@ -315,7 +427,8 @@ LoraRadioEnergyModel::CalcTxCurrentFromModel (double txPowerDbm)
 {
   NS_LOG_FUNCTION (this);
   NS_ASSERT(m_consumptionModel!=NULL);
-  m_txCurrentA = m_consumptionModel->CalcTxCurrent (txPowerDbm);
+  m_txCurrentA = m_consumptionModel->CalcTxCurrent (txPowerDbm) * m_txCurrentFactor;
+  LoraEventLog::Write (LoraEventLog::MODEL_TX_CURRENT, txPowerDbm, m_txCurrentA);
 }
 
 // Implementation based on WiFi model (already tested in platform)
@@ -339,29 +452,53 @@ LoraRadioEnergyModel::ChangeState (int newState)
     case EndDeviceLoraPhy::TX:
       energyDecrement = duration.GetSeconds () * m_txCurrentA * supplyVoltage;
       m_totalTxTime += duration;
+      if (m_modeTraces)
+        {
+          m_modeTraces->tx (m_txEnergyConsumption, m_txEnergyConsumption + energyDecrement);
+        }
       m_txEnergyConsumption += energyDecrement;
       break;
     case EndDeviceLoraPhy::RX:
       energyDecrement = duration.GetSeconds () * m_rxCurrentA * supplyVoltage;
       m_totalRxTime += duration;
+      if (m_modeTraces)
+        {
+          m_modeTraces->rx (m_rxEnergyConsumption, m_rxEnergyConsumption + energyDecrement);
+        }
       m_rxEnergyConsumption += energyDecrement;
       break;
     case EndDeviceLoraPhy::STANDBY:
       energyDecrement = duration.GetSeconds () * m_standbyCurrentA * supplyVoltage;
       m_totalStandbyTime += duration;
+      if (m_modeTraces)
+        {
+          m_modeTraces->standby (m_standbyEnergyConsumption, m_standbyEnergyConsumption + energyDecrement);
+        }
       m_standbyEnergyConsumption += energyDecrement;
       break;
     case EndDeviceLoraPhy::SLEEP:
       energyDecrement = duration.GetSeconds () * m_sleepCurrentA * supplyVoltage;
       m_totalSleepTime += duration;
+      if (m_modeTraces)
+        {
+          m_modeTraces->sleep (m_sleepEnergyConsumption, m_sleepEnergyConsumption + energyDecrement);
+        }
       m_sleepEnergyConsumption += energyDecrement;
       break;
     default:
       NS_FATAL_ERROR ("Invalid Lora operation State: " << m_currentState);
     }
 
+  // update energy windows, rolled over here instead of by timer events
+  if (m_windows && !m_windows->length.IsZero ())
+    {
+      AccumulateWindows (m_windows->energy, m_windows->current, m_lastStampTime, Simulator::Now (),
+                         m_currentState, energyDecrement);
+    }
+
   // update total energy consumption
   m_totalEnergyConsumption += energyDecrement;
+  LoraEventLog::Write (LoraEventLog::MODEL_ENERGY_DECREMENT, energyDecrement, m_totalEnergyConsumption);
   // update last update time stamp
   m_lastStampTime = Simulator::Now ();
   // notify energy source
@@ -370,6 +507,7 @@ LoraRadioEnergyModel::ChangeState (int newState)
   //If energy not depleted, change state and inform about energy consumption
   if (m_energyDepleted == false)
     {
+      LoraEventLog::Write (LoraEventLog::MODEL_STATE_CHANGE, m_currentState, newState);
       SetLoraPhyState (static_cast<EndDeviceLoraPhy::State>(newState));
       NS_LOG_INFO ("Energy consumption is " << m_totalEnergyConsumption << "J");
     }
@@ -388,6 +526,7 @@ LoraRadioEnergyModel::HandleEnergyDepletion (void)
    {
      NS_LOG_INFO("Energy depletion!");
    }
+  LoraEventLog::Write (LoraEventLog::MODEL_ENERGY_DEPLETED);
 
   m_energyDepleted = true;
 }
@@ -404,6 +543,7 @@ LoraRadioEnergyModel::HandleEnergyRecharged (void)
    {
      NS_LOG_INFO("Energy recharged!");
    }
+  LoraEventLog::Write (LoraEventLog::MODEL_ENERGY_RECHARGED);
 }
 
 void
@@ -420,7 +560,7 @@ LoraEnergyPhyListener *
 LoraRadioEnergyModel::GetPhyListener (void)
 {
   NS_LOG_FUNCTION (this);
-  return m_loraEnergyPhyListener;
+  return &m_loraEnergyPhyListener;
 }
 
 void
@@ -453,6 +593,169 @@ LoraRadioEnergyModel::DoGetCurrentA (void) const
     }
 }
 
+void
+LoraRadioEnergyModel::AccumulateWindows (std::vector<double> &ring, int64_t &current, Time start, Time end,
+                                         EndDeviceLoraPhy::State state, double energyJ) const
+{
+  uint32_t slot;
+  switch (state)
+    {
+    case EndDeviceLoraPhy::TX:
+      slot = 0;
+      break;
+    case EndDeviceLoraPhy::RX:
+      slot = 1;
+      break;
+    case EndDeviceLoraPhy::STANDBY:
+      slot = 2;
+      break;
+    case EndDeviceLoraPhy::SLEEP:
+      slot = 3;
+      break;
+    default:
+      NS_FATAL_ERROR ("Invalid Lora operation State: " << state);
+    }
+
+  NS_ASSERT (m_windows);
+  uint32_t count = m_windows->count;
+  if (ring.empty ())
+    {
+      ring.assign (count * 4, 0.0);
+    }
+
+  int64_t length = m_windows->length.GetTimeStep ();
+  int64_t from = start.GetTimeStep ();
+  int64_t to = end.GetTimeStep ();
+  int64_t window = from / length;
+  //Walk the windows from the segment start to the current one
+  while (true)
+    {
+      if (window > current)
+        {
+          //Windows entered for the first time are cleared
+          int64_t first = std::max (current + 1, window - static_cast<int64_t> (count) + 1);
+          for (int64_t w = first; w <= window; w++)
+            {
+              std::fill_n (ring.begin () + (w % count) * 4, 4, 0.0);
+            }
+          current = window;
+        }
+      int64_t windowEnd = (window + 1) * length;
+      if (from < to)
+        {
+          //Energy split in proportion to the time spent in each window
+          int64_t segmentEnd = std::min (to, windowEnd);
+          ring[(window % count) * 4 + slot] += energyJ * (segmentEnd - from)
+            / (to - start.GetTimeStep ());
+          from = segmentEnd;
+        }
+      if (to < windowEnd)
+        {
+          break;
+        }
+      window++;
+    }
+}
+
+void
+LoraRadioEnergyModel::SetEnergyWindowLength (Time length)
+{
+  NS_LOG_FUNCTION (this << length);
+  NS_ASSERT (!length.IsNegative ());
+  if (!m_windows && length.IsZero ())
+    {
+      //Disabled is the default, nothing to allocate
+      return;
+    }
+  WindowState &windows = GetWindowState ();
+  if (!windows.energy.empty () && length != windows.length)
+    {
+      NS_FATAL_ERROR ("EnergyWindowLength cannot change once energy is accounted in the windows");
+    }
+  windows.length = length;
+}
+
+Time
+LoraRadioEnergyModel::GetEnergyWindowLength (void) const
+{
+  return m_windows ? m_windows->length : Seconds (0);
+}
+
+void
+LoraRadioEnergyModel::SetEnergyWindowCount (uint32_t count)
+{
+  NS_LOG_FUNCTION (this << count);
+  NS_ASSERT (count > 0);
+  if (!m_windows && count == ENERGY_WINDOW_COUNT_DEFAULT)
+    {
+      return;
+    }
+  WindowState &windows = GetWindowState ();
+  //The ring is indexed modulo the count
+  if (!windows.energy.empty () && count != windows.count)
+    {
+      NS_FATAL_ERROR ("EnergyWindowCount cannot change once energy is accounted in the windows");
+    }
+  windows.count = count;
+}
+
+uint32_t
+LoraRadioEnergyModel::GetEnergyWindowCount (void) const
+{
+  return m_windows ? m_windows->count : ENERGY_WINDOW_COUNT_DEFAULT;
+}
+
+LoraRadioEnergyModel::WindowState &
+LoraRadioEnergyModel::GetWindowState (void)
+{
+  if (!m_windows)
+    {
+      m_windows.reset (new WindowState);
+      m_windows->length = Seconds (0);
+      m_windows->count = ENERGY_WINDOW_COUNT_DEFAULT;
+      m_windows->current = 0;
+    }
+  return *m_windows;
+}
+
+std::vector<LoraRadioEnergyModel::EnergyWindow>
+LoraRadioEnergyModel::GetEnergyWindows (void) const
+{
+  NS_LOG_FUNCTION (this);
+  std::vector<EnergyWindow> windows;
+  if (!m_windows || m_windows->length.IsZero ())
+    {
+      return windows;
+    }
+  uint32_t count = m_windows->count;
+
+  //Add the segment still open in the current state to a copy of the ring
+  std::vector<double> ring (m_windows->energy);
+  int64_t current = m_windows->current;
+  double pendingJ = 0.0;
+  if (m_source != NULL)
+    {
+      pendingJ = (Simulator::Now () - m_lastStampTime).GetSeconds () * DoGetCurrentA ()
+        * m_source->GetSupplyVoltage ();
+    }
+  AccumulateWindows (ring, current, m_lastStampTime, Simulator::Now (), m_currentState, pendingJ);
+
+  int64_t first = std::max (static_cast<int64_t> (0), current - static_cast<int64_t> (count) + 1);
+  windows.reserve (current - first + 1);
+  for (int64_t w = first; w <= current; w++)
+    {
+      const double *energy = &ring[(w % count) * 4];
+      EnergyWindow window;
+      window.start          = TimeStep (w * m_windows->length.GetTimeStep ());
+      window.txEnergyJ      = energy[0];
+      window.rxEnergyJ      = energy[1];
+      window.standbyEnergyJ = energy[2];
+      window.sleepEnergyJ   = energy[3];
+      windows.push_back (window);
+    }
+  return windows;
+}
+
 void
 LoraRadioEnergyModel::SetLoraPhyState (const EndDeviceLoraPhy::State state)
 {
@@ -481,40 +784,28 @@ LoraRadioEnergyModel::SetLoraPhyState (const EndDeviceLoraPhy::State state)
 /*
  * LoraEnergyPhyListener Implementation
  */
-LoraEnergyPhyListener::LoraEnergyPhyListener ()
+LoraEnergyPhyListener::LoraEnergyPhyListener (LoraRadioEnergyModel *model)
+  : m_model (model),
+    m_observer (0)
 {
-  //Nullify all used callbacks
-  m_changeStateCB.Nullify ();
-  m_notifyTxConsumptionCB.Nullify ();
 }
 
 LoraEnergyPhyListener::~LoraEnergyPhyListener ()
 {
 }
 
-void
-LoraEnergyPhyListener::RegisterNotifyTransitionCB (DeviceEnergyModel::ChangeStateCallback cb)
-{
-  NS_LOG_FUNCTION (this << &cb);
-  NS_ASSERT (!cb.IsNull ());
-  m_changeStateCB = cb;
-}
-
-void
-LoraEnergyPhyListener::RegisterNotifyTxConsumptionCB (NotifyTxConsumptionCB cb)
-{
-  NS_LOG_FUNCTION (this << &cb);
-  NS_ASSERT (!cb.IsNull ());
-  m_notifyTxConsumptionCB = cb;
-}
-
 void
 LoraEnergyPhyListener::NotifyRxStart ()
 {
   NS_LOG_FUNCTION (this);
   NS_LOG_DEBUG ("[Listener] Notify new state: " << "RX" << " at time = " << Simulator::Now ().GetSeconds () << " s");
-  NS_ASSERT (!m_changeStateCB.IsNull ());
-  m_changeStateCB (EndDeviceLoraPhy::RX);
+  LoraEventLog::Write (LoraEventLog::LISTENER_RX_START);
+  NS_ASSERT (m_model != NULL);
+  m_model->ChangeState (EndDeviceLoraPhy::RX);
+  if (m_observer != 0)
+    {
+      m_observer->NotifyRxStart ();
+    }
 }
 
 void
@@ -522,14 +813,16 @@ LoraEnergyPhyListener::NotifyTxStart (double txPowerDbm)
 {
   NS_LOG_FUNCTION (this << txPowerDbm);
   NS_LOG_DEBUG ("[Listener] Notify new state: " << "TX" << " at time = " << Simulator::Now ().GetSeconds () << " s");
+  LoraEventLog::Write (LoraEventLog::LISTENER_TX_START, txPowerDbm);
 
   //Update  Tx consumption
-  NS_ASSERT (!m_notifyTxConsumptionCB.IsNull ());
-  m_notifyTxConsumptionCB (txPowerDbm);
-
-  NS_ASSERT (!m_changeStateCB.IsNull ());
-  m_changeStateCB (EndDeviceLoraPhy::TX);
-
+  NS_ASSERT (m_model != NULL);
+  m_model->CalcTxCurrentFromModel (txPowerDbm);
+  m_model->ChangeState (EndDeviceLoraPhy::TX);
+  if (m_observer != 0)
+    {
+      m_observer->NotifyTxStart (txPowerDbm);
+    }
 }
 
 void
@@ -537,8 +830,13 @@ LoraEnergyPhyListener::NotifySleep (void)
 {
   NS_LOG_FUNCTION (this);
   NS_LOG_DEBUG ("[Listener] Notify new state: " << "SLEEP" << " at time = " << Simulator::Now ().GetSeconds () << " s");
-  NS_ASSERT (!m_changeStateCB.IsNull ());
-  m_changeStateCB (EndDeviceLoraPhy::SLEEP);
+  LoraEventLog::Write (LoraEventLog::LISTENER_SLEEP);
+  NS_ASSERT (m_model != NULL);
+  m_model->ChangeState (EndDeviceLoraPhy::SLEEP);
+  if (m_observer != 0)
+    {
+      m_observer->NotifySleep ();
+    }
 }
 
 void
@@ -546,8 +844,27 @@ LoraEnergyPhyListener::NotifyStandby (void)
 {
   NS_LOG_FUNCTION (this);
   NS_LOG_DEBUG ("[Listener] Notify new state: " << "STANDBY" << " at time = " << Simulator::Now ().GetSeconds () << " s");
-  NS_ASSERT (!m_changeStateCB.IsNull ());
-  m_changeStateCB (EndDeviceLoraPhy::STANDBY);
+  LoraEventLog::Write (LoraEventLog::LISTENER_STANDBY);
+  NS_ASSERT (m_model != NULL);
+  m_model->ChangeState (EndDeviceLoraPhy::STANDBY);
+  if (m_observer != 0)
+    {
+      m_observer->NotifyStandby ();
+    }
+}
+
+void
+LoraEnergyPhyListener::SetObserver (LoraPhyListener *observer)
+{
+  NS_LOG_FUNCTION (this << observer);
+  NS_ASSERT_MSG (observer == 0 || m_observer == 0, "Energy listener already observed");
+  m_observer = observer;
+}
+
+LoraPhyListener *
+LoraEnergyPhyListener::GetObserver (void) const
+{
+  return m_observer;
 }
 
 
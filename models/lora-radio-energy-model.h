@@ -23,8 +23,15 @@
 #include "ns3/end-device-lora-phy.h"
 #include "ns3/lora-consumption-model.h"
 #include "ns3/lora-phy-listener.h"
+#include "ns3/lora-object-pool.h"
+#include "ns3/lora-lazy-trace.h"
+#include <memory>
+#include <vector>
 
 namespace ns3 {
+
+class LoraRadioEnergyModel;
+
 /**
  * \ingroup energy
  *
@@ -38,31 +45,28 @@ class LoraEnergyPhyListener : public LoraPhyListener
 {
 public:
 
-  //Callback type to notify Tx consumption (interpolated -consumption model)
-  typedef Callback<void, double> NotifyTxConsumptionCB;
-
-  LoraEnergyPhyListener ();
+  //The listener is embedded in the model it notifies
+  LoraEnergyPhyListener (LoraRadioEnergyModel *model);
   virtual ~LoraEnergyPhyListener ();
 
-  //Register Callback after a state transition
-  void RegisterNotifyTransitionCB (DeviceEnergyModel::ChangeStateCallback cb);
-
-  //Register SetUpdateTxCurrentCallback
-  void RegisterNotifyTxConsumptionCB (NotifyTxConsumptionCB cb);
-
   //Notify start of transmission/reception/standby/sleep
   void NotifyTxStart (double txPowerDbm);
   void NotifyRxStart (void);
   void NotifySleep   (void);
   void NotifyStandby (void);
 
+  //Listener notified after the model of every transition (0 to remove).
+  //Not owned, one at a time.
+  void SetObserver (LoraPhyListener *observer);
+  LoraPhyListener * GetObserver (void) const;
+
 private:
 
-  //Calback to inform about a transition in operation mode of Lora transceiver
-  //TX-RX-STANDBY-SLEEP
-  DeviceEnergyModel::ChangeStateCallback m_changeStateCB;
-  //Callback to inform about the current consumption in TX mode of Lora transceiver
-  NotifyTxConsumptionCB m_notifyTxConsumptionCB;
+  //Model informed about transitions in operation mode of Lora transceiver
+  //(TX-RX-STANDBY-SLEEP) and about the Tx power used
+  LoraRadioEnergyModel *m_model;
+  //Optional observer of the same transitions
+  LoraPhyListener *m_observer;
 };
 
 
@@ -85,10 +89,16 @@ public:
   LoraRadioEnergyModel ();
   virtual ~LoraRadioEnergyModel ();
 
+  //Models are served from a pooled arena (see LoraObjectPool)
+  static void * operator new (std::size_t size);
+  static void operator delete (void *p, std::size_t size);
+
   //Connect EnergySource
   void SetEnergySource (Ptr<EnergySource> source);
+  Ptr<EnergySource> GetEnergySource (void) const;
   //Connect Consumption model
   void SetConsumptionModel (Ptr<LoraConsumptionModel> model);
+  Ptr<LoraConsumptionModel> GetConsumptionModel (void) const;
 
   //Get Energy Consumption in different operation modes
   double GetTxEnergyConsumption (void) const;
@@ -117,8 +127,42 @@ public:
   void SetStandbyCurrentA (double standbyCurrentA);
   void SetSleepCurrentA (double sleepCurrentA);
 
+  //Apply per-device multiplicative spread to the current in every mode
+  //(TX factor is also applied to currents from the consumption model)
+  void ApplyCurrentSpread (double txFactor, double rxFactor,
+                           double standbyFactor, double sleepFactor);
+  double GetTxCurrentFactor (void) const;
+
+  //Energy per state in one time window
+  struct EnergyWindow
+  {
+    Time start;
+    double txEnergyJ;
+    double rxEnergyJ;
+    double standbyEnergyJ;
+    double sleepEnergyJ;
+  };
+
+  //Energy windows configuration (EnergyWindowLength/EnergyWindowCount
+  //attributes). Neither can change once energy has been accounted in the
+  //windows.
+  void SetEnergyWindowLength (Time length);
+  Time GetEnergyWindowLength (void) const;
+  void SetEnergyWindowCount (uint32_t count);
+  uint32_t GetEnergyWindowCount (void) const;
+
+  //Per-window, per-state energy of the last EnergyWindowCount windows of
+  //EnergyWindowLength (oldest first, current window included up to now).
+  //Empty if windows are disabled (EnergyWindowLength = 0).
+  std::vector<EnergyWindow> GetEnergyWindows (void) const;
+
+  //Typed connection to TotalEnergyConsumption trace (no TypeId or path lookup)
+  void ConnectTotalEnergyConsumption (Callback<void, double, double> cb);
+
   //Get Current State of Lora-PHY
   EndDeviceLoraPhy::State GetCurrentState (void) const;
+  //Time of the last state change, energy is accounted up to it
+  Time GetLastStampTime (void) const;
 
   void RegisterEnergyDepletionCB (LoraEnergyDepletionCB cb);
   void RegisterEnergyRechargedCB (LoraEnergyRechargedCB cb);
@@ -137,12 +181,31 @@ public:
   LoraEnergyPhyListener * GetPhyListener (void);
 
 private:
+  //Ring of per-window, per-state energy. The state is only allocated when
+  //the windows are configured away from the defaults, the ring on first use
+  struct WindowState
+  {
+    Time length;
+    uint32_t count;
+    int64_t current;
+    std::vector<double> energy;
+  };
+
   void DoDispose (void);
   double DoGetCurrentA (void) const;
   void SetLoraPhyState (const EndDeviceLoraPhy::State state);
-
-  //Lora-Phy listener
-  LoraEnergyPhyListener *m_loraEnergyPhyListener;
+  //Per-mode energy trace sources, allocated on first connection
+  static TracedCallback<double, double> & GetTxEnergyTrace (LoraRadioEnergyModel *model);
+  static TracedCallback<double, double> & GetRxEnergyTrace (LoraRadioEnergyModel *model);
+  static TracedCallback<double, double> & GetStandbyEnergyTrace (LoraRadioEnergyModel *model);
+  static TracedCallback<double, double> & GetSleepEnergyTrace (LoraRadioEnergyModel *model);
+  WindowState & GetWindowState (void);
+  //Split the energy of a state segment over the windows it spans
+  void AccumulateWindows (std::vector<double> &ring, int64_t &current, Time start, Time end,
+                          EndDeviceLoraPhy::State state, double energyJ) const;
+
+  //Lora-Phy listener (embedded, no separate allocation)
+  LoraEnergyPhyListener m_loraEnergyPhyListener;
   //Energy Source used
   Ptr<EnergySource> m_source;
   //Consumption Model used
@@ -153,18 +216,29 @@ private:
   double  m_rxCurrentA;
   double  m_standbyCurrentA;
   double  m_sleepCurrentA;
+  //Device spread applied to Tx current given by consumption model
+  double  m_txCurrentFactor;
 
-  //Traced values to track energy consumption in different operation modes
+  //Traced total energy consumption, per mode consumption is plain data
   TracedValue<double> m_totalEnergyConsumption;
-  TracedValue<double> m_txEnergyConsumption;
-  TracedValue<double> m_rxEnergyConsumption;
-  TracedValue<double> m_standbyEnergyConsumption;
-  TracedValue<double> m_sleepEnergyConsumption;
-
-  //Variables to handle states
+  double m_txEnergyConsumption;
+  double m_rxEnergyConsumption;
+  double m_standbyEnergyConsumption;
+  double m_sleepEnergyConsumption;
+  //Traces of the per-mode energies, only allocated once connected
+  struct ModeTraces
+  {
+    TracedCallback<double, double> tx;
+    TracedCallback<double, double> rx;
+    TracedCallback<double, double> standby;
+    TracedCallback<double, double> sleep;
+  };
+  std::unique_ptr<ModeTraces> m_modeTraces;
+
+  //Variables to handle states (packed together)
   EndDeviceLoraPhy::State m_currentState;
-  Time m_lastStampTime;
   bool m_energyDepleted;
+  Time m_lastStampTime;
 
   //Variables to handle time in different operation modes
   Time m_totalTxTime;
@@ -172,6 +246,8 @@ private:
   Time m_totalStandbyTime;
   Time m_totalSleepTime;
 
+  std::unique_ptr<WindowState> m_windows;
+
   //Callbacks to handle state of energy source
   LoraEnergyDepletionCB m_energyDepletionCB;
   LoraEnergyRechargedCB m_energyRechargedCB;
@@ -0,0 +1,302 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#include "lora-radio-state-trace.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/simulator.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "ns3/string.h"
+#include "ns3/lora-counter-rng.h"
+#include "ns3/rng-seed-manager.h"
+#include <iomanip>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LoraRadioStateTrace");
+
+NS_OBJECT_ENSURE_REGISTERED (LoraRadioStateTrace);
+
+TypeId
+LoraRadioStateTrace::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LoraRadioStateTrace")
+    .SetParent<Object> ()
+    .SetGroupName ("Energy")
+    .AddConstructor<LoraRadioStateTrace> ()
+    .AddAttribute ("SamplingRatio",
+                   "Fraction of end devices traced.",
+                   DoubleValue (0.01),
+                   MakeDoubleAccessor (&LoraRadioStateTrace::m_samplingRatio),
+                   MakeDoubleChecker<double> (0, 1))
+    .AddAttribute ("Seed",
+                   "Seed of the node sampling, 0 derives it from the global seed and run.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&LoraRadioStateTrace::m_seed),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("StartTime",
+                   "Start of the traced window.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&LoraRadioStateTrace::m_startTime),
+                   MakeTimeChecker ())
+    .AddAttribute ("StopTime",
+                   "End of the traced window, 0 traces until Finish.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&LoraRadioStateTrace::m_stopTime),
+                   MakeTimeChecker ())
+    .AddAttribute ("FileName",
+                   "Trace-event JSON file.",
+                   StringValue ("lora-radio-states.json"),
+                   MakeStringAccessor (&LoraRadioStateTrace::m_fileName),
+                   MakeStringChecker ())
+  ;
+  return tid;
+}
+
+LoraRadioStateTrace::LoraRadioStateTrace ()
+  : m_samplingRatio (0.01),
+    m_seed (0),
+    m_startTime (Seconds (0)),
+    m_stopTime (Seconds (0)),
+    m_finished (false),
+    m_nEvents (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+LoraRadioStateTrace::~LoraRadioStateTrace ()
+{
+  NS_LOG_FUNCTION (this);
+  RemoveListeners ();
+  //Not disposed nor finished: open segments are lost but the file stays
+  //valid JSON
+  if (m_file.is_open () && !m_finished)
+    {
+      m_file << "\n]}\n";
+      m_file.close ();
+      m_finished = true;
+    }
+}
+
+void
+LoraRadioStateTrace::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  Finish ();
+  RemoveListeners ();
+  Object::DoDispose ();
+}
+
+void
+LoraRadioStateTrace::RemoveListeners (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (uint32_t i = 0; i < m_listeners.size (); i++)
+    {
+      LoraEnergyPhyListener *energyListener = m_models[i]->GetPhyListener ();
+      if (energyListener->GetObserver () == m_listeners[i])
+        {
+          energyListener->SetObserver (0);
+        }
+      delete m_listeners[i];
+    }
+  m_listeners.clear ();
+  m_models.clear ();
+}
+
+bool
+LoraRadioStateTrace::IsSampled (uint32_t nodeId) const
+{
+  uint64_t seed = m_seed;
+  if (seed == 0)
+    {
+      seed = (static_cast<uint64_t> (RngSeedManager::GetSeed ()) << 32) ^ RngSeedManager::GetRun ();
+    }
+  //Draw index 0 of the node stream, independent of install order
+  return LoraCounterRng (seed, nodeId).GetUniform (0) < m_samplingRatio;
+}
+
+void
+LoraRadioStateTrace::Install (Ptr<LoraEnergyMonitor> monitor)
+{
+  NS_LOG_FUNCTION (this << monitor);
+  NS_ASSERT (m_listeners.empty ());
+
+  m_file.open (m_fileName.c_str ());
+  if (!m_file.is_open ())
+    {
+      NS_FATAL_ERROR ("Cannot open " << m_fileName);
+    }
+  m_file << std::fixed << std::setprecision (3);
+  m_file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+         << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+         << "\"args\":{\"name\":\"End device radios\"}}";
+
+  for (LoraEnergyMonitor::Iterator i = monitor->Begin (); i != monitor->End (); ++i)
+    {
+      uint32_t nodeId = i->node->GetId ();
+      if (!IsSampled (nodeId))
+        {
+          continue;
+        }
+      //The energy listener forwards the PHY notifications after updating
+      //the model, no second listener on the PHY
+      StateListener *listener = new StateListener (this, nodeId, i->model->GetCurrentState ());
+      i->model->GetPhyListener ()->SetObserver (listener);
+      m_listeners.push_back (listener);
+      m_models.push_back (i->model);
+
+      //One named track per node
+      m_file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << nodeId
+             << ",\"args\":{\"name\":\"ED " << nodeId << "\"}}";
+    }
+  NS_LOG_INFO ("Tracing radio states of " << m_listeners.size () << " of "
+               << monitor->GetN () << " end devices");
+}
+
+void
+LoraRadioStateTrace::Finish (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_finished || !m_file.is_open ())
+    {
+      return;
+    }
+  for (uint32_t i = 0; i < m_listeners.size (); i++)
+    {
+      //Writes the open segment, later notifications are ignored
+      m_listeners[i]->Switch (EndDeviceLoraPhy::SLEEP, 0);
+    }
+  m_file << "\n]}\n";
+  m_file.close ();
+  m_finished = true;
+  NS_LOG_INFO ("Wrote " << m_nEvents << " radio state events to " << m_fileName);
+}
+
+uint32_t
+LoraRadioStateTrace::GetNSampledNodes (void) const
+{
+  return m_listeners.size ();
+}
+
+uint64_t
+LoraRadioStateTrace::GetNEvents (void) const
+{
+  return m_nEvents;
+}
+
+void
+LoraRadioStateTrace::WriteSegment (uint32_t nodeId, EndDeviceLoraPhy::State state,
+                                   Time start, Time end, double txPowerDbm)
+{
+  if (m_finished)
+    {
+      return;
+    }
+  //Clip to the window
+  start = Max (start, m_startTime);
+  if (!m_stopTime.IsZero ())
+    {
+      end = Min (end, m_stopTime);
+    }
+  if (end <= start)
+    {
+      return;
+    }
+
+  const char *name = "SLEEP";
+  switch (state)
+    {
+    case EndDeviceLoraPhy::TX:
+      name = "TX";
+      break;
+    case EndDeviceLoraPhy::RX:
+      name = "RX";
+      break;
+    case EndDeviceLoraPhy::STANDBY:
+      name = "STANDBY";
+      break;
+    default:
+      break;
+    }
+
+  //Timestamps and durations in microseconds
+  m_file << ",\n{\"name\":\"" << name << "\",\"cat\":\"radio\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+         << nodeId << ",\"ts\":" << start.GetNanoSeconds () / 1e3
+         << ",\"dur\":" << (end - start).GetNanoSeconds () / 1e3;
+  if (state == EndDeviceLoraPhy::TX)
+    {
+      m_file << ",\"args\":{\"dBm\":" << txPowerDbm << "}";
+    }
+  m_file << "}";
+  m_nEvents++;
+}
+
+/*
+ * StateListener Implementation
+ */
+LoraRadioStateTrace::StateListener::StateListener (LoraRadioStateTrace *trace, uint32_t nodeId,
+                                                   EndDeviceLoraPhy::State state)
+  : m_trace (trace),
+    m_nodeId (nodeId),
+    m_state (state),
+    m_since (Simulator::Now ()),
+    m_txPowerDbm (0)
+{
+}
+
+LoraRadioStateTrace::StateListener::~StateListener ()
+{
+}
+
+void
+LoraRadioStateTrace::StateListener::NotifyRxStart (void)
+{
+  Switch (EndDeviceLoraPhy::RX, 0);
+}
+
+void
+LoraRadioStateTrace::StateListener::NotifyTxStart (double txPowerDbm)
+{
+  Switch (EndDeviceLoraPhy::TX, txPowerDbm);
+}
+
+void
+LoraRadioStateTrace::StateListener::NotifySleep (void)
+{
+  Switch (EndDeviceLoraPhy::SLEEP, 0);
+}
+
+void
+LoraRadioStateTrace::StateListener::NotifyStandby (void)
+{
+  Switch (EndDeviceLoraPhy::STANDBY, 0);
+}
+
+void
+LoraRadioStateTrace::StateListener::Switch (EndDeviceLoraPhy::State state, double txPowerDbm)
+{
+  Time now = Simulator::Now ();
+  m_trace->WriteSegment (m_nodeId, m_state, m_since, now, m_txPowerDbm);
+  m_state = state;
+  m_since = now;
+  m_txPowerDbm = txPowerDbm;
+}
+
+} // namespace ns3
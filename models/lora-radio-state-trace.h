@@ -0,0 +1,111 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#ifndef LORA_RADIO_STATE_TRACE_H
+#define LORA_RADIO_STATE_TRACE_H
+
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/end-device-lora-phy.h"
+#include "ns3/lora-radio-energy-model.h"
+#include "ns3/lora-phy-listener.h"
+#include "ns3/lora-energy-monitor.h"
+#include <fstream>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup energy
+ *
+ * \brief Radio state timelines of sampled end devices as a Chrome trace
+ *
+ * A listener observes the energy PHY listener of a sampled subset of the
+ * devices of the monitor (node kept if a counter-based draw on its id is
+ * below SamplingRatio, so the subset does not depend on install order); no
+ * listener is added to the PHYs. Every
+ * state segment (TX, RX, STANDBY, SLEEP) overlapping [StartTime, StopTime]
+ * is clipped to that window and streamed as a trace-event JSON "complete"
+ * event, one track per node. The file opens in chrome://tracing or in the
+ * Perfetto UI.
+ */
+class LoraRadioStateTrace : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+  LoraRadioStateTrace ();
+  virtual ~LoraRadioStateTrace ();
+
+  //Open the file and observe the energy listeners of the sampled devices
+  void Install (Ptr<LoraEnergyMonitor> monitor);
+  //Close the open segments at the current time and terminate the file
+  void Finish (void);
+
+  uint32_t GetNSampledNodes (void) const;
+  uint64_t GetNEvents (void) const;
+
+private:
+  //Listener of one sampled device, holds its open segment
+  class StateListener : public LoraPhyListener
+  {
+  public:
+    StateListener (LoraRadioStateTrace *trace, uint32_t nodeId,
+                   EndDeviceLoraPhy::State state);
+    virtual ~StateListener ();
+
+    virtual void NotifyRxStart (void);
+    virtual void NotifyTxStart (double txPowerDbm);
+    virtual void NotifySleep (void);
+    virtual void NotifyStandby (void);
+
+    //Close the open segment at now and open one in the new state
+    void Switch (EndDeviceLoraPhy::State state, double txPowerDbm);
+
+  private:
+    LoraRadioStateTrace *m_trace;
+    uint32_t m_nodeId;
+    EndDeviceLoraPhy::State m_state;
+    Time m_since;
+    double m_txPowerDbm;
+  };
+
+  void DoDispose (void);
+  //Stop observing the energy listeners and free the listeners
+  void RemoveListeners (void);
+  bool IsSampled (uint32_t nodeId) const;
+  void WriteSegment (uint32_t nodeId, EndDeviceLoraPhy::State state,
+                     Time start, Time end, double txPowerDbm);
+
+  double m_samplingRatio;
+  uint32_t m_seed;
+  Time m_startTime;
+  Time m_stopTime;
+  std::string m_fileName;
+
+  std::ofstream m_file;
+  bool m_finished;
+  uint64_t m_nEvents;
+  //Owned here, the energy listeners keep raw pointers
+  std::vector<StateListener *> m_listeners;
+  //Models whose energy listener is observed, same order as m_listeners
+  std::vector<Ptr<LoraRadioEnergyModel> > m_models;
+};
+
+} // namespace ns3
+
+#endif /* LORA_RADIO_STATE_TRACE_H */
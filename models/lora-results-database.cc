@@ -0,0 +1,288 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#include "lora-results-database.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/rng-seed-manager.h"
+#include <chrono>
+#ifdef HAVE_SQLITE3
+#include <sqlite3.h>
+#endif
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LoraResultsDatabase");
+
+namespace {
+
+double
+WallClockS (void)
+{
+  return std::chrono::duration<double> (std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+}
+
+} // anonymous namespace
+
+LoraResultsDatabase::LoraResultsDatabase ()
+  : m_db (0),
+    m_runId (-1),
+    m_nodes (0),
+    m_runStartS (0)
+{
+}
+
+LoraResultsDatabase::~LoraResultsDatabase ()
+{
+  Close ();
+}
+
+bool
+LoraResultsDatabase::IsOpen (void) const
+{
+  return m_db != 0;
+}
+
+#ifdef HAVE_SQLITE3
+
+bool
+LoraResultsDatabase::IsAvailable (void)
+{
+  return true;
+}
+
+bool
+LoraResultsDatabase::TryExecute (std::string sql, std::string &error)
+{
+  char *message = 0;
+  if (sqlite3_exec (m_db, sql.c_str (), 0, 0, &message) != SQLITE_OK)
+    {
+      error = message != 0 ? message : sqlite3_errmsg (m_db);
+      sqlite3_free (message);
+      return false;
+    }
+  return true;
+}
+
+void
+LoraResultsDatabase::Execute (std::string sql)
+{
+  std::string error;
+  if (!TryExecute (sql, error))
+    {
+      NS_FATAL_ERROR ("SQLite error: " << error << " in: " << sql);
+    }
+}
+
+sqlite3_stmt *
+LoraResultsDatabase::Prepare (std::string sql)
+{
+  sqlite3_stmt *statement = 0;
+  if (sqlite3_prepare_v2 (m_db, sql.c_str (), -1, &statement, 0) != SQLITE_OK)
+    {
+      NS_FATAL_ERROR ("SQLite error: " << sqlite3_errmsg (m_db) << " in: " << sql);
+    }
+  return statement;
+}
+
+bool
+LoraResultsDatabase::Open (std::string fileName)
+{
+  NS_LOG_FUNCTION (this << fileName);
+  Close ();
+  if (sqlite3_open (fileName.c_str (), &m_db) != SQLITE_OK)
+    {
+      NS_LOG_ERROR ("Cannot open results database " << fileName << ": " << sqlite3_errmsg (m_db));
+      Close ();
+      return false;
+    }
+  //Several replications may write the same file one after another
+  sqlite3_busy_timeout (m_db, 60000);
+  static const char *schema[] = {
+    "PRAGMA journal_mode=WAL;",
+    "PRAGMA synchronous=NORMAL;",
+    "CREATE TABLE IF NOT EXISTS runs ("
+    " run_id INTEGER PRIMARY KEY AUTOINCREMENT,"
+    " scenario TEXT, parameters TEXT, seed INTEGER, run INTEGER,"
+    " started TEXT DEFAULT CURRENT_TIMESTAMP,"
+    " wall_time_s REAL, sim_time_s REAL, n_nodes INTEGER);",
+    "CREATE TABLE IF NOT EXISTS node_energy ("
+    " run_id INTEGER NOT NULL REFERENCES runs(run_id),"
+    " node_id INTEGER, sf INTEGER, x REAL, y REAL, z REAL, voltage_v REAL,"
+    " tx_s REAL, rx_s REAL, standby_s REAL, sleep_s REAL,"
+    " tx_j REAL, rx_j REAL, standby_j REAL, sleep_j REAL,"
+    " total_j REAL, initial_j REAL, remaining_j REAL);",
+    "CREATE INDEX IF NOT EXISTS node_energy_run ON node_energy(run_id);",
+    "CREATE INDEX IF NOT EXISTS node_energy_sf ON node_energy(sf, run_id);",
+    "CREATE INDEX IF NOT EXISTS node_energy_node ON node_energy(node_id, run_id);"
+  };
+  for (uint32_t i = 0; i < sizeof (schema) / sizeof (schema[0]); i++)
+    {
+      std::string error;
+      if (!TryExecute (schema[i], error))
+        {
+          NS_LOG_ERROR ("Cannot create the schema of " << fileName << ": " << error);
+          Close ();
+          return false;
+        }
+    }
+  return true;
+}
+
+void
+LoraResultsDatabase::Close (void)
+{
+  if (m_db != 0)
+    {
+      sqlite3_close (m_db);
+      m_db = 0;
+    }
+}
+
+int64_t
+LoraResultsDatabase::BeginRun (std::string scenario, std::string parameters)
+{
+  NS_LOG_FUNCTION (this << scenario << parameters);
+  NS_ASSERT (IsOpen ());
+  sqlite3_stmt *statement = Prepare ("INSERT INTO runs (scenario, parameters, seed, run) VALUES (?, ?, ?, ?);");
+  sqlite3_bind_text (statement, 1, scenario.c_str (), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_text (statement, 2, parameters.c_str (), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int64 (statement, 3, RngSeedManager::GetSeed ());
+  sqlite3_bind_int64 (statement, 4, RngSeedManager::GetRun ());
+  if (sqlite3_step (statement) != SQLITE_DONE)
+    {
+      NS_FATAL_ERROR ("Cannot insert run: " << sqlite3_errmsg (m_db));
+    }
+  sqlite3_finalize (statement);
+
+  m_runId = sqlite3_last_insert_rowid (m_db);
+  m_nodes = 0;
+  m_runStartS = WallClockS ();
+  NS_LOG_INFO ("Results stored as run " << m_runId);
+  return m_runId;
+}
+
+void
+LoraResultsDatabase::InsertNodeEnergy (Ptr<LoraEnergyMonitor> monitor)
+{
+  NS_LOG_FUNCTION (this << monitor);
+  NS_ASSERT_MSG (m_runId >= 0, "BeginRun must be called first");
+  sqlite3_stmt *statement = Prepare ("INSERT INTO node_energy VALUES "
+                                     "(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);");
+
+  //One transaction per batch, a single commit per row would dominate
+  uint32_t inBatch = 0;
+  Execute ("BEGIN TRANSACTION;");
+  for (LoraEnergyMonitor::Iterator i = monitor->Begin (); i != monitor->End (); ++i)
+    {
+      NS_ASSERT (i->mac != NULL && i->mobility != NULL);
+      Vector position = i->mobility->GetPosition ();
+      int column = 1;
+      sqlite3_bind_int64 (statement, column++, m_runId);
+      sqlite3_bind_int (statement, column++, i->node->GetId ());
+      sqlite3_bind_int (statement, column++, i->mac->GetSfFromDataRate (i->mac->GetDataRate ()));
+      sqlite3_bind_double (statement, column++, position.x);
+      sqlite3_bind_double (statement, column++, position.y);
+      sqlite3_bind_double (statement, column++, position.z);
+      sqlite3_bind_double (statement, column++, i->source->GetSupplyVoltage ());
+      sqlite3_bind_double (statement, column++, i->model->GetTotalTxTime ().GetSeconds ());
+      sqlite3_bind_double (statement, column++, i->model->GetTotalRxTime ().GetSeconds ());
+      sqlite3_bind_double (statement, column++, i->model->GetTotalStandbyTime ().GetSeconds ());
+      sqlite3_bind_double (statement, column++, i->model->GetTotalSleepTime ().GetSeconds ());
+      sqlite3_bind_double (statement, column++, i->model->GetTxEnergyConsumption ());
+      sqlite3_bind_double (statement, column++, i->model->GetRxEnergyConsumption ());
+      sqlite3_bind_double (statement, column++, i->model->GetStandbyEnergyConsumption ());
+      sqlite3_bind_double (statement, column++, i->model->GetSleepEnergyConsumption ());
+      sqlite3_bind_double (statement, column++, i->model->GetTotalEnergyConsumption ());
+      sqlite3_bind_double (statement, column++, i->source->GetInitialEnergy ());
+      sqlite3_bind_double (statement, column++, i->source->GetRemainingEnergy ());
+      if (sqlite3_step (statement) != SQLITE_DONE)
+        {
+          NS_FATAL_ERROR ("Cannot insert node " << i->node->GetId () << ": " << sqlite3_errmsg (m_db));
+        }
+      sqlite3_reset (statement);
+      m_nodes++;
+
+      if (++inBatch == BATCH_SIZE)
+        {
+          Execute ("COMMIT;");
+          Execute ("BEGIN TRANSACTION;");
+          inBatch = 0;
+        }
+    }
+  Execute ("COMMIT;");
+  sqlite3_finalize (statement);
+}
+
+void
+LoraResultsDatabase::EndRun (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT_MSG (m_runId >= 0, "BeginRun must be called first");
+  sqlite3_stmt *statement = Prepare ("UPDATE runs SET wall_time_s = ?, sim_time_s = ?, n_nodes = ? WHERE run_id = ?;");
+  sqlite3_bind_double (statement, 1, WallClockS () - m_runStartS);
+  sqlite3_bind_double (statement, 2, Simulator::Now ().GetSeconds ());
+  sqlite3_bind_int (statement, 3, m_nodes);
+  sqlite3_bind_int64 (statement, 4, m_runId);
+  if (sqlite3_step (statement) != SQLITE_DONE)
+    {
+      NS_FATAL_ERROR ("Cannot update run " << m_runId << ": " << sqlite3_errmsg (m_db));
+    }
+  sqlite3_finalize (statement);
+  m_runId = -1;
+}
+
+#else /* HAVE_SQLITE3 */
+
+bool
+LoraResultsDatabase::IsAvailable (void)
+{
+  return false;
+}
+
+bool
+LoraResultsDatabase::Open (std::string fileName)
+{
+  NS_LOG_WARN ("lorawan built without SQLite (HAVE_SQLITE3), results database " << fileName << " not written");
+  return false;
+}
+
+void
+LoraResultsDatabase::Close (void)
+{
+}
+
+int64_t
+LoraResultsDatabase::BeginRun (std::string scenario, std::string parameters)
+{
+  return -1;
+}
+
+void
+LoraResultsDatabase::InsertNodeEnergy (Ptr<LoraEnergyMonitor> monitor)
+{
+}
+
+void
+LoraResultsDatabase::EndRun (void)
+{
+}
+
+#endif /* HAVE_SQLITE3 */
+
+} // namespace ns3
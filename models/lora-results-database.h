@@ -0,0 +1,94 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#ifndef LORA_RESULTS_DATABASE_H
+#define LORA_RESULTS_DATABASE_H
+
+#include "ns3/simple-ref-count.h"
+#include "ns3/lora-energy-monitor.h"
+#include <stdint.h>
+#include <string>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace ns3 {
+
+/**
+ * \ingroup energy
+ *
+ * \brief SQLite store of the results of many runs
+ *
+ * Every run appends a row to the runs table (scenario, parameters, seed,
+ * run number, sim and wall time) and one row per end device to the
+ * node_energy table, inserted with a prepared statement in transactions
+ * of BATCH_SIZE rows. Indexes on run, SF and node keep queries over
+ * hundreds of replications fast:
+ *
+ *   runs        (run_id, scenario, parameters, seed, run, started,
+ *                wall_time_s, sim_time_s, n_nodes)
+ *   node_energy (run_id, node_id, sf, x, y, z, voltage_v, tx_s, rx_s,
+ *                standby_s, sleep_s, tx_j, rx_j, standby_j, sleep_j,
+ *                total_j, initial_j, remaining_j)
+ *
+ * Only available when the lorawan module is compiled with HAVE_SQLITE3
+ * defined and linked with SQLite (see README); otherwise IsAvailable and
+ * Open return false and nothing is written.
+ *
+ * Open reports failures through its return value (and NS_LOG_ERROR).
+ * Once open, any SQLite error is fatal.
+ */
+class LoraResultsDatabase : public SimpleRefCount<LoraResultsDatabase>
+{
+public:
+  LoraResultsDatabase ();
+  ~LoraResultsDatabase ();
+
+  //True if the module was built with SQLite
+  static bool IsAvailable (void);
+  //Open or create the database and its schema, false on failure
+  bool Open (std::string fileName);
+  void Close (void);
+  bool IsOpen (void) const;
+
+  //Start a run (seed and run number from RngSeedManager), return its id
+  int64_t BeginRun (std::string scenario, std::string parameters);
+  //Insert one row per device of the monitor in the current run
+  void InsertNodeEnergy (Ptr<LoraEnergyMonitor> monitor);
+  //Record sim time, wall time and number of nodes of the current run
+  void EndRun (void);
+
+private:
+  static const uint32_t BATCH_SIZE = 10000;
+
+  //Run a statement, false and the SQLite message on failure
+  bool TryExecute (std::string sql, std::string &error);
+  //Same, fatal on failure
+  void Execute (std::string sql);
+  //Prepared statement, fatal on failure
+  sqlite3_stmt * Prepare (std::string sql);
+
+  sqlite3 *m_db;
+  int64_t m_runId;
+  uint32_t m_nodes;
+  double m_runStartS;
+};
+
+} // namespace ns3
+
+#endif /* LORA_RESULTS_DATABASE_H */
@@ -0,0 +1,85 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#ifndef LORA_SPSC_QUEUE_H
+#define LORA_SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+namespace ns3 {
+
+/**
+ * \ingroup energy
+ *
+ * \brief Bounded lock-free queue, one producer thread and one consumer thread
+ *
+ * The simulation thread pushes, a side thread pops. Neither side ever
+ * blocks: Push fails when the queue is full and Pop fails when it is empty.
+ * One slot is kept free to tell full from empty, so at most N-1 items fit.
+ */
+template <typename T, std::size_t N>
+class LoraSpscQueue
+{
+public:
+  LoraSpscQueue () : m_head (0), m_tail (0)
+  {
+  }
+
+  //Producer side
+  bool Push (const T &item)
+  {
+    std::size_t tail = m_tail.load (std::memory_order_relaxed);
+    std::size_t next = (tail + 1) % N;
+    if (next == m_head.load (std::memory_order_acquire))
+      {
+        return false;
+      }
+    m_items[tail] = item;
+    m_tail.store (next, std::memory_order_release);
+    return true;
+  }
+
+  //Consumer side
+  bool Pop (T &item)
+  {
+    std::size_t head = m_head.load (std::memory_order_relaxed);
+    if (head == m_tail.load (std::memory_order_acquire))
+      {
+        return false;
+      }
+    item = m_items[head];
+    m_head.store ((head + 1) % N, std::memory_order_release);
+    return true;
+  }
+
+  bool IsEmpty (void) const
+  {
+    return m_head.load (std::memory_order_acquire) == m_tail.load (std::memory_order_acquire);
+  }
+
+private:
+  T m_items[N];
+  //Head and tail on separate cache lines, each written by one thread only
+  alignas (64) std::atomic<std::size_t> m_head;
+  alignas (64) std::atomic<std::size_t> m_tail;
+};
+
+} //namespace ns3
+
+#endif /* LORA_SPSC_QUEUE_H */
@@ -27,13 +27,23 @@
 #include "ns3/mobility-model.h"
 #include "ns3/lora-energy-source.h"
 #include "ns3/lora-radio-energy-model.h"
+#include "ns3/lora-consumption-model.h"
+#include "ns3/lora-energy-monitor.h"
 #include "ns3/device-energy-model-container.h"
 #include "ns3/energy-source.h"
 #include "ns3/buildings-module.h"
+#include "ns3/lora-building-export.h"
+#include "ns3/lora-counting-scheduler.h"
+#include "ns3/lora-process-info.h"
 #include <iomanip>
 #include <fstream>
 #include <algorithm>
+#include <set>
+#include <limits>
+#include <iostream>
+#include <sstream>
 
+#define BUILDINGS_FILE_BUFFER   (1 << 20)
 
 namespace ns3 {
 
@@ -41,8 +51,10 @@ NS_LOG_COMPONENT_DEFINE ("LoraStatsHelper");
 
 LoraStatsHelper::LoraStatsHelper()
 {
-  m_prevTimeStamp = std::time (0);
   m_minutes = 0;
+  m_stopTime = Seconds (0);
+  m_memoryBaselineBytes = 0;
+  m_prevEvents = 0;
 }
 
 LoraStatsHelper::~LoraStatsHelper()
@@ -51,185 +63,346 @@ LoraStatsHelper::~LoraStatsHelper()
 
 void LoraStatsHelper::NodeInformation (std::string fileName, NodeContainer endDevices, NodeContainer gateways)
 {
-  const char * name = fileName.c_str();
-  std::ofstream nodeInformationFile;
-  nodeInformationFile.open(name);
-  NS_ASSERT(nodeInformationFile.is_open() == true);
+  //Handles are looked up once, then the monitor is iterated
+  Ptr<LoraEnergyMonitor> monitor = CreateObject<LoraEnergyMonitor> ();
+  monitor->Add (endDevices);
+  NodeInformation (fileName, monitor, gateways);
+}
+
+void LoraStatsHelper::NodeInformation (std::string fileName, Ptr<LoraEnergyMonitor> monitor, NodeContainer gateways)
+{
+  LoraColumnarTable table;
+  CollectNodeTable (monitor, gateways, table);
+  table.WriteText (fileName);
+}
 
+void LoraStatsHelper::NodeInformationBinary (std::string fileName, Ptr<LoraEnergyMonitor> monitor, NodeContainer gateways)
+{
+  LoraColumnarTable table;
+  CollectNodeTable (monitor, gateways, table);
+  table.WriteBinary (fileName);
+}
+
+void LoraStatsHelper::CollectNodeTable (Ptr<LoraEnergyMonitor> monitor, NodeContainer gateways, LoraColumnarTable &table)
+{
   NS_LOG_DEBUG ("Collecting Node Information");
-  //Print column info
-  nodeInformationFile << "#Dev"          << " "
-                      << "nodeId"        << " "
-                      << "x"             << " "
-                      << "y"             << " "
-                      << "z"             << " "
-                      << "SF"            << " "
-                      << "DR"            << " "
-                      << "ConsEnergy"    << " "
-                      << "RemEnergy"     << " "
-                      << std::endl;
+  //Columns
+  uint32_t dev        = table.AddColumn ("Dev", LoraColumnarTable::LABEL);
+  uint32_t id         = table.AddColumn ("nodeId", LoraColumnarTable::UINT32);
+  uint32_t x          = table.AddColumn ("x", LoraColumnarTable::DOUBLE);
+  uint32_t y          = table.AddColumn ("y", LoraColumnarTable::DOUBLE);
+  uint32_t z          = table.AddColumn ("z", LoraColumnarTable::DOUBLE);
+  uint32_t sf         = table.AddColumn ("SF", LoraColumnarTable::UINT32);
+  uint32_t dr         = table.AddColumn ("DR", LoraColumnarTable::UINT32);
+  uint32_t consEnergy = table.AddColumn ("ConsEnergy", LoraColumnarTable::DOUBLE);
+  uint32_t remEnergy  = table.AddColumn ("RemEnergy", LoraColumnarTable::DOUBLE);
+  table.Reserve (monitor->GetN () + gateways.GetN ());
 
   //End Devices Information
-  for (NodeContainer::Iterator i = endDevices.Begin(); i!=endDevices.End(); i++)
+  for (LoraEnergyMonitor::Iterator i = monitor->Begin (); i != monitor->End (); ++i)
     {
-      Ptr<Node> node = *i;
-      uint nodeId = node->GetId();
-
       //Get mobility info
-      Ptr<MobilityModel> mobility = node->GetObject<MobilityModel>();
-      NS_ASSERT (mobility != NULL);
-      Vector position =  mobility->GetPosition ();
-
-      //Get energy info
-      Ptr<EnergySourceContainer> energySourceContainer = node->GetObject<EnergySourceContainer>();
-      NS_ASSERT (energySourceContainer != NULL);
-      Ptr<LoraEnergySource> loraEnergySource = DynamicCast<LoraEnergySource>(energySourceContainer->Get(0));
-      NS_ASSERT (loraEnergySource != NULL);
-      double remainingEnergyJ = loraEnergySource->GetRemainingEnergy();
-      DeviceEnergyModelContainer deviceEnergyModelContainer = loraEnergySource->FindDeviceEnergyModels("ns3::LoraRadioEnergyModel");
-      Ptr<LoraRadioEnergyModel> loraRadioEnergyModel = DynamicCast<LoraRadioEnergyModel>(deviceEnergyModelContainer.Get(0));
-      NS_ASSERT (loraRadioEnergyModel != NULL);
-      double consumedEnergyJ   = loraRadioEnergyModel->GetTotalEnergyConsumption();
+      NS_ASSERT (i->mobility != NULL);
+      Vector position =  i->mobility->GetPosition ();
 
       //Get lora-protocol info
-      Ptr<NetDevice> netDevice = node->GetDevice(0);
-      NS_ASSERT(netDevice != NULL);
-      Ptr<LoraNetDevice> loraNetDevice = netDevice->GetObject<LoraNetDevice>();
-      NS_ASSERT(loraNetDevice != NULL);
-      Ptr<EndDeviceLoraMac> edMac= loraNetDevice->GetMac()->GetObject<EndDeviceLoraMac>();
-      NS_ASSERT(edMac != NULL);
-      uint  dataRate = edMac->GetDataRate();
-      uint  spreadingFactor = edMac->GetSfFromDataRate(dataRate);
-      //Print Info
-      nodeInformationFile << "ED"             << " "
-                          << nodeId           << " "
-                          << position.x       << " "
-                          << position.y       << " "
-                          << position.z       << " "
-                          << spreadingFactor  << " "
-                          << dataRate         << " "
-                          << consumedEnergyJ  << " "
-                          << remainingEnergyJ << " "
-                          << std::endl;
+      NS_ASSERT(i->mac != NULL);
+      uint  dataRate = i->mac->GetDataRate();
+      uint  spreadingFactor = i->mac->GetSfFromDataRate(dataRate);
+
+      table.AppendLabel (dev, "ED");
+      table.AppendUint (id, i->node->GetId());
+      table.AppendDouble (x, position.x);
+      table.AppendDouble (y, position.y);
+      table.AppendDouble (z, position.z);
+      table.AppendUint (sf, spreadingFactor);
+      table.AppendUint (dr, dataRate);
+      table.AppendDouble (consEnergy, i->model->GetTotalEnergyConsumption());
+      table.AppendDouble (remEnergy, i->source->GetRemainingEnergy());
     }
 
-  // Gateways Information
+  // Gateways Information, no lora-protocol nor energy info
+  double absent = std::numeric_limits<double>::quiet_NaN ();
   for (NodeContainer::Iterator i = gateways.Begin (); i != gateways.End (); ++i)
     {
       Ptr<Node> node = *i;
-      uint nodeId = node->GetId();
 
       //Get mobility info
       Ptr<MobilityModel> mobility = node->GetObject<MobilityModel>();
       NS_ASSERT (mobility != NULL);
       Vector position =  mobility->GetPosition ();
 
-      //Print Info
-      nodeInformationFile << "GW"             << " "
-                          << nodeId           << " "
-                          << position.x       << " "
-                          << position.y       << " "
-                          << position.z       << " "
-                          << std::endl;
+      table.AppendLabel (dev, "GW");
+      table.AppendUint (id, node->GetId());
+      table.AppendDouble (x, position.x);
+      table.AppendDouble (y, position.y);
+      table.AppendDouble (z, position.z);
+      table.AppendUint (sf, LoraColumnarTable::ABSENT_UINT);
+      table.AppendUint (dr, LoraColumnarTable::ABSENT_UINT);
+      table.AppendDouble (consEnergy, absent);
+      table.AppendDouble (remEnergy, absent);
     }
 }
 
 void LoraStatsHelper::EnergyInformation (std::string fileName, NodeContainer endDevices)
 {
-  const char * name = fileName.c_str();
-  std::ofstream energyInformationFile;
-  energyInformationFile.open(name);
+  //Handles are looked up once, then the monitor is iterated
+  Ptr<LoraEnergyMonitor> monitor = CreateObject<LoraEnergyMonitor> ();
+  monitor->Add (endDevices);
+  EnergyInformation (fileName, monitor);
+}
 
-  NS_ASSERT(energyInformationFile.is_open() == true);
+void LoraStatsHelper::EnergyInformation (std::string fileName, Ptr<LoraEnergyMonitor> monitor)
+{
+  LoraColumnarTable table;
+  CollectEnergyTable (monitor, table);
+  table.WriteText (fileName);
+}
 
+void LoraStatsHelper::EnergyInformationBinary (std::string fileName, Ptr<LoraEnergyMonitor> monitor)
+{
+  LoraColumnarTable table;
+  CollectEnergyTable (monitor, table);
+  table.WriteBinary (fileName);
+}
+
+void LoraStatsHelper::CollectEnergyTable (Ptr<LoraEnergyMonitor> monitor, LoraColumnarTable &table)
+{
   NS_LOG_DEBUG ("Collecting Node Energy Information");
-  //Print column info
-  energyInformationFile << "#nodeId"                << " "
-                        << "VoltageV"               << " "
-                        << "totalTxS"               << " "
-                        << "totalRxS"               << " "
-                        << "totalStandbyS"          << " "
-                        << "totalSleepS"            << " "
-                        << "txCurrentA"             << " "
-                        << "rxCurrentA"             << " "
-                        << "standbyCurrentA"        << " "
-                        << "sleepCurrentA"          << " "
-                        << "txConsumedEnergy"       << " "
-                        << "rxConsumedEnergy"       << " "
-                        << "standbyConsumedEnergy"  << " "
-                        << "sleepConsumedEnergy"    << " "
-                        << "totalConsumedEnergy"    << " "
-                        << "initialEnergyJ"         << " "
-                        << "remainingEnergyJ"       << " "
-                        << "SF"                     << " "
-                        << std::endl;
+  //Columns
+  uint32_t id               = table.AddColumn ("nodeId", LoraColumnarTable::UINT32);
+  uint32_t voltage          = table.AddColumn ("VoltageV", LoraColumnarTable::DOUBLE);
+  uint32_t txTime           = table.AddColumn ("totalTxS", LoraColumnarTable::DOUBLE);
+  uint32_t rxTime           = table.AddColumn ("totalRxS", LoraColumnarTable::DOUBLE);
+  uint32_t standbyTime      = table.AddColumn ("totalStandbyS", LoraColumnarTable::DOUBLE);
+  uint32_t sleepTime        = table.AddColumn ("totalSleepS", LoraColumnarTable::DOUBLE);
+  uint32_t txCurrent        = table.AddColumn ("txCurrentA", LoraColumnarTable::DOUBLE);
+  uint32_t rxCurrent        = table.AddColumn ("rxCurrentA", LoraColumnarTable::DOUBLE);
+  uint32_t standbyCurrent   = table.AddColumn ("standbyCurrentA", LoraColumnarTable::DOUBLE);
+  uint32_t sleepCurrent     = table.AddColumn ("sleepCurrentA", LoraColumnarTable::DOUBLE);
+  uint32_t txEnergy         = table.AddColumn ("txConsumedEnergy", LoraColumnarTable::DOUBLE);
+  uint32_t rxEnergy         = table.AddColumn ("rxConsumedEnergy", LoraColumnarTable::DOUBLE);
+  uint32_t standbyEnergy    = table.AddColumn ("standbyConsumedEnergy", LoraColumnarTable::DOUBLE);
+  uint32_t sleepEnergy      = table.AddColumn ("sleepConsumedEnergy", LoraColumnarTable::DOUBLE);
+  uint32_t totalEnergy      = table.AddColumn ("totalConsumedEnergy", LoraColumnarTable::DOUBLE);
+  uint32_t initialEnergy    = table.AddColumn ("initialEnergyJ", LoraColumnarTable::DOUBLE);
+  uint32_t remainingEnergy  = table.AddColumn ("remainingEnergyJ", LoraColumnarTable::DOUBLE);
+  uint32_t sf               = table.AddColumn ("SF", LoraColumnarTable::UINT32);
+  table.Reserve (monitor->GetN ());
 
   // Node common Information
-  for (NodeContainer::Iterator i = endDevices.Begin (); i != endDevices.End (); ++i)
+  for (LoraEnergyMonitor::Iterator i = monitor->Begin (); i != monitor->End (); ++i)
     {
-      Ptr<Node> node = *i;
-      uint nodeId = node->GetId();
-
       //Energy Source info
-      Ptr<EnergySourceContainer> energySourceContainer = node->GetObject<EnergySourceContainer>();
-      NS_ASSERT (energySourceContainer != NULL);
-      Ptr<LoraEnergySource> loraEnergySource = DynamicCast<LoraEnergySource>(energySourceContainer->Get(0));
-      NS_ASSERT (loraEnergySource != NULL);
-      double remainingEnergyJ = loraEnergySource->GetRemainingEnergy();
-      double initialEnergyJ   = loraEnergySource->GetInitialEnergy();
-      double voltageV         = loraEnergySource->GetSupplyVoltage();
+      Ptr<LoraEnergySource> loraEnergySource = i->source;
+      table.AppendUint (id, i->node->GetId());
+      table.AppendDouble (voltage, loraEnergySource->GetSupplyVoltage());
 
       //Energy Device info
-      DeviceEnergyModelContainer deviceEnergyModelContainer = loraEnergySource->FindDeviceEnergyModels("ns3::LoraRadioEnergyModel");
-      Ptr<LoraRadioEnergyModel> loraRadioEnergyModel = DynamicCast<LoraRadioEnergyModel>(deviceEnergyModelContainer.Get(0));
-      NS_ASSERT (loraRadioEnergyModel != NULL);
-      double totalTxS               = loraRadioEnergyModel->GetTotalTxTime().GetSeconds();
-      double totalRxS               = loraRadioEnergyModel->GetTotalRxTime().GetSeconds();
-      double totalStandbyS          = loraRadioEnergyModel->GetTotalStandbyTime().GetSeconds();
-      double totalSleepS            = loraRadioEnergyModel->GetTotalSleepTime().GetSeconds();
-      double txCurrentA             = loraRadioEnergyModel->GetTxCurrentA();
-      double rxCurrentA             = loraRadioEnergyModel->GetRxCurrentA();
-      double standbyCurrentA        = loraRadioEnergyModel->GetStandbyCurrentA();
-      double sleepCurrentA          = loraRadioEnergyModel->GetSleepCurrentA();
-      double txConsumedEnergyJ      = loraRadioEnergyModel->GetTxEnergyConsumption();
-      double rxConsumedEnergyJ      = loraRadioEnergyModel->GetRxEnergyConsumption();
-      double standbyConsumedEnergyJ = loraRadioEnergyModel->GetStandbyEnergyConsumption();
-      double sleepConsumedEnergyJ   = loraRadioEnergyModel->GetSleepEnergyConsumption();
-      double totalConsumedEnergyJ   = loraRadioEnergyModel->GetTotalEnergyConsumption();
+      Ptr<LoraRadioEnergyModel> loraRadioEnergyModel = i->model;
+      table.AppendDouble (txTime, loraRadioEnergyModel->GetTotalTxTime().GetSeconds());
+      table.AppendDouble (rxTime, loraRadioEnergyModel->GetTotalRxTime().GetSeconds());
+      table.AppendDouble (standbyTime, loraRadioEnergyModel->GetTotalStandbyTime().GetSeconds());
+      table.AppendDouble (sleepTime, loraRadioEnergyModel->GetTotalSleepTime().GetSeconds());
+      table.AppendDouble (txCurrent, loraRadioEnergyModel->GetTxCurrentA());
+      table.AppendDouble (rxCurrent, loraRadioEnergyModel->GetRxCurrentA());
+      table.AppendDouble (standbyCurrent, loraRadioEnergyModel->GetStandbyCurrentA());
+      table.AppendDouble (sleepCurrent, loraRadioEnergyModel->GetSleepCurrentA());
+      table.AppendDouble (txEnergy, loraRadioEnergyModel->GetTxEnergyConsumption());
+      table.AppendDouble (rxEnergy, loraRadioEnergyModel->GetRxEnergyConsumption());
+      table.AppendDouble (standbyEnergy, loraRadioEnergyModel->GetStandbyEnergyConsumption());
+      table.AppendDouble (sleepEnergy, loraRadioEnergyModel->GetSleepEnergyConsumption());
+      table.AppendDouble (totalEnergy, loraRadioEnergyModel->GetTotalEnergyConsumption());
+      table.AppendDouble (initialEnergy, loraEnergySource->GetInitialEnergy());
+      table.AppendDouble (remainingEnergy, loraEnergySource->GetRemainingEnergy());
 
       //Spreading Factor
-      Ptr<NetDevice> netDevice = node->GetDevice(0);
-      NS_ASSERT(netDevice != NULL);
-      Ptr<LoraNetDevice> loraNetDevice = netDevice->GetObject<LoraNetDevice>();
-      NS_ASSERT(loraNetDevice != NULL);
-      Ptr<EndDeviceLoraMac> edMac= loraNetDevice->GetMac()->GetObject<EndDeviceLoraMac>();
-      NS_ASSERT(edMac != NULL);
-      uint  dataRate = edMac->GetDataRate();
-      uint  spreadingFactor = edMac->GetSfFromDataRate(dataRate);
-
-      //Print energy information
-      energyInformationFile << nodeId                 << " "
-                            << voltageV               << " "
-                            << totalTxS               << " "
-                            << totalRxS               << " "
-                            << totalStandbyS          << " "
-                            << totalSleepS            << " "
-                            << txCurrentA             << " "
-                            << rxCurrentA             << " "
-                            << standbyCurrentA        << " "
-                            << sleepCurrentA          << " "
-                            << txConsumedEnergyJ      << " "
-                            << rxConsumedEnergyJ      << " "
-                            << standbyConsumedEnergyJ << " "
-                            << sleepConsumedEnergyJ   << " "
-                            << totalConsumedEnergyJ   << " "
-                            << initialEnergyJ         << " "
-                            << remainingEnergyJ       << " "
-                            << spreadingFactor        << " "
-                            << std::endl;
+      NS_ASSERT(i->mac != NULL);
+      uint  dataRate = i->mac->GetDataRate();
+      table.AppendUint (sf, i->mac->GetSfFromDataRate(dataRate));
     }
 }
 
+void LoraStatsHelper::EnergyWindowInformation (std::string fileName, Ptr<LoraEnergyMonitor> monitor)
+{
+  const char * name = fileName.c_str();
+  std::ofstream energyWindowFile;
+  energyWindowFile.open(name);
+  NS_ASSERT(energyWindowFile.is_open() == true);
+
+  NS_LOG_DEBUG ("Collecting Energy Window Information");
+  //Print column info
+  energyWindowFile << "#nodeId"                << " "
+                   << "windowStartS"           << " "
+                   << "txConsumedEnergy"       << " "
+                   << "rxConsumedEnergy"       << " "
+                   << "standbyConsumedEnergy"  << " "
+                   << "sleepConsumedEnergy"    << " "
+                   << "\n";
+
+  //One row per node and window, nodes without windows are skipped
+  for (LoraEnergyMonitor::Iterator i = monitor->Begin (); i != monitor->End (); ++i)
+    {
+      uint nodeId = i->node->GetId();
+      std::vector<LoraRadioEnergyModel::EnergyWindow> windows = i->model->GetEnergyWindows ();
+      for (uint w = 0; w < windows.size (); w++)
+        {
+          energyWindowFile << nodeId                       << " "
+                           << windows[w].start.GetSeconds () << " "
+                           << windows[w].txEnergyJ         << " "
+                           << windows[w].rxEnergyJ         << " "
+                           << windows[w].standbyEnergyJ    << " "
+                           << windows[w].sleepEnergyJ      << " "
+                           << "\n";
+        }
+    }
+}
+
+bool LoraStatsHelper::OpenDatabase (std::string fileName)
+{
+  m_database = Create<LoraResultsDatabase> ();
+  if (!m_database->Open (fileName))
+    {
+      m_database = 0;
+      return false;
+    }
+  return true;
+}
+
+void LoraStatsHelper::BeginDatabaseRun (std::string scenario, std::string parameters)
+{
+  if (m_database != NULL)
+    {
+      m_database->BeginRun (scenario, parameters);
+    }
+}
+
+void LoraStatsHelper::EnergyInformationDatabase (Ptr<LoraEnergyMonitor> monitor)
+{
+  if (m_database != NULL)
+    {
+      NS_LOG_DEBUG ("Storing Node Energy Information");
+      m_database->InsertNodeEnergy (monitor);
+    }
+}
+
+void LoraStatsHelper::EndDatabaseRun (void)
+{
+  if (m_database != NULL)
+    {
+      m_database->EndRun ();
+    }
+}
+
+void LoraStatsHelper::BinaryToText (std::string binaryName, std::string textName)
+{
+  LoraColumnarTable::BinaryToText (binaryName, textName);
+}
+
+void LoraStatsHelper::MemoryBaseline (void)
+{
+  m_memoryBaselineBytes = LoraProcessInfo::GetResidentBytes ();
+  NS_LOG_DEBUG ("Memory baseline " << m_memoryBaselineBytes << " bytes");
+}
+
+void LoraStatsHelper::MemoryInformation (std::string fileName, NodeContainer endDevices)
+{
+  const char * name = fileName.c_str();
+  std::ofstream memoryInformationFile;
+  memoryInformationFile.open(name);
+  NS_ASSERT(memoryInformationFile.is_open() == true);
+
+  NS_LOG_DEBUG ("Collecting Memory Information");
+  uint nodes = endDevices.GetN ();
+  NS_ASSERT (nodes > 0);
+
+  //Count instances, shared objects are counted once
+  uint nSources = 0, nModels = 0, nSourceSlots = 0, nModelSlots = 0;
+  std::set<LoraConsumptionModel *> consumptionModels;
+  for (NodeContainer::Iterator i = endDevices.Begin (); i != endDevices.End (); ++i)
+    {
+      Ptr<EnergySourceContainer> energySourceContainer = (*i)->GetObject<EnergySourceContainer>();
+      NS_ASSERT (energySourceContainer != NULL);
+      nSourceSlots += energySourceContainer->GetN ();
+      for (uint j = 0; j < energySourceContainer->GetN (); j++)
+        {
+          Ptr<LoraEnergySource> loraEnergySource = DynamicCast<LoraEnergySource>(energySourceContainer->Get(j));
+          if (loraEnergySource == NULL)
+            {
+              continue;
+            }
+          nSources++;
+          DeviceEnergyModelContainer deviceEnergyModelContainer = loraEnergySource->FindDeviceEnergyModels("ns3::LoraRadioEnergyModel");
+          nModelSlots += deviceEnergyModelContainer.GetN ();
+          for (uint k = 0; k < deviceEnergyModelContainer.GetN (); k++)
+            {
+              Ptr<LoraRadioEnergyModel> loraRadioEnergyModel = DynamicCast<LoraRadioEnergyModel>(deviceEnergyModelContainer.Get(k));
+              nModels++;
+              Ptr<LoraConsumptionModel> consumption = loraRadioEnergyModel->GetConsumptionModel ();
+              if (consumption != NULL)
+                {
+                  consumptionModels.insert (PeekPointer (consumption));
+                }
+            }
+        }
+    }
+
+  //Measured growth of the resident set since MemoryBaseline, includes the
+  //heap and arena slack the object sizes below do not account for
+  uint64_t residentBytes = LoraProcessInfo::GetResidentBytes ();
+  if (m_memoryBaselineBytes == 0 || residentBytes == 0)
+    {
+      NS_LOG_WARN ("No memory baseline or resident set size, measured footprint not available");
+    }
+  double measuredBytes = 0;
+  if (m_memoryBaselineBytes > 0 && residentBytes > m_memoryBaselineBytes)
+    {
+      measuredBytes = static_cast<double> (residentBytes - m_memoryBaselineBytes);
+    }
+
+  //Object sizes per component, a lower bound of the measured footprint
+  std::vector<std::string> component;
+  std::vector<double> bytes;
+  component.push_back ("LoraRadioEnergyModel");
+  bytes.push_back (static_cast<double> (nModels) * sizeof (LoraRadioEnergyModel));
+  component.push_back ("LoraConsumptionModel");
+  bytes.push_back (static_cast<double> (consumptionModels.size ()) * sizeof (InterpolatedLoraConsumptionModel));
+  component.push_back ("LoraEnergySource");
+  bytes.push_back (static_cast<double> (nSources) * sizeof (LoraEnergySource));
+  component.push_back ("EnergySourceContainer");
+  bytes.push_back (static_cast<double> (nodes) * sizeof (EnergySourceContainer) + nSourceSlots * sizeof (Ptr<EnergySource>));
+  component.push_back ("DeviceEnergyModelSlots");
+  bytes.push_back (static_cast<double> (nModelSlots) * sizeof (Ptr<DeviceEnergyModel>));
+
+  //Print column info
+  memoryInformationFile << "#component"   << " "
+                        << "bytesPerNode" << " "
+                        << "totalBytes"   << "\n";
+  memoryInformationFile << "BaselineRss"   << " "
+                        << "-"             << " "
+                        << m_memoryBaselineBytes << "\n";
+  memoryInformationFile << "InstalledRss"  << " "
+                        << "-"             << " "
+                        << residentBytes   << "\n";
+  memoryInformationFile << "MEASURED"              << " "
+                        << measuredBytes / nodes   << " "
+                        << measuredBytes           << "\n";
+  double objectBytes = 0;
+  for (uint c = 0; c < component.size (); c++)
+    {
+      objectBytes += bytes[c];
+      memoryInformationFile << "sizeof:" << component[c] << " "
+                            << bytes[c] / nodes  << " "
+                            << bytes[c]          << "\n";
+    }
+  memoryInformationFile << "sizeof:TOTAL"        << " "
+                        << objectBytes / nodes   << " "
+                        << objectBytes           << std::endl;
+  NS_LOG_INFO ("Energy components use " << measuredBytes / nodes << " bytes per node (resident set), "
+               << objectBytes / nodes << " bytes per node in object sizes");
+}
+
+
 void LoraStatsHelper::NodePosition(std::string fileName)
 {
   const char * name = fileName.c_str();
@@ -266,7 +439,9 @@ void LoraStatsHelper::Buildings2dInformation(std::string fileName)
 {
   uint buildingIdx = 0;
   const char * name = fileName.c_str();
+  std::vector<char> buffer (BUILDINGS_FILE_BUFFER);
   std::ofstream buildingsInformationFile;
+  buildingsInformationFile.rdbuf ()->pubsetbuf (&buffer[0], buffer.size ());
   buildingsInformationFile.open(name, std::ios_base::out | std::ios_base::trunc);
   NS_ASSERT(buildingsInformationFile.is_open() == true);
 
@@ -281,8 +456,9 @@ void LoraStatsHelper::Buildings2dInformation(std::string fileName)
                                << " rect from "  << coordinates.xMin  << "," << coordinates.yMin
                                << " to "         << coordinates.xMax  << "," << coordinates.yMax
                                << " front fs empty " //transparent to make node visibles
-                               << std::endl;
+                               << "\n";
     }
+  buildingsInformationFile.close ();
 }
 
 
@@ -290,7 +466,9 @@ void LoraStatsHelper::Buildings3dInformation(std::string fileName)
 {
   uint buildingIdx = 0;
   const char * name = fileName.c_str();
+  std::vector<char> buffer (BUILDINGS_FILE_BUFFER);
   std::ofstream buildingsInformationFile;
+  buildingsInformationFile.rdbuf ()->pubsetbuf (&buffer[0], buffer.size ());
   buildingsInformationFile.open(name, std::ios_base::out | std::ios_base::trunc);
   NS_ASSERT(buildingsInformationFile.is_open() == true);
 
@@ -302,42 +480,55 @@ void LoraStatsHelper::Buildings3dInformation(std::string fileName)
       Ptr<Building> building = *i;
       Box coordinates = building->GetBoundaries ();
                                //Surface 1
-      buildingsInformationFile << coordinates.xMin << " "  << coordinates.yMin << " " << coordinates.zMin << std::endl
-                               << coordinates.xMax << " "  << coordinates.yMin << " " << coordinates.zMin << std::endl
-                               << coordinates.xMax << " "  << coordinates.yMax << " " << coordinates.zMin << std::endl
-                               << coordinates.xMin << " "  << coordinates.yMax << " " << coordinates.zMin << std::endl
-                               << std::endl << std::endl
+      buildingsInformationFile << coordinates.xMin << " "  << coordinates.yMin << " " << coordinates.zMin << "\n"
+                               << coordinates.xMax << " "  << coordinates.yMin << " " << coordinates.zMin << "\n"
+                               << coordinates.xMax << " "  << coordinates.yMax << " " << coordinates.zMin << "\n"
+                               << coordinates.xMin << " "  << coordinates.yMax << " " << coordinates.zMin << "\n"
+                               << "\n\n"
                                //Surface 2
-                               << coordinates.xMin << " "  << coordinates.yMin << " " << coordinates.zMax << std::endl
-                               << coordinates.xMax << " "  << coordinates.yMin << " " << coordinates.zMax << std::endl
-                               << coordinates.xMax << " "  << coordinates.yMax << " " << coordinates.zMax << std::endl
-                               << coordinates.xMin << " "  << coordinates.yMax << " " << coordinates.zMax << std::endl
-                               << std::endl << std::endl
+                               << coordinates.xMin << " "  << coordinates.yMin << " " << coordinates.zMax << "\n"
+                               << coordinates.xMax << " "  << coordinates.yMin << " " << coordinates.zMax << "\n"
+                               << coordinates.xMax << " "  << coordinates.yMax << " " << coordinates.zMax << "\n"
+                               << coordinates.xMin << " "  << coordinates.yMax << " " << coordinates.zMax << "\n"
+                               << "\n\n"
                                //Surface 3
-                               << coordinates.xMin << " "  << coordinates.yMin << " " << coordinates.zMin << std::endl
-                               << coordinates.xMin << " "  << coordinates.yMax << " " << coordinates.zMin << std::endl
-                               << coordinates.xMin << " "  << coordinates.yMax << " " << coordinates.zMax << std::endl
-                               << coordinates.xMin << " "  << coordinates.yMin << " " << coordinates.zMax << std::endl
-                               << std::endl << std::endl
+                               << coordinates.xMin << " "  << coordinates.yMin << " " << coordinates.zMin << "\n"
+                               << coordinates.xMin << " "  << coordinates.yMax << " " << coordinates.zMin << "\n"
+                               << coordinates.xMin << " "  << coordinates.yMax << " " << coordinates.zMax << "\n"
+                               << coordinates.xMin << " "  << coordinates.yMin << " " << coordinates.zMax << "\n"
+                               << "\n\n"
                                //Surface 4
-                               << coordinates.xMax << " "  << coordinates.yMin << " " << coordinates.zMin << std::endl
-                               << coordinates.xMax << " "  << coordinates.yMax << " " << coordinates.zMin << std::endl
-                               << coordinates.xMax << " "  << coordinates.yMax << " " << coordinates.zMax << std::endl
-                               << coordinates.xMax << " "  << coordinates.yMin << " " << coordinates.zMax << std::endl
-                               << std::endl << std::endl
+                               << coordinates.xMax << " "  << coordinates.yMin << " " << coordinates.zMin << "\n"
+                               << coordinates.xMax << " "  << coordinates.yMax << " " << coordinates.zMin << "\n"
+                               << coordinates.xMax << " "  << coordinates.yMax << " " << coordinates.zMax << "\n"
+                               << coordinates.xMax << " "  << coordinates.yMin << " " << coordinates.zMax << "\n"
+                               << "\n\n"
                                //Surface 5
-                               << coordinates.xMin << " "  << coordinates.yMin << " " << coordinates.zMin << std::endl
-                               << coordinates.xMin << " "  << coordinates.yMin << " " << coordinates.zMax << std::endl
-                               << coordinates.xMax << " "  << coordinates.yMin << " " << coordinates.zMax << std::endl
-                               << coordinates.xMax << " "  << coordinates.yMin << " " << coordinates.zMin << std::endl
-                               << std::endl << std::endl
+                               << coordinates.xMin << " "  << coordinates.yMin << " " << coordinates.zMin << "\n"
+                               << coordinates.xMin << " "  << coordinates.yMin << " " << coordinates.zMax << "\n"
+                               << coordinates.xMax << " "  << coordinates.yMin << " " << coordinates.zMax << "\n"
+                               << coordinates.xMax << " "  << coordinates.yMin << " " << coordinates.zMin << "\n"
+                               << "\n\n"
                                //Surface 6
-                               << coordinates.xMin << " "  << coordinates.yMax << " " << coordinates.zMin << std::endl
-                               << coordinates.xMin << " "  << coordinates.yMax << " " << coordinates.zMax << std::endl
-                               << coordinates.xMax << " "  << coordinates.yMax << " " << coordinates.zMax << std::endl
-                               << coordinates.xMax << " "  << coordinates.yMax << " " << coordinates.zMin << std::endl
-                               << std::endl << std::endl;
+                               << coordinates.xMin << " "  << coordinates.yMax << " " << coordinates.zMin << "\n"
+                               << coordinates.xMin << " "  << coordinates.yMax << " " << coordinates.zMax << "\n"
+                               << coordinates.xMax << " "  << coordinates.yMax << " " << coordinates.zMax << "\n"
+                               << coordinates.xMax << " "  << coordinates.yMax << " " << coordinates.zMin << "\n"
+                               << "\n\n";
     }
+  buildingsInformationFile.close ();
+}
+
+void LoraStatsHelper::BuildingsMeshInformation(std::string fileName)
+{
+  NS_LOG_DEBUG ("Collecting buildings mesh");
+  LoraBuildingExport::WriteMeshText (fileName, LoraBuildingExport::GetBoxes ());
+}
+
+void LoraStatsHelper::BuildingsBinaryInformation(std::string fileName)
+{
+  NS_LOG_DEBUG ("Collecting buildings geometry");
+  LoraBuildingExport::WriteBinary (fileName, LoraBuildingExport::GetBoxes ());
 }
 
 void LoraStatsHelper::GnuPlot2dScript (std::string scriptName, std::string dataName, bool labels)
@@ -603,6 +794,16 @@ void LoraStatsHelper::GnuPlot3dScript (std::string scriptName, std::string dataN
 
 void LoraStatsHelper::SchedulePrintSimulationTime (void)
 {
+  if (m_minutes == 0)
+    {
+      NS_LOG_WARN ("Progress interval not set (SetTimeStamp), no progress report");
+      return;
+    }
+  m_startWall = std::chrono::steady_clock::now ();
+  m_prevWall = m_startWall;
+  m_prevEvents = Simulator::GetEventCount ();
+  m_startSimTime = Simulator::Now ();
+  m_prevSimTime = m_startSimTime;
   Simulator::Schedule (Minutes (this->m_minutes), &LoraStatsHelper::PrintSimulationTime,this);
 }
 
@@ -611,11 +812,66 @@ void LoraStatsHelper::SetTimeStamp(uint minutes)
   m_minutes = minutes;
 }
 
+void LoraStatsHelper::SetStopTime (Time stopTime)
+{
+  m_stopTime = stopTime;
+}
+
+void LoraStatsHelper::SetProgressFile (std::string fileName)
+{
+  m_progressFileName = fileName;
+  std::ofstream file (fileName.c_str (), std::ios::trunc);
+}
+
 void LoraStatsHelper::PrintSimulationTime(void)
 {
+  std::chrono::steady_clock::time_point wall = std::chrono::steady_clock::now ();
+  uint64_t events = Simulator::GetEventCount ();
+  Time now = Simulator::Now ();
+
+  double intervalWallS = std::chrono::duration<double> (wall - m_prevWall).count ();
+  double totalWallS = std::chrono::duration<double> (wall - m_startWall).count ();
+  double eventsPerS = intervalWallS > 0 ? (events - m_prevEvents) / intervalWallS : 0;
+  //Simulated time covered since the previous report
+  double speed = intervalWallS > 0 ? (now - m_prevSimTime).GetSeconds () / intervalWallS : 0;
+  //ETA at the mean speed since the first report was scheduled
+  double etaS = -1;
+  if (!m_stopTime.IsZero () && totalWallS > 0 && now > m_startSimTime)
+    {
+      double meanSpeed = (now - m_startSimTime).GetSeconds () / totalWallS;
+      etaS = std::max (0.0, (m_stopTime - now).GetSeconds () / meanSpeed);
+    }
+  int64_t pending = LoraCountingScheduler::IsInstalled ()
+    ? static_cast<int64_t> (LoraCountingScheduler::GetPendingEvents ()) : -1;
+  uint64_t peakRss = LoraProcessInfo::GetPeakResidentBytes ();
+
   std::cout << "Time elapsed during simulation: " << Simulator::Now ().GetHours () << " hours" << std::endl;
-  std::cout << "Time elapsed from last call: " << std::time (0) - m_prevTimeStamp << " seconds" << std::endl;
-  m_prevTimeStamp = std::time (0);
+  std::cout << "Time elapsed from last call: " << intervalWallS << " seconds ("
+            << eventsPerS << " events/s, " << speed << "x real time";
+  if (etaS >= 0)
+    {
+      std::cout << ", ETA " << etaS << " s";
+    }
+  std::cout << ")" << std::endl;
+
+  std::ostringstream line;
+  line << "progress simTimeS=" << now.GetSeconds () << " wallS=" << totalWallS
+       << " events=" << events << " eventsPerS=" << eventsPerS << " speed=" << speed
+       << " etaS=" << etaS << " pending=" << pending << " peakRssB=" << peakRss;
+  std::cout << line.str () << std::endl;
+  if (!m_progressFileName.empty ())
+    {
+      std::ofstream file (m_progressFileName.c_str (), std::ios::app);
+      file << line.str () << "\n";
+    }
+
+  m_prevWall = wall;
+  m_prevEvents = events;
+  m_prevSimTime = now;
+  if (m_stopTime.IsZero () || now + Minutes (m_minutes) <= m_stopTime)
+    {
+      Simulator::Schedule (Minutes (this->m_minutes), &LoraStatsHelper::PrintSimulationTime,this);
+    }
 }
 
 
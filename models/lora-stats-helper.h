@@ -21,7 +21,11 @@
 
 #include "ns3/node-container.h"
 #include "ns3/buildings-module.h"
-#include <ctime>
+#include "ns3/lora-energy-monitor.h"
+#include "ns3/lora-columnar-table.h"
+#include "ns3/lora-results-database.h"
+#include "ns3/nstime.h"
+#include <chrono>
 
 namespace ns3 {
 
@@ -39,24 +43,66 @@ public:
   void NodePosition (std::string fileName);
   void EnergyInformation (std::string fileName, NodeContainer endDevices);
   void NodeInformation (std::string fileName, NodeContainer endDevices, NodeContainer gateways);
+  //Same reports iterating a monitor filled at install time (no lookups)
+  void EnergyInformation (std::string fileName, Ptr<LoraEnergyMonitor> monitor);
+  void NodeInformation (std::string fileName, Ptr<LoraEnergyMonitor> monitor, NodeContainer gateways);
+  //Same reports in the columnar binary format (see LoraColumnarTable)
+  void EnergyInformationBinary (std::string fileName, Ptr<LoraEnergyMonitor> monitor);
+  void NodeInformationBinary (std::string fileName, Ptr<LoraEnergyMonitor> monitor, NodeContainer gateways);
+  //Per-window, per-state energy of every node (EnergyWindowLength > 0)
+  void EnergyWindowInformation (std::string fileName, Ptr<LoraEnergyMonitor> monitor);
+  //Convert a binary report to the text report
+  static void BinaryToText (std::string binaryName, std::string textName);
+  //Optional SQLite store shared by many runs (see LoraResultsDatabase)
+  bool OpenDatabase (std::string fileName);
+  void BeginDatabaseRun (std::string scenario, std::string parameters);
+  void EnergyInformationDatabase (Ptr<LoraEnergyMonitor> monitor);
+  void EndDatabaseRun (void);
+  //Memory footprint of the energy components: resident set growth between
+  //MemoryBaseline (before installing them) and MemoryInformation (right
+  //after), per node, plus the object sizes per component for reference
+  void MemoryBaseline (void);
+  void MemoryInformation (std::string fileName, NodeContainer endDevices);
 
   void Buildings2dInformation(std::string fileName);
   void Buildings3dInformation(std::string fileName);
+  //Indexed mesh (Wavefront OBJ) and binary geometry, grid encoded when regular
+  void BuildingsMeshInformation(std::string fileName);
+  void BuildingsBinaryInformation(std::string fileName);
 
   void GnuPlot2dScript (std::string scriptName, std::string dataName, bool labels);
   void GnuPlot3dScript (std::string scriptName, std::string dataName, bool labels);
   void GnuPlot2dScript (std::string scriptName, std::string dataName, std::string buildingsName, bool labels);
   void GnuPlot3dScript (std::string scriptName, std::string dataName, std::string buildingsName, bool labels);
 
+  //Recurring progress report every SetTimeStamp minutes of simulation time:
+  //events/s, sim/wall speed, ETA to the stop time, pending events (with
+  //LoraCountingScheduler) and peak RSS, plus one "progress key=value" line
   void SchedulePrintSimulationTime (void);
   void SetTimeStamp(uint minutes);
+  //Simulation stop time, for the ETA
+  void SetStopTime (Time stopTime);
+  //Also append the machine-readable lines to a file
+  void SetProgressFile (std::string fileName);
 
 private:
 
   void PrintSimulationTime(void);
+  void CollectNodeTable (Ptr<LoraEnergyMonitor> monitor, NodeContainer gateways, LoraColumnarTable &table);
+  void CollectEnergyTable (Ptr<LoraEnergyMonitor> monitor, LoraColumnarTable &table);
 
-  time_t m_prevTimeStamp;
+  Ptr<LoraResultsDatabase> m_database;
+  uint64_t m_memoryBaselineBytes;
   uint   m_minutes;
+  Time   m_stopTime;
+  std::string m_progressFileName;
+  //Monotonic wall clock and simulated time at start, and counters at the
+  //previous report
+  std::chrono::steady_clock::time_point m_startWall;
+  std::chrono::steady_clock::time_point m_prevWall;
+  uint64_t m_prevEvents;
+  Time m_startSimTime;
+  Time m_prevSimTime;
 };
 
 } //namespace ns3
@@ -0,0 +1,274 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#ifndef LORA_STREAMING_STATS_H
+#define LORA_STREAMING_STATS_H
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ns3 {
+
+/**
+ * \ingroup energy
+ *
+ * \brief Running count, mean, variance, min and max (Welford)
+ */
+class LoraRunningStats
+{
+public:
+  LoraRunningStats ()
+    : m_count (0),
+      m_mean (0),
+      m_m2 (0),
+      m_min (std::numeric_limits<double>::infinity ()),
+      m_max (-std::numeric_limits<double>::infinity ())
+  {
+  }
+
+  void Add (double x)
+  {
+    m_count++;
+    double delta = x - m_mean;
+    m_mean += delta / m_count;
+    m_m2 += delta * (x - m_mean);
+    m_min = std::min (m_min, x);
+    m_max = std::max (m_max, x);
+  }
+
+  //Combine with the statistics of another set of samples (Chan et al.)
+  void Merge (const LoraRunningStats &other)
+  {
+    if (other.m_count == 0)
+      {
+        return;
+      }
+    uint64_t count = m_count + other.m_count;
+    double delta = other.m_mean - m_mean;
+    m_mean += delta * other.m_count / count;
+    m_m2 += other.m_m2 + delta * delta * (static_cast<double> (m_count) * other.m_count / count);
+    m_count = count;
+    m_min = std::min (m_min, other.m_min);
+    m_max = std::max (m_max, other.m_max);
+  }
+
+  uint64_t GetCount (void) const
+  {
+    return m_count;
+  }
+  double GetMean (void) const
+  {
+    return m_mean;
+  }
+  //Sample variance, 0 with less than two samples
+  double GetVariance (void) const
+  {
+    return m_count > 1 ? m_m2 / (m_count - 1) : 0;
+  }
+  double GetStdDev (void) const
+  {
+    return std::sqrt (GetVariance ());
+  }
+  double GetMin (void) const
+  {
+    return m_min;
+  }
+  double GetMax (void) const
+  {
+    return m_max;
+  }
+
+private:
+  uint64_t m_count;
+  double m_mean;
+  double m_m2;
+  double m_min;
+  double m_max;
+};
+
+/**
+ * \ingroup energy
+ *
+ * \brief Merging t-digest for streaming quantiles
+ *
+ * Samples are buffered and periodically merged into at most about
+ * compression centroids (arcsine scale function, so the tails keep more
+ * resolution than the median). Memory is bounded by the compression,
+ * independently of the number of samples.
+ */
+class LoraTDigest
+{
+public:
+  explicit LoraTDigest (double compression = 100)
+    : m_compression (compression),
+      m_totalWeight (0),
+      m_min (std::numeric_limits<double>::infinity ()),
+      m_max (-std::numeric_limits<double>::infinity ())
+  {
+    m_centroids.reserve (static_cast<std::size_t> (2 * compression));
+    m_buffer.reserve (static_cast<std::size_t> (BUFFER_FACTOR * compression));
+  }
+
+  void Add (double x)
+  {
+    m_buffer.push_back (Centroid (x, 1));
+    m_min = std::min (m_min, x);
+    m_max = std::max (m_max, x);
+    if (m_buffer.size () >= BUFFER_FACTOR * m_compression)
+      {
+        Merge ();
+      }
+  }
+
+  //Value below which a fraction q of the samples lies (NaN if empty)
+  double GetQuantile (double q)
+  {
+    Merge ();
+    if (m_centroids.empty ())
+      {
+        return std::numeric_limits<double>::quiet_NaN ();
+      }
+    if (q <= 0)
+      {
+        return m_min;
+      }
+    if (q >= 1)
+      {
+        return m_max;
+      }
+    if (m_centroids.size () == 1)
+      {
+        return m_centroids[0].mean;
+      }
+
+    //Interpolate between centroid centres, min and max at both ends
+    double target = q * m_totalWeight;
+    double cumulative = 0;
+    double prevCentre = 0;
+    double prevMean = m_min;
+    for (std::size_t i = 0; i < m_centroids.size (); i++)
+      {
+        double centre = cumulative + m_centroids[i].weight / 2;
+        if (target < centre)
+          {
+            double span = centre - prevCentre;
+            double t = span > 0 ? (target - prevCentre) / span : 0;
+            return prevMean + t * (m_centroids[i].mean - prevMean);
+          }
+        cumulative += m_centroids[i].weight;
+        prevCentre = centre;
+        prevMean = m_centroids[i].mean;
+      }
+    double span = m_totalWeight - prevCentre;
+    double t = span > 0 ? (target - prevCentre) / span : 0;
+    return prevMean + t * (m_max - prevMean);
+  }
+
+  double GetCount (void)
+  {
+    Merge ();
+    return m_totalWeight;
+  }
+
+  std::size_t GetNCentroids (void)
+  {
+    Merge ();
+    return m_centroids.size ();
+  }
+
+private:
+  static const uint32_t BUFFER_FACTOR = 5;
+
+  struct Centroid
+  {
+    Centroid (double m, double w) : mean (m), weight (w)
+    {
+    }
+    bool operator< (const Centroid &other) const
+    {
+      return mean < other.mean;
+    }
+    double mean;
+    double weight;
+  };
+
+  //Scale function k1 and its inverse
+  double QToK (double q) const
+  {
+    return m_compression / (2 * M_PI) * std::asin (2 * q - 1);
+  }
+  double KToQ (double k) const
+  {
+    if (k >= m_compression / 4)
+      {
+        return 1;
+      }
+    return (std::sin (k * 2 * M_PI / m_compression) + 1) / 2;
+  }
+
+  void Merge (void)
+  {
+    if (m_buffer.empty ())
+      {
+        return;
+      }
+    for (std::size_t i = 0; i < m_buffer.size (); i++)
+      {
+        m_totalWeight += m_buffer[i].weight;
+      }
+    m_buffer.insert (m_buffer.end (), m_centroids.begin (), m_centroids.end ());
+    std::sort (m_buffer.begin (), m_buffer.end ());
+    m_centroids.clear ();
+
+    Centroid current = m_buffer[0];
+    double weightSoFar = 0;
+    double qLimit = KToQ (QToK (0) + 1);
+    for (std::size_t i = 1; i < m_buffer.size (); i++)
+      {
+        double q = (weightSoFar + current.weight + m_buffer[i].weight) / m_totalWeight;
+        if (q <= qLimit)
+          {
+            current.weight += m_buffer[i].weight;
+            current.mean += (m_buffer[i].mean - current.mean) * m_buffer[i].weight / current.weight;
+          }
+        else
+          {
+            weightSoFar += current.weight;
+            qLimit = KToQ (QToK (weightSoFar / m_totalWeight) + 1);
+            m_centroids.push_back (current);
+            current = m_buffer[i];
+          }
+      }
+    m_centroids.push_back (current);
+    m_buffer.clear ();
+  }
+
+  double m_compression;
+  double m_totalWeight;
+  double m_min;
+  double m_max;
+  std::vector<Centroid> m_centroids;
+  std::vector<Centroid> m_buffer;
+};
+
+} //namespace ns3
+
+#endif /* LORA_STREAMING_STATS_H */
@@ -22,29 +22,20 @@
 #include "ns3/gateway-lora-mac.h"
 #include "ns3/simulator.h"
 #include "ns3/log.h"
-#include "ns3/pointer.h"
+#include "ns3/test.h"
 #include "ns3/constant-position-mobility-model.h"
 #include "ns3/lora-helper.h"
 #include "ns3/node-container.h"
 #include "ns3/mobility-helper.h"
 #include "ns3/position-allocator.h"
 #include "ns3/double.h"
-#include "ns3/random-variable-stream.h"
-#include "ns3/periodic-sender-helper.h"
-#include "ns3/command-line.h"
 #include "ns3/lora-radio-energy-model-helper.h"
 #include "ns3/lora-energy-source-helper.h"
-#include "ns3/lora-stats-helper.h"
-#include "ns3/names.h"
-#include "ns3/one-shot-sender-helper.h"
-#include "ns3/lora-building-allocator.h"
 #include "ns3/lora-energy-source.h"
 #include "ns3/lora-radio-energy-model.h"
+#include "ns3/lora-consumption-model.h"
 #include "ns3/device-energy-model-container.h"
-
-#include "ns3/string.h"
-#include <algorithm>
-#include <ctime>
+#include <chrono>
 
 using namespace ns3;
 
@@ -77,81 +68,73 @@ NS_LOG_COMPONENT_DEFINE ("LoraEnergyModelTest");
 #define SLEEP_CURR_DEFAULT           1.8e-6
 
 #define TX_POWER_DEFAULT               14.0
-
+#define SUPPLY_VOLTAGE                  3.7
+#define INITIAL_ENERGY                 5.55
 /*
- * Simulation configuration
+ * Scripted timeline: TX 1 s, RX 1.25 s, STANDBY 1.5 s, SLEEP 1.75 s
  */
-#define START_SIMULATION_TIME             0
+#define TX_START                        0.0
+#define RX_START                        1.0
+#define STANDBY_START                  2.25
+#define SLEEP_START                    3.75
 #define STOP_SIMULATION_TIME            5.5
 /*
- *  Statistics configuration
+ * Timing budgets (wall time per call, release builds)
  */
-#define LABELS                         true
+#define TRANSITION_BUDGET_NS           5000
+#define UPDATE_BUDGET_NS               5000
+#define BUDGET_ITERATIONS            100000
+
+//Absolute tolerances
+#define CURRENT_TOLERANCE             1e-12
+#define ENERGY_TOLERANCE              1e-12
+#define TIME_TOLERANCE                1e-9
+
 
 /*********************************************************************
- * Main Program - Test Suite for Lora Energy Model
+ * Auxiliar functions
  *********************************************************************/
+namespace {
 
-int main (int argc, char *argv[])
+/*
+ * Single ED and GW with the Lora energy model installed
+ */
+struct EnergyTestbed
+{
+  Ptr<EndDeviceLoraPhy> edPhy;
+  Ptr<LoraEnergySource> loraEnergySource;
+  Ptr<LoraRadioEnergyModel> loraRadioEnergyModel;
+};
+
+EnergyTestbed
+CreateTestbed (void)
 {
-  /*********************************************************************
-   * Enable Log Components
-   *********************************************************************/
-  LogComponentEnable ("LoraEnergyModelTest"  , LOG_LEVEL_ALL);
-  LogComponentEnable ("EndDeviceLoraPhy"     , LOG_LEVEL_DEBUG);
-  //LogComponentEnable ("LoraConsumptionModel" , LOG_LEVEL_DEBUG);
-  LogComponentEnable ("LoraRadioEnergyModel" , LOG_LEVEL_DEBUG);
-  //LogComponentEnable ("LoraEnergySource"     , LOG_LEVEL_DEBUG);
-  LogComponentEnableAll (LOG_PREFIX_FUNC);
-  LogComponentEnableAll (LOG_PREFIX_NODE);
-  LogComponentEnableAll (LOG_PREFIX_TIME);
-
-
-
-  /*********************************************************************
-   * Create mobility model
-   *********************************************************************/
-  //ED mobility model
+  //ED and GW mobility models
   Ptr<ListPositionAllocator> fixAllocatorEd = CreateObject<ListPositionAllocator> ();
   fixAllocatorEd->Add (Vector (ED_X_COORDINATE,ED_Y_COORDINATE,ED_HEIGHT));
-
   MobilityHelper MobilityEd;
   MobilityEd.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
   MobilityEd.SetPositionAllocator(fixAllocatorEd);
 
-  //GW mobility model
   Ptr<ListPositionAllocator> fixAllocatorGw = CreateObject<ListPositionAllocator> ();
-  fixAllocatorGw->Add (Vector (GW_X_COORDINATE,GW_Y_COORDINATE,GW_HEIGHT)); //Single GW in center
-
+  fixAllocatorGw->Add (Vector (GW_X_COORDINATE,GW_Y_COORDINATE,GW_HEIGHT));
   MobilityHelper MobilityGw;
   MobilityGw.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
   MobilityGw.SetPositionAllocator(fixAllocatorGw);
 
-  /*********************************************************************
-   * Configure Lora Channel
-   *********************************************************************/
-  //Delay model
+  //Lora channel
   Ptr<PropagationDelayModel> delay = CreateObject<ConstantSpeedPropagationDelayModel> ();
-  //LossModel
   Ptr<LogDistancePropagationLossModel> longDistanceLoss = CreateObject<LogDistancePropagationLossModel> ();
   longDistanceLoss->SetPathLossExponent (PATH_LOSS_EXP);
   longDistanceLoss->SetReference (1, LOSS_REF);
-  //Create channel
   Ptr<LoraChannel> channel = CreateObject<LoraChannel> (longDistanceLoss, delay);
 
-
-  /*********************************************************************
-   * Create Lora helpers
-   *********************************************************************/
   LoraPhyHelper phyHelper = LoraPhyHelper ();
   phyHelper.SetChannel (channel);
   LoraMacHelper macHelper = LoraMacHelper ();
   LoraHelper helper = LoraHelper ();
-  LoraStatsHelper statsHelper = LoraStatsHelper();
 
-  /*********************************************************************
-   * Create and configure End Device
-   *********************************************************************/
+  //End device
   NodeContainer endDevices;
   endDevices.Create (1);
   MobilityEd.Install(endDevices);
@@ -159,10 +142,7 @@ int main (int argc, char *argv[])
   macHelper.SetDeviceType (LoraMacHelper::ED);
   NetDeviceContainer endDevicesNetDevices = helper.Install (phyHelper, macHelper, endDevices);
 
-  /*********************************************************************
-   * Create and configure Gateways
-   *********************************************************************/
-  //STAR CONFIGURATION
+  //Gateway
   NodeContainer gateways;
   gateways.Create (1);
   MobilityGw.Install (gateways);
@@ -170,131 +150,250 @@ int main (int argc, char *argv[])
   macHelper.SetDeviceType (LoraMacHelper::GW);
   helper.Install (phyHelper, macHelper, gateways);
 
-
-  /*********************************************************************
-   *  Set spreading factors of End Devices
-   *********************************************************************/
   macHelper.SetSpreadingFactorsUp (endDevices, gateways, channel);
 
-
-  /*********************************************************************
-   *  Install Lora Energy Model
-   *********************************************************************/
-
+  //Energy model
   LoraEnergySourceHelper loraSourceHelper;
   LoraRadioEnergyModelHelper radioEnergyHelper;
+  loraSourceHelper.Set ("LoraEnergySourceInitialEnergyJ", DoubleValue (INITIAL_ENERGY));
+  loraSourceHelper.Set ("LoraEnergySupplyVoltageV", DoubleValue (SUPPLY_VOLTAGE));
+  radioEnergyHelper.SetConsumptionModel ("ns3::InterpolatedLoraConsumptionModel");
+  EnergySourceContainer sources = loraSourceHelper.Install (endDevices);
+  radioEnergyHelper.Install (endDevicesNetDevices, sources);
+
+  EnergyTestbed testbed;
+  Ptr<Node> node = endDevices.Get (0);
+  Ptr<LoraNetDevice> loraNetDevice = node->GetDevice (0)->GetObject<LoraNetDevice> ();
+  NS_ASSERT (loraNetDevice != 0);
+  testbed.edPhy = loraNetDevice->GetPhy ()->GetObject<EndDeviceLoraPhy> ();
+  NS_ASSERT (testbed.edPhy != 0);
+  testbed.loraEnergySource = DynamicCast<LoraEnergySource> (sources.Get (0));
+  NS_ASSERT (testbed.loraEnergySource != 0);
+  DeviceEnergyModelContainer deviceEnergyModelContainer =
+    testbed.loraEnergySource->FindDeviceEnergyModels ("ns3::LoraRadioEnergyModel");
+  testbed.loraRadioEnergyModel = DynamicCast<LoraRadioEnergyModel> (deviceEnergyModelContainer.Get (0));
+  NS_ASSERT (testbed.loraRadioEnergyModel != 0);
+  return testbed;
+}
+
+double
+ElapsedNs (std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::nano> (std::chrono::steady_clock::now () - start).count ();
+}
 
-  // configure energy source
-  loraSourceHelper.Set ("LoraEnergySourceInitialEnergyJ", DoubleValue (5.55));
-  loraSourceHelper.Set ("LoraEnergySupplyVoltageV", DoubleValue (3.7));
+} // namespace
 
-  //Attach Consumption Model
-  radioEnergyHelper.SetConsumptionModel ("ns3::InterpolatedLoraConsumptionModel");
 
-  EnergySourceContainer sources = loraSourceHelper.Install (endDevices);
+/*********************************************************************
+ * Interpolated consumption model
+ *********************************************************************/
+/*
+ * TX current at the points of the datasheet table (7, 13, 17 and 20 dBm),
+ * between them and clamped outside them
+ */
+class LoraConsumptionModelTestCase : public TestCase
+{
+public:
+  LoraConsumptionModelTestCase ();
 
+private:
+  virtual void DoRun (void);
+};
 
-  // install device model
-  DeviceEnergyModelContainer deviceModels = radioEnergyHelper.Install
-      (endDevicesNetDevices, sources);
-
-
-  /*********************************************************************
-   *  Get Test information
-   *********************************************************************/
-  //Get Phy Information
-  Ptr<Node> node = endDevices.Get(0);
-  NS_ASSERT (node != NULL);
-  Ptr<NetDevice> netDevice = node->GetDevice(0);
-  NS_ASSERT (netDevice != NULL);
-  Ptr<LoraNetDevice> loraNetDevice = netDevice->GetObject<LoraNetDevice>();
-  NS_ASSERT(loraNetDevice != NULL);
-  Ptr<EndDeviceLoraPhy> edPhy = loraNetDevice->GetPhy()->GetObject<EndDeviceLoraPhy>();
-  NS_ASSERT(edPhy!= NULL);
-
-  //Get Energy and consumption Information
-  Ptr<EnergySourceContainer> energySourceContainer = node->GetObject<EnergySourceContainer>();
-  NS_ASSERT (energySourceContainer != NULL);
-  Ptr<LoraEnergySource> loraEnergySource = DynamicCast<LoraEnergySource>(energySourceContainer->Get(0));
-  NS_ASSERT (loraEnergySource != NULL);
-  DeviceEnergyModelContainer deviceEnergyModelContainer = loraEnergySource->FindDeviceEnergyModels("ns3::LoraRadioEnergyModel");
-  Ptr<LoraRadioEnergyModel> loraRadioEnergyModel = DynamicCast<LoraRadioEnergyModel>(deviceEnergyModelContainer.Get(0));
-  NS_ASSERT (loraRadioEnergyModel != NULL);
-
-  /*********************************************************************
-   *  Test Interpolated Consumption Model
-   *********************************************************************/
-  Simulator::Schedule (Seconds(START_SIMULATION_TIME), &LoraRadioEnergyModel::CalcTxCurrentFromModel, loraRadioEnergyModel, 7.0 );
-  Simulator::Schedule (Seconds(START_SIMULATION_TIME), &LoraRadioEnergyModel::CalcTxCurrentFromModel, loraRadioEnergyModel, 8.0 );
-  Simulator::Schedule (Seconds(START_SIMULATION_TIME), &LoraRadioEnergyModel::CalcTxCurrentFromModel, loraRadioEnergyModel, 9.0 );
-  Simulator::Schedule (Seconds(START_SIMULATION_TIME), &LoraRadioEnergyModel::CalcTxCurrentFromModel, loraRadioEnergyModel, 10.0 );
-  Simulator::Schedule (Seconds(START_SIMULATION_TIME), &LoraRadioEnergyModel::CalcTxCurrentFromModel, loraRadioEnergyModel, 11.0 );
-  Simulator::Schedule (Seconds(START_SIMULATION_TIME), &LoraRadioEnergyModel::CalcTxCurrentFromModel, loraRadioEnergyModel, 12.0 );
-  Simulator::Schedule (Seconds(START_SIMULATION_TIME), &LoraRadioEnergyModel::CalcTxCurrentFromModel, loraRadioEnergyModel, 13.0 );
-  Simulator::Schedule (Seconds(START_SIMULATION_TIME), &LoraRadioEnergyModel::CalcTxCurrentFromModel, loraRadioEnergyModel, 14.0 );
-  Simulator::Schedule (Seconds(START_SIMULATION_TIME), &LoraRadioEnergyModel::CalcTxCurrentFromModel, loraRadioEnergyModel, 15.0 );
-  Simulator::Schedule (Seconds(START_SIMULATION_TIME), &LoraRadioEnergyModel::CalcTxCurrentFromModel, loraRadioEnergyModel, 16.0 );
-  Simulator::Schedule (Seconds(START_SIMULATION_TIME), &LoraRadioEnergyModel::CalcTxCurrentFromModel, loraRadioEnergyModel, 17.0 );
-  Simulator::Schedule (Seconds(START_SIMULATION_TIME), &LoraRadioEnergyModel::CalcTxCurrentFromModel, loraRadioEnergyModel, 18.0 );
-  Simulator::Schedule (Seconds(START_SIMULATION_TIME), &LoraRadioEnergyModel::CalcTxCurrentFromModel, loraRadioEnergyModel, 19.0);
-  Simulator::Schedule (Seconds(START_SIMULATION_TIME), &LoraRadioEnergyModel::CalcTxCurrentFromModel, loraRadioEnergyModel, 20.0);
-
-  /*********************************************************************
-   *  Test Listener
-   *********************************************************************/
-  Simulator::Schedule (Seconds(START_SIMULATION_TIME), &EndDeviceLoraPhy::SwitchToTx,edPhy, TX_POWER_DEFAULT);
-  Simulator::Schedule (Seconds(1), &EndDeviceLoraPhy::SwitchToRx, edPhy);
-  Simulator::Schedule (Seconds(2.25), &EndDeviceLoraPhy::SwitchToStandby, edPhy);
-  Simulator::Schedule (Seconds(3.75), &EndDeviceLoraPhy::SwitchToSleep, edPhy);
-  Simulator::Schedule (Seconds(STOP_SIMULATION_TIME), &EndDeviceLoraPhy::SwitchToStandby, edPhy);
-
-  /*********************************************************************
-   *  Test Energy Device Model
-   *********************************************************************/
-  Simulator::Schedule (Seconds(STOP_SIMULATION_TIME), &LoraRadioEnergyModel::GetTxCurrentA, loraRadioEnergyModel);
-  Simulator::Schedule (Seconds(STOP_SIMULATION_TIME), &LoraRadioEnergyModel::GetRxCurrentA, loraRadioEnergyModel);
-  Simulator::Schedule (Seconds(STOP_SIMULATION_TIME), &LoraRadioEnergyModel::GetStandbyCurrentA, loraRadioEnergyModel) ;
-  Simulator::Schedule (Seconds(STOP_SIMULATION_TIME), &LoraRadioEnergyModel::GetSleepCurrentA, loraRadioEnergyModel);
-
-  Simulator::Schedule (Seconds(STOP_SIMULATION_TIME), &LoraRadioEnergyModel::GetTotalTxTime, loraRadioEnergyModel);
-  Simulator::Schedule (Seconds(STOP_SIMULATION_TIME), &LoraRadioEnergyModel::GetTotalRxTime, loraRadioEnergyModel) ;
-  Simulator::Schedule (Seconds(STOP_SIMULATION_TIME), &LoraRadioEnergyModel::GetTotalStandbyTime, loraRadioEnergyModel);
-  Simulator::Schedule (Seconds(STOP_SIMULATION_TIME), &LoraRadioEnergyModel::GetTotalSleepTime, loraRadioEnergyModel);
-
-  Simulator::Schedule (Seconds(STOP_SIMULATION_TIME), &LoraRadioEnergyModel::GetTxEnergyConsumption, loraRadioEnergyModel);
-  Simulator::Schedule (Seconds(STOP_SIMULATION_TIME), &LoraRadioEnergyModel::GetRxEnergyConsumption, loraRadioEnergyModel) ;
-  Simulator::Schedule (Seconds(STOP_SIMULATION_TIME), &LoraRadioEnergyModel::GetStandbyEnergyConsumption, loraRadioEnergyModel);
-  Simulator::Schedule (Seconds(STOP_SIMULATION_TIME), &LoraRadioEnergyModel::GetSleepEnergyConsumption, loraRadioEnergyModel);
-  Simulator::Schedule (Seconds(STOP_SIMULATION_TIME), &LoraRadioEnergyModel::GetTotalEnergyConsumption, loraRadioEnergyModel);
-
-  /*********************************************************************
-   *  Test Energy Source Model
-   *********************************************************************/
-  Simulator::Schedule (Seconds(STOP_SIMULATION_TIME), &LoraEnergySource::GetSupplyVoltage, loraEnergySource);
-  Simulator::Schedule (Seconds(STOP_SIMULATION_TIME), &LoraEnergySource::GetInitialEnergy, loraEnergySource);
-  Simulator::Schedule (Seconds(STOP_SIMULATION_TIME), &LoraEnergySource::GetRemainingEnergy, loraEnergySource);
-
-
-  /*********************************************************************
-   *  Start Simulation
-   *********************************************************************/
-  //Set Stop Time
-  Simulator::Stop (Seconds (STOP_SIMULATION_TIME));
+LoraConsumptionModelTestCase::LoraConsumptionModelTestCase ()
+  : TestCase ("Interpolated TX current at, between and outside the table points")
+{
+}
+
+void
+LoraConsumptionModelTestCase::DoRun (void)
+{
+  Ptr<InterpolatedLoraConsumptionModel> model = CreateObject<InterpolatedLoraConsumptionModel> ();
+
+  //Table edges and inner points
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->CalcTxCurrent (7.0),  18.0e-3, CURRENT_TOLERANCE, "7 dBm (lower edge)");
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->CalcTxCurrent (13.0), 28.0e-3, CURRENT_TOLERANCE, "13 dBm");
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->CalcTxCurrent (17.0), 90.0e-3, CURRENT_TOLERANCE, "17 dBm");
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->CalcTxCurrent (20.0), 125.0e-3, CURRENT_TOLERANCE, "20 dBm (upper edge)");
+
+  //Interpolated: 18 + 10/6 (10 - 7), 28 + 62/4 (14 - 13), 90 + 35/3 (19 - 17)
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->CalcTxCurrent (10.0), 23.0e-3, CURRENT_TOLERANCE, "10 dBm");
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->CalcTxCurrent (TX_POWER_DEFAULT), TX_CURR_DEFAULT, CURRENT_TOLERANCE, "14 dBm");
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->CalcTxCurrent (19.0), (90.0 + 70.0 / 3) * 1e-3, CURRENT_TOLERANCE, "19 dBm");
+
+  //Monotonic over the whole table
+  for (double power = 7.5; power <= 20.0; power += 0.5)
+    {
+      NS_TEST_ASSERT_MSG_GT (model->CalcTxCurrent (power), model->CalcTxCurrent (power - 0.5),
+                             "TX current not increasing at " << power << " dBm");
+    }
+
+  //Out of range: current of the nearest table edge
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->CalcTxCurrent (2.0),  18.0e-3, CURRENT_TOLERANCE, "2 dBm (below table)");
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->CalcTxCurrent (-10.0), 18.0e-3, CURRENT_TOLERANCE, "-10 dBm (below table)");
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->CalcTxCurrent (20.5), 125.0e-3, CURRENT_TOLERANCE, "20.5 dBm (above table)");
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->CalcTxCurrent (27.0), 125.0e-3, CURRENT_TOLERANCE, "27 dBm (above table)");
+}
+
+
+/*********************************************************************
+ * Scripted radio timeline
+ *********************************************************************/
+/*
+ * TX (14 dBm) 1 s, RX 1.25 s, STANDBY 1.5 s, SLEEP 1.75 s through the PHY
+ * listeners; times and energies per state against hand-computed values
+ * (duration * current * 3.7 V)
+ */
+class LoraEnergyTimelineTestCase : public TestCase
+{
+public:
+  LoraEnergyTimelineTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
 
-  //Run Simulation
+LoraEnergyTimelineTestCase::LoraEnergyTimelineTestCase ()
+  : TestCase ("Per-state times and energies of a scripted TX/RX/standby/sleep timeline")
+{
+}
+
+void
+LoraEnergyTimelineTestCase::DoRun (void)
+{
+  EnergyTestbed testbed = CreateTestbed ();
+  Ptr<EndDeviceLoraPhy> edPhy = testbed.edPhy;
+  Ptr<LoraRadioEnergyModel> model = testbed.loraRadioEnergyModel;
+  Ptr<LoraEnergySource> source = testbed.loraEnergySource;
+
+  Simulator::Schedule (Seconds (TX_START), &EndDeviceLoraPhy::SwitchToTx, edPhy, TX_POWER_DEFAULT);
+  Simulator::Schedule (Seconds (RX_START), &EndDeviceLoraPhy::SwitchToRx, edPhy);
+  Simulator::Schedule (Seconds (STANDBY_START), &EndDeviceLoraPhy::SwitchToStandby, edPhy);
+  Simulator::Schedule (Seconds (SLEEP_START), &EndDeviceLoraPhy::SwitchToSleep, edPhy);
+  Simulator::Schedule (Seconds (STOP_SIMULATION_TIME), &EndDeviceLoraPhy::SwitchToStandby, edPhy);
+  Simulator::Stop (Seconds (STOP_SIMULATION_TIME));
   Simulator::Run ();
 
-  //Collect statistics
-#if 0
-  statsHelper.NodeInformation("src/lorawan/deployment/energyTest-collect.dat",endDevices,gateways);
-  statsHelper.EnergyInformation("src/lorawan/deployment/energyTest-energy.dat",endDevices);
-  statsHelper.GnuPlot2dScript ("src/lorawan/deployment/2d-energyTest-deployment","energyTest-collect.dat",LABELS);
-  statsHelper.GnuPlot3dScript ("src/lorawan/deployment/3d-energyTesst-deployment","energyTest-collect.dat",LABELS);
-#endif
-  NS_LOG_INFO("End of simulation");
+  //Currents, TX from the consumption model at 14 dBm
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->GetTxCurrentA (), TX_CURR_DEFAULT, CURRENT_TOLERANCE, "TX current");
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->GetRxCurrentA (), RX_CURR_DEFAULT, CURRENT_TOLERANCE, "RX current");
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->GetStandbyCurrentA (), STANDBY_CURR_DEFAULT, CURRENT_TOLERANCE, "STANDBY current");
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->GetSleepCurrentA (), SLEEP_CURR_DEFAULT, CURRENT_TOLERANCE, "SLEEP current");
+
+  //Times
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->GetTotalTxTime ().GetSeconds (), 1.0, TIME_TOLERANCE, "TX time");
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->GetTotalRxTime ().GetSeconds (), 1.25, TIME_TOLERANCE, "RX time");
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->GetTotalStandbyTime ().GetSeconds (), 1.5, TIME_TOLERANCE, "STANDBY time");
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->GetTotalSleepTime ().GetSeconds (), 1.75, TIME_TOLERANCE, "SLEEP time");
+
+  //Energies: 1 * 43.5 mA, 1.25 * 11.2 mA, 1.5 * 1.4 mA, 1.75 * 1.8 uA (* 3.7 V)
+  double txEnergy = 0.16095;
+  double rxEnergy = 0.0518;
+  double standbyEnergy = 0.00777;
+  double sleepEnergy = 1.1655e-5;
+  double totalEnergy = txEnergy + rxEnergy + standbyEnergy + sleepEnergy;
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->GetTxEnergyConsumption (), txEnergy, ENERGY_TOLERANCE, "TX energy");
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->GetRxEnergyConsumption (), rxEnergy, ENERGY_TOLERANCE, "RX energy");
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->GetStandbyEnergyConsumption (), standbyEnergy, ENERGY_TOLERANCE, "STANDBY energy");
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->GetSleepEnergyConsumption (), sleepEnergy, ENERGY_TOLERANCE, "SLEEP energy");
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->GetTotalEnergyConsumption (), totalEnergy, ENERGY_TOLERANCE, "Total energy");
+
+  //Source drained by the same amount
+  NS_TEST_ASSERT_MSG_EQ_TOL (source->GetSupplyVoltage (), SUPPLY_VOLTAGE, ENERGY_TOLERANCE, "Supply voltage");
+  NS_TEST_ASSERT_MSG_EQ_TOL (source->GetInitialEnergy (), INITIAL_ENERGY, ENERGY_TOLERANCE, "Initial energy");
+  NS_TEST_ASSERT_MSG_EQ_TOL (source->GetRemainingEnergy (), INITIAL_ENERGY - totalEnergy, 1e-9, "Remaining energy");
+
+  Simulator::Destroy ();
+}
+
+
+/*********************************************************************
+ * Timing budgets
+ *********************************************************************/
+/*
+ * Wall time per state transition (LoraRadioEnergyModel::ChangeState) and
+ * per source update (LoraEnergySource::UpdateEnergySource), measured inside
+ * a single event; fails when the mean cost goes over the budget
+ */
+class LoraEnergyBudgetTestCase : public TestCase
+{
+public:
+  LoraEnergyBudgetTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Measure (void);
+
+  EnergyTestbed m_testbed;
+  double m_transitionNs;
+  double m_updateNs;
+};
+
+LoraEnergyBudgetTestCase::LoraEnergyBudgetTestCase ()
+  : TestCase ("Per-transition and per-update timing budgets"),
+    m_transitionNs (0),
+    m_updateNs (0)
+{
+}
+
+void
+LoraEnergyBudgetTestCase::Measure (void)
+{
+  Ptr<LoraRadioEnergyModel> model = m_testbed.loraRadioEnergyModel;
+  Ptr<LoraEnergySource> source = m_testbed.loraEnergySource;
+  static const int states[4] = { EndDeviceLoraPhy::TX, EndDeviceLoraPhy::STANDBY,
+                                 EndDeviceLoraPhy::RX, EndDeviceLoraPhy::SLEEP };
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  for (uint32_t i = 0; i < BUDGET_ITERATIONS; i++)
+    {
+      model->ChangeState (states[i % 4]);
+    }
+  m_transitionNs = ElapsedNs (start) / BUDGET_ITERATIONS;
+
+  start = std::chrono::steady_clock::now ();
+  for (uint32_t i = 0; i < BUDGET_ITERATIONS; i++)
+    {
+      source->UpdateEnergySource ();
+    }
+  m_updateNs = ElapsedNs (start) / BUDGET_ITERATIONS;
+}
 
-  //Destroy simulation objects
+void
+LoraEnergyBudgetTestCase::DoRun (void)
+{
+  m_testbed = CreateTestbed ();
+  Simulator::Schedule (Seconds (1), &LoraEnergyBudgetTestCase::Measure, this);
+  Simulator::Stop (Seconds (2));
+  Simulator::Run ();
   Simulator::Destroy ();
 
-  return 0;
+  NS_LOG_INFO ("ChangeState " << m_transitionNs << " ns, UpdateEnergySource " << m_updateNs << " ns");
+  NS_TEST_ASSERT_MSG_GT (m_transitionNs, 0, "Transitions not measured");
+  NS_TEST_ASSERT_MSG_LT (m_transitionNs, TRANSITION_BUDGET_NS,
+                         "ChangeState over budget: " << m_transitionNs << " ns per transition");
+  NS_TEST_ASSERT_MSG_LT (m_updateNs, UPDATE_BUDGET_NS,
+                         "UpdateEnergySource over budget: " << m_updateNs << " ns per update");
 }
+
+
+/*********************************************************************
+ * Test Suite for Lora Energy Model
+ *********************************************************************/
+class LoraEnergyModelTestSuite : public TestSuite
+{
+public:
+  LoraEnergyModelTestSuite ();
+};
+
+LoraEnergyModelTestSuite::LoraEnergyModelTestSuite ()
+  : TestSuite ("lora-energy-model", UNIT)
+{
+  AddTestCase (new LoraConsumptionModelTestCase, TestCase::QUICK);
+  AddTestCase (new LoraEnergyTimelineTestCase, TestCase::QUICK);
+  //Wall-clock dependent, not part of the quick runs
+  AddTestCase (new LoraEnergyBudgetTestCase, TestCase::EXTENSIVE);
+}
+
+static LoraEnergyModelTestSuite loraEnergyModelTestSuite;
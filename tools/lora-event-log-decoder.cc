@@ -0,0 +1,247 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+//Offline decoder of the LoraEventLog binary files, standalone (no ns-3)
+//
+//  lora-event-log-decoder [-s] [-n node] [-o output] file
+//
+//Prints one line per record with the time, node and component prefixes of
+//the ns-3 text log. Records are stored in per-thread blocks, -s sorts them
+//by time (stable, so same-time records keep their order). -n keeps the
+//records of one node only.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../models/lora-event-log.h"
+
+namespace {
+
+//Record layout, event codes and version of the writer
+typedef ns3::LoraEventLog::Record Record;
+typedef ns3::LoraEventLog Log;
+const uint32_t NO_CONTEXT = 0xFFFFFFFF;
+
+//EndDeviceLoraPhy::State
+const char *
+StateName (double state)
+{
+  switch (static_cast<int> (state))
+    {
+    case 0:
+      return "SLEEP";
+    case 1:
+      return "STANDBY";
+    case 2:
+      return "TX";
+    case 3:
+      return "RX";
+    default:
+      return "UNKNOWN";
+    }
+}
+
+void
+Print (std::ostream &os, const Record &r)
+{
+  os << "+" << std::fixed << std::setprecision (9) << r.timeNs / 1e9 << "s ";
+  if (r.node == NO_CONTEXT)
+    {
+      os << "-1 ";
+    }
+  else
+    {
+      os << r.node << " ";
+    }
+  os.unsetf (std::ios::floatfield);
+  os << std::setprecision (10);
+
+  switch (r.code)
+    {
+    case Log::MODEL_STATE_CHANGE:
+      os << "LoraRadioEnergyModel:ChangeState(): [EnergyModel] Switching from state: "
+         << StateName (r.a) << " to state: " << StateName (r.b);
+      break;
+    case Log::MODEL_ENERGY_DECREMENT:
+      os << "LoraRadioEnergyModel:ChangeState(): Energy decrement " << r.a
+         << " J, energy consumption is " << r.b << " J";
+      break;
+    case Log::MODEL_TX_CURRENT:
+      os << "LoraRadioEnergyModel:CalcTxCurrentFromModel(): Input Power: " << r.a
+         << " dBm - Tx Current: " << r.b << " A";
+      break;
+    case Log::MODEL_ENERGY_DEPLETED:
+      os << "LoraRadioEnergyModel:HandleEnergyDepletion(): Energy depletion!";
+      break;
+    case Log::MODEL_ENERGY_RECHARGED:
+      os << "LoraRadioEnergyModel:HandleEnergyRecharged(): Energy recharged!";
+      break;
+    case Log::SOURCE_UPDATE:
+      os << "LoraEnergySource:CalculateRemaining(): Remaining energy = " << r.a
+         << " J, total current = " << r.b << " A";
+      break;
+    case Log::SOURCE_DRAINED:
+      os << "LoraEnergySource:HandleEnergyDrainedEvent(): Energy depleted! Remaining energy = " << r.a << " J";
+      break;
+    case Log::SOURCE_RECHARGED:
+      os << "LoraEnergySource:HandleEnergyRechargedEvent(): Energy recharged! Remaining energy = " << r.a << " J";
+      break;
+    case Log::LISTENER_TX_START:
+      os << "LoraEnergyPhyListener:NotifyTxStart(): [Listener] Notify new state: TX (" << r.a << " dBm)";
+      break;
+    case Log::LISTENER_RX_START:
+      os << "LoraEnergyPhyListener:NotifyRxStart(): [Listener] Notify new state: RX";
+      break;
+    case Log::LISTENER_STANDBY:
+      os << "LoraEnergyPhyListener:NotifyStandby(): [Listener] Notify new state: STANDBY";
+      break;
+    case Log::LISTENER_SLEEP:
+      os << "LoraEnergyPhyListener:NotifySleep(): [Listener] Notify new state: SLEEP";
+      break;
+    default:
+      os << "Unknown event code " << r.code << " a=" << r.a << " b=" << r.b;
+      break;
+    }
+  os << "\n";
+}
+
+bool
+TimeLess (const Record &x, const Record &y)
+{
+  return x.timeNs < y.timeNs;
+}
+
+void
+Usage (void)
+{
+  std::cerr << "usage: lora-event-log-decoder [-s] [-n node] [-o output] file" << std::endl
+            << "  -s         sort records by time" << std::endl
+            << "  -n node    only records of this node" << std::endl
+            << "  -o output  text output (default standard output)" << std::endl;
+}
+
+} // namespace
+
+int
+main (int argc, char *argv[])
+{
+  bool sort = false;
+  bool filter = false;
+  uint32_t node = 0;
+  std::string outputName;
+  std::string inputName;
+
+  for (int i = 1; i < argc; i++)
+    {
+      std::string arg = argv[i];
+      if (arg == "-s")
+        {
+          sort = true;
+        }
+      else if ((arg == "-n" || arg == "-o") && i + 1 < argc)
+        {
+          std::string value = argv[++i];
+          if (arg == "-n")
+            {
+              filter = true;
+              node = strtoul (value.c_str (), 0, 10);
+            }
+          else
+            {
+              outputName = value;
+            }
+        }
+      else if (!arg.empty () && arg[0] == '-')
+        {
+          Usage ();
+          return 1;
+        }
+      else
+        {
+          inputName = arg;
+        }
+    }
+  if (inputName.empty ())
+    {
+      Usage ();
+      return 1;
+    }
+
+  std::ifstream input (inputName.c_str (), std::ios::binary);
+  if (!input.is_open ())
+    {
+      std::cerr << "Cannot open " << inputName << std::endl;
+      return 1;
+    }
+  char magic[8];
+  uint32_t header[2];
+  input.read (magic, sizeof (magic));
+  input.read (reinterpret_cast<char *> (header), sizeof (header));
+  if (!input || memcmp (magic, "LORAEVT1", sizeof (magic)) != 0)
+    {
+      std::cerr << inputName << " is not a Lora event log" << std::endl;
+      return 1;
+    }
+  if (header[0] != Log::VERSION || header[1] != sizeof (Record))
+    {
+      std::cerr << inputName << ": unsupported version " << header[0]
+                << " or record size " << header[1] << std::endl;
+      return 1;
+    }
+
+  std::vector<Record> records;
+  Record record;
+  while (input.read (reinterpret_cast<char *> (&record), sizeof (record)))
+    {
+      if (!filter || record.node == node)
+        {
+          records.push_back (record);
+        }
+    }
+  if (input.gcount () != 0)
+    {
+      std::cerr << inputName << ": truncated last record ignored" << std::endl;
+    }
+  if (sort)
+    {
+      std::stable_sort (records.begin (), records.end (), TimeLess);
+    }
+
+  std::ofstream outputFile;
+  if (!outputName.empty ())
+    {
+      outputFile.open (outputName.c_str ());
+      if (!outputFile.is_open ())
+        {
+          std::cerr << "Cannot open " << outputName << std::endl;
+          return 1;
+        }
+    }
+  std::ostream &output = outputName.empty () ? std::cout : outputFile;
+  for (uint32_t i = 0; i < records.size (); i++)
+    {
+      Print (output, records[i]);
+    }
+  return 0;
+}
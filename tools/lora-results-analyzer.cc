@@ -0,0 +1,902 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+//Offline analyzer of the urban scenario result files, standalone (no ns-3)
+//
+//  lora-results-analyzer [-j threads] [-p prefix] [-o summary] [-n nodes] dir...
+//
+//Every directory is one replication holding <prefix>-energy and
+//<prefix>-collect, either as columnar binary (.col) or as text (.dat). Files
+//are memory mapped; text files are split at line boundaries and parsed by
+//several threads. For each replication and for all of them merged it reports
+//fleet aggregates, the projected lifetime percentiles, the SF histogram and,
+//joining both files on nodeId, the distance to the nearest gateway per SF.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../models/lora-streaming-stats.h"
+
+namespace {
+
+const uint32_t MIN_SF = 7;
+const uint32_t MAX_SF = 12;
+const uint32_t ABSENT_UINT = 0xFFFFFFFF;
+const double SECONDS_PER_DAY = 86400.0;
+//Projected lifetime percentiles reported
+const double QUANTILES[] = { 0.01, 0.05, 0.5, 0.95, 0.99 };
+const uint32_t N_QUANTILES = sizeof (QUANTILES) / sizeof (QUANTILES[0]);
+
+//Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+  MappedFile () : m_data (0), m_size (0)
+  {
+  }
+  ~MappedFile ()
+  {
+    if (m_data != 0)
+      {
+        munmap (const_cast<char *> (m_data), m_size);
+      }
+  }
+
+  bool Open (const std::string &fileName)
+  {
+    int fd = open (fileName.c_str (), O_RDONLY);
+    if (fd < 0)
+      {
+        return false;
+      }
+    struct stat st;
+    if (fstat (fd, &st) != 0 || st.st_size == 0)
+      {
+        close (fd);
+        return false;
+      }
+    void *data = mmap (0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (data == MAP_FAILED)
+      {
+        return false;
+      }
+    madvise (data, st.st_size, MADV_SEQUENTIAL);
+    m_data = static_cast<const char *> (data);
+    m_size = st.st_size;
+    return true;
+  }
+
+  const char *GetData (void) const
+  {
+    return m_data;
+  }
+  std::size_t GetSize (void) const
+  {
+    return m_size;
+  }
+
+private:
+  MappedFile (const MappedFile &);
+  MappedFile &operator= (const MappedFile &);
+
+  const char *m_data;
+  std::size_t m_size;
+};
+
+//Only the fields the analysis needs
+struct EnergyRow
+{
+  uint32_t nodeId;
+  uint32_t sf;
+  double elapsedS;
+  double consumedJ;
+  double remainingJ;
+};
+
+struct CollectRow
+{
+  uint32_t nodeId;
+  uint32_t sf;
+  bool gateway;
+  double x;
+  double y;
+  double z;
+};
+
+//Whitespace separated fields of one line, as [begin, end) pairs
+typedef std::vector<std::pair<const char *, const char *> > Fields;
+
+void
+SplitFields (const char *begin, const char *end, Fields &fields)
+{
+  fields.clear ();
+  const char *p = begin;
+  while (p < end)
+    {
+      while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+        {
+          p++;
+        }
+      const char *start = p;
+      while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+        {
+          p++;
+        }
+      if (p > start)
+        {
+          fields.push_back (std::make_pair (start, p));
+        }
+    }
+}
+
+//The mapping is not NUL terminated, so numbers are copied before strtod
+double
+ToDouble (const std::pair<const char *, const char *> &field)
+{
+  char buffer[64];
+  std::size_t length = std::min<std::size_t> (field.second - field.first, sizeof (buffer) - 1);
+  memcpy (buffer, field.first, length);
+  buffer[length] = '\0';
+  return strtod (buffer, 0);
+}
+
+uint32_t
+ToUint (const std::pair<const char *, const char *> &field)
+{
+  uint32_t value = 0;
+  for (const char *p = field.first; p < field.second && *p >= '0' && *p <= '9'; p++)
+    {
+      value = value * 10 + (*p - '0');
+    }
+  return value;
+}
+
+//Column indices taken from the "#name ..." header line. Find exits on a
+//missing column, so it is only called on the main thread
+class Header
+{
+public:
+  void Parse (const char *begin, const char *end)
+  {
+    Fields fields;
+    SplitFields (begin + 1, end, fields);
+    for (std::size_t i = 0; i < fields.size (); i++)
+      {
+        m_index[std::string (fields[i].first, fields[i].second)] = i;
+      }
+  }
+  int Find (const std::string &name) const
+  {
+    std::map<std::string, std::size_t>::const_iterator it = m_index.find (name);
+    if (it == m_index.end ())
+      {
+        std::cerr << "column " << name << " not found" << std::endl;
+        exit (1);
+      }
+    return static_cast<int> (it->second);
+  }
+
+private:
+  std::map<std::string, std::size_t> m_index;
+};
+
+//Resolve the columns from the header line, then run parse (begin, end,
+//columns, rows) on nThreads chunks of the data following it, chunk limits
+//moved forward to the next line start
+template <typename Row, typename Columns, typename Parser>
+bool
+ParseTextParallel (const MappedFile &file, uint32_t nThreads,
+                   Columns (*resolve) (const Header &header), Parser parse, std::vector<Row> &rows)
+{
+  const char *data = file.GetData ();
+  const char *end = data + file.GetSize ();
+  if (*data != '#')
+    {
+      return false;
+    }
+  const char *body = static_cast<const char *> (memchr (data, '\n', end - data));
+  body = body == 0 ? end : body + 1;
+  Header header;
+  header.Parse (data, body);
+  const Columns columns = resolve (header);
+
+  std::vector<const char *> limits (nThreads + 1, end);
+  limits[0] = body;
+  for (uint32_t t = 1; t < nThreads; t++)
+    {
+      const char *p = body + (end - body) * t / nThreads;
+      p = std::max (p, limits[t - 1]);
+      const char *newline = static_cast<const char *> (memchr (p, '\n', end - p));
+      limits[t] = newline == 0 ? end : newline + 1;
+    }
+
+  std::vector<std::vector<Row> > partial (nThreads);
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < nThreads; t++)
+    {
+      threads.push_back (std::thread (parse, limits[t], limits[t + 1],
+                                      std::cref (columns), std::ref (partial[t])));
+    }
+  for (uint32_t t = 0; t < nThreads; t++)
+    {
+      threads[t].join ();
+    }
+
+  std::size_t total = 0;
+  for (uint32_t t = 0; t < nThreads; t++)
+    {
+      total += partial[t].size ();
+    }
+  rows.reserve (rows.size () + total);
+  for (uint32_t t = 0; t < nThreads; t++)
+    {
+      rows.insert (rows.end (), partial[t].begin (), partial[t].end ());
+    }
+  return true;
+}
+
+//Calls onLine (begin, end) for every non empty, non comment line
+template <typename OnLine>
+void
+ForEachLine (const char *begin, const char *end, OnLine onLine)
+{
+  const char *p = begin;
+  while (p < end)
+    {
+      const char *newline = static_cast<const char *> (memchr (p, '\n', end - p));
+      const char *lineEnd = newline == 0 ? end : newline;
+      if (lineEnd > p && *p != '#')
+        {
+          onLine (p, lineEnd);
+        }
+      p = lineEnd + 1;
+    }
+}
+
+//Column indices of the energy report
+struct EnergyColumns
+{
+  int id;
+  int sf;
+  int tx;
+  int rx;
+  int standby;
+  int sleep;
+  int consumed;
+  int remaining;
+  //Highest index, shorter lines are skipped
+  int needed;
+};
+
+EnergyColumns
+ResolveEnergyColumns (const Header &header)
+{
+  EnergyColumns c;
+  c.id = header.Find ("nodeId");
+  c.sf = header.Find ("SF");
+  c.tx = header.Find ("totalTxS");
+  c.rx = header.Find ("totalRxS");
+  c.standby = header.Find ("totalStandbyS");
+  c.sleep = header.Find ("totalSleepS");
+  c.consumed = header.Find ("totalConsumedEnergy");
+  c.remaining = header.Find ("remainingEnergyJ");
+  c.needed = std::max (std::max (std::max (c.id, c.sf), std::max (c.tx, c.rx)),
+                       std::max (std::max (c.standby, c.sleep), std::max (c.consumed, c.remaining)));
+  return c;
+}
+
+void
+ParseEnergyChunk (const char *begin, const char *end, const EnergyColumns &c,
+                  std::vector<EnergyRow> &rows)
+{
+  Fields fields;
+  ForEachLine (begin, end, [&] (const char *lineBegin, const char *lineEnd)
+    {
+      SplitFields (lineBegin, lineEnd, fields);
+      if (static_cast<int> (fields.size ()) <= c.needed)
+        {
+          return;
+        }
+      EnergyRow row;
+      row.nodeId = ToUint (fields[c.id]);
+      row.sf = ToUint (fields[c.sf]);
+      row.elapsedS = ToDouble (fields[c.tx]) + ToDouble (fields[c.rx])
+        + ToDouble (fields[c.standby]) + ToDouble (fields[c.sleep]);
+      row.consumedJ = ToDouble (fields[c.consumed]);
+      row.remainingJ = ToDouble (fields[c.remaining]);
+      rows.push_back (row);
+    });
+}
+
+//Column indices of the collect report
+struct CollectColumns
+{
+  int dev;
+  int id;
+  int x;
+  int y;
+  int z;
+  int sf;
+  //Highest index needed, gateway rows stop after z
+  int needed;
+};
+
+CollectColumns
+ResolveCollectColumns (const Header &header)
+{
+  CollectColumns c;
+  c.dev = header.Find ("Dev");
+  c.id = header.Find ("nodeId");
+  c.x = header.Find ("x");
+  c.y = header.Find ("y");
+  c.z = header.Find ("z");
+  c.sf = header.Find ("SF");
+  c.needed = std::max (std::max (c.dev, c.id), std::max (c.x, std::max (c.y, c.z)));
+  return c;
+}
+
+void
+ParseCollectChunk (const char *begin, const char *end, const CollectColumns &c,
+                   std::vector<CollectRow> &rows)
+{
+  Fields fields;
+  ForEachLine (begin, end, [&] (const char *lineBegin, const char *lineEnd)
+    {
+      SplitFields (lineBegin, lineEnd, fields);
+      if (static_cast<int> (fields.size ()) <= c.needed)
+        {
+          return;
+        }
+      CollectRow row;
+      row.gateway = fields[c.dev].second - fields[c.dev].first == 2 && fields[c.dev].first[0] == 'G';
+      row.nodeId = ToUint (fields[c.id]);
+      row.x = ToDouble (fields[c.x]);
+      row.y = ToDouble (fields[c.y]);
+      row.z = ToDouble (fields[c.z]);
+      row.sf = static_cast<int> (fields.size ()) > c.sf ? ToUint (fields[c.sf]) : 0;
+      rows.push_back (row);
+    });
+}
+
+//Columnar binary file (see LoraColumnarTable), columns read in place
+class ColumnarFile
+{
+public:
+  bool Open (const std::string &fileName)
+  {
+    if (!m_file.Open (fileName) || m_file.GetSize () < HEADER_SIZE
+        || memcmp (m_file.GetData (), "LORACOL1", 8) != 0)
+      {
+        return false;
+      }
+    const char *data = m_file.GetData ();
+    uint32_t nColumns;
+    memcpy (&nColumns, data + 12, sizeof (nColumns));
+    memcpy (&m_nRows, data + 16, sizeof (m_nRows));
+    if (m_file.GetSize () < HEADER_SIZE + nColumns * ENTRY_SIZE)
+      {
+        return false;
+      }
+    for (uint32_t c = 0; c < nColumns; c++)
+      {
+        const char *entry = data + HEADER_SIZE + c * ENTRY_SIZE;
+        Column column;
+        column.name = std::string (entry, strnlen (entry, 48));
+        memcpy (&column.type, entry + 48, sizeof (column.type));
+        memcpy (&column.elementSize, entry + 52, sizeof (column.elementSize));
+        memcpy (&column.offset, entry + 56, sizeof (column.offset));
+        if (column.offset + m_nRows * column.elementSize > m_file.GetSize ())
+          {
+            return false;
+          }
+        m_columns.push_back (column);
+      }
+    return true;
+  }
+
+  uint64_t GetNRows (void) const
+  {
+    return m_nRows;
+  }
+
+  //Column index by name, -1 if missing
+  int Find (const std::string &name) const
+  {
+    for (std::size_t c = 0; c < m_columns.size (); c++)
+      {
+        if (m_columns[c].name == name)
+          {
+            return static_cast<int> (c);
+          }
+      }
+    return -1;
+  }
+
+  //Value as double, NaN if the column is missing or the value absent
+  double GetDouble (int column, uint64_t row) const
+  {
+    if (column < 0)
+      {
+        return std::numeric_limits<double>::quiet_NaN ();
+      }
+    const Column &c = m_columns[column];
+    const char *p = m_file.GetData () + c.offset + row * c.elementSize;
+    if (c.type == DOUBLE)
+      {
+        double value;
+        memcpy (&value, p, sizeof (value));
+        return value;
+      }
+    uint32_t value;
+    memcpy (&value, p, sizeof (value));
+    return value == ABSENT_UINT ? std::numeric_limits<double>::quiet_NaN () : value;
+  }
+
+  uint32_t GetUint (int column, uint64_t row) const
+  {
+    if (column < 0 || m_columns[column].type != UINT32)
+      {
+        return ABSENT_UINT;
+      }
+    const Column &c = m_columns[column];
+    uint32_t value;
+    memcpy (&value, m_file.GetData () + c.offset + row * c.elementSize, sizeof (value));
+    return value;
+  }
+
+  bool LabelEquals (int column, uint64_t row, const char *label) const
+  {
+    if (column < 0 || m_columns[column].type != LABEL)
+      {
+        return false;
+      }
+    const Column &c = m_columns[column];
+    const char *p = m_file.GetData () + c.offset + row * c.elementSize;
+    return strncmp (p, label, c.elementSize) == 0;
+  }
+
+private:
+  static const std::size_t HEADER_SIZE = 64;
+  static const std::size_t ENTRY_SIZE = 64;
+  enum
+  {
+    LABEL = 1,
+    UINT32 = 2,
+    DOUBLE = 3
+  };
+
+  struct Column
+  {
+    std::string name;
+    uint32_t type;
+    uint32_t elementSize;
+    uint64_t offset;
+  };
+
+  MappedFile m_file;
+  uint64_t m_nRows;
+  std::vector<Column> m_columns;
+};
+
+bool
+Exists (const std::string &fileName)
+{
+  struct stat st;
+  return stat (fileName.c_str (), &st) == 0;
+}
+
+bool
+LoadEnergy (const std::string &base, uint32_t nThreads, std::vector<EnergyRow> &rows)
+{
+  ColumnarFile col;
+  if (Exists (base + ".col") && col.Open (base + ".col"))
+    {
+      int id = col.Find ("nodeId");
+      int sf = col.Find ("SF");
+      int tx = col.Find ("totalTxS");
+      int rx = col.Find ("totalRxS");
+      int standby = col.Find ("totalStandbyS");
+      int sleep = col.Find ("totalSleepS");
+      int consumed = col.Find ("totalConsumedEnergy");
+      int remaining = col.Find ("remainingEnergyJ");
+      rows.resize (col.GetNRows ());
+      for (uint64_t r = 0; r < col.GetNRows (); r++)
+        {
+          rows[r].nodeId = col.GetUint (id, r);
+          rows[r].sf = col.GetUint (sf, r);
+          rows[r].elapsedS = col.GetDouble (tx, r) + col.GetDouble (rx, r)
+            + col.GetDouble (standby, r) + col.GetDouble (sleep, r);
+          rows[r].consumedJ = col.GetDouble (consumed, r);
+          rows[r].remainingJ = col.GetDouble (remaining, r);
+        }
+      return true;
+    }
+  MappedFile text;
+  return text.Open (base + ".dat")
+         && ParseTextParallel (text, nThreads, ResolveEnergyColumns, ParseEnergyChunk, rows);
+}
+
+bool
+LoadCollect (const std::string &base, uint32_t nThreads, std::vector<CollectRow> &rows)
+{
+  ColumnarFile col;
+  if (Exists (base + ".col") && col.Open (base + ".col"))
+    {
+      int dev = col.Find ("Dev");
+      int id = col.Find ("nodeId");
+      int x = col.Find ("x");
+      int y = col.Find ("y");
+      int z = col.Find ("z");
+      int sf = col.Find ("SF");
+      rows.resize (col.GetNRows ());
+      for (uint64_t r = 0; r < col.GetNRows (); r++)
+        {
+          rows[r].gateway = col.LabelEquals (dev, r, "GW");
+          rows[r].nodeId = col.GetUint (id, r);
+          rows[r].x = col.GetDouble (x, r);
+          rows[r].y = col.GetDouble (y, r);
+          rows[r].z = col.GetDouble (z, r);
+          uint32_t value = col.GetUint (sf, r);
+          rows[r].sf = value == ABSENT_UINT ? 0 : value;
+        }
+      return true;
+    }
+  MappedFile text;
+  return text.Open (base + ".dat")
+         && ParseTextParallel (text, nThreads, ResolveCollectColumns, ParseCollectChunk, rows);
+}
+
+//Exact percentile by selection, the vector is reordered
+double
+Percentile (std::vector<double> &values, double q)
+{
+  if (values.empty ())
+    {
+      return std::numeric_limits<double>::quiet_NaN ();
+    }
+  std::size_t k = static_cast<std::size_t> (q * (values.size () - 1) + 0.5);
+  std::nth_element (values.begin (), values.begin () + k, values.end ());
+  return values[k];
+}
+
+//Aggregates of one replication, or of several merged
+struct Summary
+{
+  Summary ()
+    : nodes (0), gateways (0), joined (0), unmatched (0), sfMismatch (0),
+      remainingSum (0)
+  {
+    for (uint32_t q = 0; q < N_QUANTILES; q++)
+      {
+        lifetimeQuantiles[q] = std::numeric_limits<double>::quiet_NaN ();
+      }
+    for (uint32_t i = 0; i <= MAX_SF - MIN_SF; i++)
+      {
+        sfNodes[i] = 0;
+        sfConsumed[i] = 0;
+        sfJoined[i] = 0;
+        sfDistance[i] = 0;
+      }
+  }
+
+  void Merge (const Summary &other)
+  {
+    nodes += other.nodes;
+    gateways += other.gateways;
+    joined += other.joined;
+    unmatched += other.unmatched;
+    sfMismatch += other.sfMismatch;
+    consumed.Merge (other.consumed);
+    remainingSum += other.remainingSum;
+    for (uint32_t i = 0; i <= MAX_SF - MIN_SF; i++)
+      {
+        sfNodes[i] += other.sfNodes[i];
+        sfConsumed[i] += other.sfConsumed[i];
+        sfJoined[i] += other.sfJoined[i];
+        sfDistance[i] += other.sfDistance[i];
+      }
+    lifetimeDays.insert (lifetimeDays.end (), other.lifetimeDays.begin (), other.lifetimeDays.end ());
+  }
+
+  //Fix the lifetime percentiles and release the lifetimes
+  void ReduceLifetimes (void)
+  {
+    for (uint32_t q = 0; q < N_QUANTILES; q++)
+      {
+        lifetimeQuantiles[q] = Percentile (lifetimeDays, QUANTILES[q]);
+      }
+    std::vector<double> ().swap (lifetimeDays);
+  }
+
+  uint64_t nodes;
+  uint64_t gateways;
+  uint64_t joined;
+  uint64_t unmatched;
+  uint64_t sfMismatch;
+  ns3::LoraRunningStats consumed;
+  double remainingSum;
+  uint64_t sfNodes[MAX_SF - MIN_SF + 1];
+  double sfConsumed[MAX_SF - MIN_SF + 1];
+  uint64_t sfJoined[MAX_SF - MIN_SF + 1];
+  double sfDistance[MAX_SF - MIN_SF + 1];
+  //Finite projected lifetimes, kept whole for exact percentiles until
+  //ReduceLifetimes (after they are merged into the summary of all runs)
+  std::vector<double> lifetimeDays;
+  double lifetimeQuantiles[N_QUANTILES];
+};
+
+//Optional joined per-node table
+struct JoinWriter
+{
+  std::ofstream file;
+  bool enabled;
+};
+
+void
+Analyze (const std::string &name, const std::vector<EnergyRow> &energy,
+         const std::vector<CollectRow> &collect, Summary &summary, JoinWriter &join)
+{
+  std::vector<const CollectRow *> gateways;
+  uint32_t maxId = 0;
+  for (std::size_t i = 0; i < collect.size (); i++)
+    {
+      if (collect[i].gateway)
+        {
+          gateways.push_back (&collect[i]);
+        }
+      else
+        {
+          maxId = std::max (maxId, collect[i].nodeId);
+        }
+    }
+  summary.gateways = gateways.size ();
+
+  //Node ids are dense, so the join is a direct lookup
+  std::vector<const CollectRow *> byId (collect.empty () ? 0 : maxId + 1, 0);
+  for (std::size_t i = 0; i < collect.size (); i++)
+    {
+      if (!collect[i].gateway)
+        {
+          byId[collect[i].nodeId] = &collect[i];
+        }
+    }
+
+  summary.lifetimeDays.reserve (energy.size ());
+  for (std::size_t i = 0; i < energy.size (); i++)
+    {
+      const EnergyRow &row = energy[i];
+      summary.nodes++;
+      summary.consumed.Add (row.consumedJ);
+      summary.remainingSum += row.remainingJ;
+
+      double lifetime = std::numeric_limits<double>::infinity ();
+      if (row.consumedJ > 0 && row.elapsedS > 0)
+        {
+          lifetime = row.remainingJ / (row.consumedJ / row.elapsedS) / SECONDS_PER_DAY;
+          summary.lifetimeDays.push_back (lifetime);
+        }
+
+      bool validSf = row.sf >= MIN_SF && row.sf <= MAX_SF;
+      if (validSf)
+        {
+          summary.sfNodes[row.sf - MIN_SF]++;
+          summary.sfConsumed[row.sf - MIN_SF] += row.consumedJ;
+        }
+
+      const CollectRow *position = row.nodeId < byId.size () ? byId[row.nodeId] : 0;
+      if (position == 0)
+        {
+          summary.unmatched++;
+          continue;
+        }
+      summary.joined++;
+      if (position->sf != row.sf)
+        {
+          summary.sfMismatch++;
+        }
+      double distance = std::numeric_limits<double>::infinity ();
+      for (std::size_t g = 0; g < gateways.size (); g++)
+        {
+          double dx = position->x - gateways[g]->x;
+          double dy = position->y - gateways[g]->y;
+          double dz = position->z - gateways[g]->z;
+          distance = std::min (distance, std::sqrt (dx * dx + dy * dy + dz * dz));
+        }
+      if (validSf && !gateways.empty ())
+        {
+          summary.sfJoined[row.sf - MIN_SF]++;
+          summary.sfDistance[row.sf - MIN_SF] += distance;
+        }
+      if (join.enabled)
+        {
+          join.file << name << " " << row.nodeId << " " << position->x << " "
+                    << position->y << " " << position->z << " " << row.sf << " "
+                    << distance << " " << row.consumedJ << " " << row.remainingJ << " "
+                    << lifetime << "\n";
+        }
+    }
+}
+
+void
+WriteSummary (std::ostream &out, const std::string &name, const Summary &summary)
+{
+  out << name << " " << summary.nodes << " " << summary.gateways << " "
+      << summary.consumed.GetMean () << " " << summary.consumed.GetStdDev () << " "
+      << (summary.nodes > 0 ? summary.consumed.GetMin () : 0) << " "
+      << (summary.nodes > 0 ? summary.consumed.GetMax () : 0) << " "
+      << (summary.nodes > 0 ? summary.remainingSum / summary.nodes : 0);
+  for (uint32_t q = 0; q < N_QUANTILES; q++)
+    {
+      out << " " << summary.lifetimeQuantiles[q];
+    }
+  out << " " << summary.joined << " " << summary.unmatched << " " << summary.sfMismatch << "\n";
+}
+
+void
+WriteHistogram (std::ostream &out, const std::string &name, const Summary &summary)
+{
+  for (uint32_t sf = MIN_SF; sf <= MAX_SF; sf++)
+    {
+      uint32_t i = sf - MIN_SF;
+      out << name << " " << sf << " " << summary.sfNodes[i] << " "
+          << (summary.sfNodes[i] > 0 ? summary.sfConsumed[i] / summary.sfNodes[i] : 0) << " "
+          << (summary.sfJoined[i] > 0 ? summary.sfDistance[i] / summary.sfJoined[i] : 0) << "\n";
+    }
+}
+
+void
+Usage (void)
+{
+  std::cerr << "usage: lora-results-analyzer [-j threads] [-p prefix] [-o summary] [-n nodes] dir..." << std::endl
+            << "  -j  parsing threads (default: hardware threads)" << std::endl
+            << "  -p  result file prefix (default: urban)" << std::endl
+            << "  -o  summary file (default: standard output)" << std::endl
+            << "  -n  joined per-node table" << std::endl;
+}
+
+} // namespace
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nThreads = std::max (1u, std::thread::hardware_concurrency ());
+  std::string prefix = "urban";
+  std::string summaryName;
+  std::string joinName;
+  std::vector<std::string> directories;
+
+  for (int i = 1; i < argc; i++)
+    {
+      std::string arg = argv[i];
+      if ((arg == "-j" || arg == "-p" || arg == "-o" || arg == "-n") && i + 1 < argc)
+        {
+          std::string value = argv[++i];
+          if (arg == "-j")
+            {
+              nThreads = std::max (1, atoi (value.c_str ()));
+            }
+          else if (arg == "-p")
+            {
+              prefix = value;
+            }
+          else if (arg == "-o")
+            {
+              summaryName = value;
+            }
+          else
+            {
+              joinName = value;
+            }
+        }
+      else if (!arg.empty () && arg[0] == '-')
+        {
+          Usage ();
+          return 1;
+        }
+      else
+        {
+          directories.push_back (arg);
+        }
+    }
+  if (directories.empty ())
+    {
+      Usage ();
+      return 1;
+    }
+
+  JoinWriter join;
+  join.enabled = !joinName.empty ();
+  if (join.enabled)
+    {
+      join.file.open (joinName.c_str ());
+      join.file << "#replication nodeId x y z SF gwDistanceM consumedJ remainingJ lifetimeDays\n";
+    }
+
+  std::vector<std::string> names;
+  std::vector<Summary> summaries;
+  Summary merged;
+  for (std::size_t d = 0; d < directories.size (); d++)
+    {
+      std::string base = directories[d] + "/" + prefix;
+      std::vector<EnergyRow> energy;
+      std::vector<CollectRow> collect;
+      if (!LoadEnergy (base + "-energy", nThreads, energy))
+        {
+          std::cerr << "skipping " << directories[d] << ": no readable "
+                    << prefix << "-energy.col or .dat" << std::endl;
+          continue;
+        }
+      if (!LoadCollect (base + "-collect", nThreads, collect))
+        {
+          std::cerr << directories[d] << ": no " << prefix
+                    << "-collect file, join skipped" << std::endl;
+        }
+      summaries.push_back (Summary ());
+      names.push_back (directories[d]);
+      Analyze (directories[d], energy, collect, summaries.back (), join);
+      //Lifetimes are only kept in the merged summary
+      merged.Merge (summaries.back ());
+      summaries.back ().ReduceLifetimes ();
+    }
+  if (summaries.empty ())
+    {
+      return 1;
+    }
+  merged.ReduceLifetimes ();
+
+  std::ofstream summaryFile;
+  if (!summaryName.empty ())
+    {
+      summaryFile.open (summaryName.c_str ());
+    }
+  std::ostream &out = summaryName.empty () ? std::cout : summaryFile;
+  out << std::setprecision (6);
+
+  out << "#replication nodes gateways meanConsumedJ stdConsumedJ minConsumedJ maxConsumedJ "
+      << "meanRemainingJ lifeP1Days lifeP5Days lifeP50Days lifeP95Days lifeP99Days "
+      << "joined unmatched sfMismatch\n";
+  for (std::size_t s = 0; s < summaries.size (); s++)
+    {
+      WriteSummary (out, names[s], summaries[s]);
+    }
+  WriteSummary (out, "ALL", merged);
+
+  out << "\n#replication SF nodes meanConsumedJ meanGwDistanceM\n";
+  for (std::size_t s = 0; s < summaries.size (); s++)
+    {
+      WriteHistogram (out, names[s], summaries[s]);
+    }
+  WriteHistogram (out, "ALL", merged);
+  return 0;
+}
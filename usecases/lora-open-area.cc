@@ -35,6 +35,8 @@
 #include "ns3/lora-radio-energy-model-helper.h"
 #include "ns3/lora-energy-source-helper.h"
 #include "ns3/lora-stats-helper.h"
+#include "ns3/lora-profiling-scheduler.h"
+#include "ns3/lora-event-log.h"
 #include "ns3/names.h"
 #include "ns3/one-shot-sender-helper.h"
 #include "ns3/lora-building-allocator.h"
@@ -92,6 +94,13 @@ NS_LOG_COMPONENT_DEFINE ("LoraOpenArea");
  *  Statistics configuration
  */
 #define LABELS                         true
+//Simulation minutes between progress reports
+#define PROGRESS_MINUTES                 10
+//Binary log of the energy components (lora-event-log-decoder), instead
+//of their text logs
+#define EVENT_LOG                      true
+//Event census and wall time per handler type (profiling scheduler)
+#define PROFILE_EVENTS                false
 
 /*
  *  Auto-configured parameteres, do not change it!
@@ -129,14 +138,22 @@ int main (int argc, char *argv[])
    *********************************************************************/
   LogComponentEnable ("LoraOpenArea", LOG_LEVEL_ALL);
   LogComponentEnable ("LoraStatsHelper", LOG_LEVEL_ALL);
-  LogComponentEnable ("LoraRadioEnergyModel", LOG_LEVEL_ALL);
   LogComponentEnable ("HybridBuildingsPropagationLossModel", LOG_LEVEL_ALL);
-  LogComponentEnable ("LoraConsumptionModel", LOG_LEVEL_ALL);
   LogComponentEnable("EndDeviceLoraPhy", LOG_LEVEL_ALL);
   LogComponentEnableAll (LOG_PREFIX_FUNC);
   LogComponentEnableAll (LOG_PREFIX_NODE);
   LogComponentEnableAll (LOG_PREFIX_TIME);
 
+  //Event census and wall time per handler type, report written at Simulator::Destroy
+  if (PROFILE_EVENTS)
+    {
+      LoraProfilingScheduler::Enable ("src/lorawan/deployment/open-event-profile.dat");
+    }
+
+  if (EVENT_LOG)
+    {
+      LoraEventLog::Enable ("src/lorawan/deployment/open-energy-events.evt");
+    }
 
 
   /*********************************************************************
@@ -263,8 +280,15 @@ int main (int argc, char *argv[])
   //Set Stop Time
   Simulator::Stop (Seconds (SIMULATION_TIME));
 
+  //Throughput and ETA every PROGRESS_MINUTES
+  statsHelper.SetTimeStamp (PROGRESS_MINUTES);
+  statsHelper.SetStopTime (Seconds (SIMULATION_TIME));
+  statsHelper.SetProgressFile ("src/lorawan/deployment/open-progress.dat");
+  statsHelper.SchedulePrintSimulationTime ();
+
   //Run Simulation
   Simulator::Run ();
+  LoraEventLog::Disable ();
 
   //Collect statistics
   statsHelper.NodeInformation("src/lorawan/deployment/open-collect.dat",endDevices,gateways);
@@ -35,12 +35,24 @@
 #include "ns3/lora-radio-energy-model-helper.h"
 #include "ns3/lora-energy-source-helper.h"
 #include "ns3/lora-stats-helper.h"
+#include "ns3/lora-energy-snapshot.h"
+#include "ns3/lora-energy-aggregator.h"
+#include "ns3/lora-heatmap-renderer.h"
+#include "ns3/lora-energy-curve-recorder.h"
+#include "ns3/lora-radio-state-trace.h"
+#include "ns3/lora-energy-invariant-checker.h"
+#include "ns3/lora-metrics-server.h"
+#include "ns3/lora-profiling-scheduler.h"
+#include "ns3/lora-event-log.h"
+#include "ns3/lora-phase-timer.h"
+#include "ns3/lora-parallel-setup.h"
 #include "ns3/names.h"
 #include "ns3/one-shot-sender-helper.h"
 #include "ns3/lora-building-allocator.h"
 #include "ns3/string.h"
 #include <algorithm>
 #include <ctime>
+#include <chrono>
 
 
 using namespace ns3;
@@ -95,15 +107,45 @@ NS_LOG_COMPONENT_DEFINE ("LoraUrbanArea");
 #define VOLTAGE                        3.7
 //Initial Energy of the battery in Joules
 #define INITIAL_ENERGY                 5.5
+//Manufacturing spread of mode currents (relative standard deviation)
+#define CURRENT_SPREAD                0.15
 /*
  * Simulation configuration
  */
 #define SIMULATION_TIME                3600
+//Length and number of per-state energy windows per node (seconds)
+#define ENERGY_WINDOW_LENGTH            600
+#define ENERGY_WINDOW_COUNT               6
+//Sim-time between fleet energy snapshots (seconds)
+#define SNAPSHOT_INTERVAL               300
+//Fraction of EDs with a radio state timeline (0 disables), and traced
+//window (seconds)
+#define RADIO_TRACE_RATIO                 0
+#define RADIO_TRACE_START                 0
+#define RADIO_TRACE_STOP               1800
+//Fraction of EDs with energy-conservation checks (0 disables), and
+//sim-time between checks (seconds)
+#define INVARIANT_CHECK_RATIO             0
+#define INVARIANT_CHECK_INTERVAL        600
+//Live Prometheus metrics on 127.0.0.1 (0 disables)
+#define METRICS_PORT                      0
 
 /*
  *  Statistics configuration
  */
 #define LABELS                         true
+//Threads of the parallel setup steps (0: all hardware threads)
+#define SETUP_THREADS                     0
+//Simulation minutes between progress reports
+#define PROGRESS_MINUTES                 10
+//Binary log of the energy components (lora-event-log-decoder), instead
+//of their text logs
+#define EVENT_LOG                      true
+//Event census and wall time per handler type (profiling scheduler)
+#define PROFILE_EVENTS                false
+//SQLite database collecting the results of every run, "" disables it
+//(needs lorawan built with SQLite, e.g. "src/lorawan/deployment/urban-results.db")
+#define RESULTS_DATABASE  ""
 
 /*
  *  Auto-configured parameteres, do not change it!
@@ -175,40 +217,49 @@ int main (int argc, char *argv[])
    *********************************************************************/
   LogComponentEnable ("LoraUrbanArea", LOG_LEVEL_ALL);
   LogComponentEnable ("LoraStatsHelper", LOG_LEVEL_ALL);
-  LogComponentEnable ("LoraRadioEnergyModel", LOG_LEVEL_ALL);
   LogComponentEnable ("HybridBuildingsPropagationLossModel", LOG_LEVEL_ALL);
-  LogComponentEnable ("LoraConsumptionModel", LOG_LEVEL_ALL);
   LogComponentEnable("EndDeviceLoraPhy", LOG_LEVEL_ALL);
   LogComponentEnableAll (LOG_PREFIX_FUNC);
   LogComponentEnableAll (LOG_PREFIX_NODE);
   LogComponentEnableAll (LOG_PREFIX_TIME);
 
+  //Event census and wall time per handler type (also counts pending
+  //events for the metrics), report written at Simulator::Destroy
+  if (PROFILE_EVENTS)
+    {
+      LoraProfilingScheduler::Enable ("src/lorawan/deployment/urban-event-profile.dat");
+    }
+
+  if (EVENT_LOG)
+    {
+      LoraEventLog::Enable ("src/lorawan/deployment/urban-energy-events.evt");
+    }
+
 
+  //Wall time and memory of every setup phase
+  LoraPhaseTimer phaseTimer;
 
   /*********************************************************************
    * Create buildings layout
    *********************************************************************/
+  phaseTimer.Start ("buildings");
    CreateBuildings();
 
 
   /*********************************************************************
    * Create mobility models
    *********************************************************************/
-  //In/Outdoor Mobility for EDs
-  std::ostringstream  u;
-  u << "ns3::UniformRandomVariable"  << "[Min="  << ED_OUTDOOR_HEIGHT_MIN  << "|Max=" << ED_OUTDOOR_HEIGHT_MAX << "]";
-
-  Ptr<OutdoorPositionAllocator>outdoorAllocatorEd =  CreateObject<OutdoorPositionAllocator> ();
-  outdoorAllocatorEd->SetAttribute("X",StringValue ("ns3::UniformRandomVariable[Min=-2000.0|Max=2000.0]"));
-  outdoorAllocatorEd->SetAttribute("Y",StringValue ("ns3::UniformRandomVariable[Min=-2000.0|Max=2000.0]"));
-  outdoorAllocatorEd->SetAttribute("Z",StringValue (u.str()));
+  phaseTimer.Start ("positions");
+  //In/Outdoor Mobility for EDs, drawn in parallel (counter-based streams)
+  Box outdoorArea (-2000.0, 2000.0, -2000.0, 2000.0, ED_OUTDOOR_HEIGHT_MIN, ED_OUTDOOR_HEIGHT_MAX);
+  Ptr<ListPositionAllocator> outdoorAllocatorEd = LoraParallelSetup::OutdoorPositions (N_EDS_OUTDOOR, outdoorArea, 0, 1, SETUP_THREADS);
 
   MobilityHelper outdoorMobilityEd;
   outdoorMobilityEd.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
   outdoorMobilityEd.SetPositionAllocator(outdoorAllocatorEd);
 
   //Indoor allocation
-  Ptr<RandomBuildingPositionAllocator> indoorAllocatorEd =  CreateObject<RandomBuildingPositionAllocator> ();
+  Ptr<ListPositionAllocator> indoorAllocatorEd = LoraParallelSetup::IndoorPositions (N_EDS_INDOOR, 0, 2, SETUP_THREADS);
 
   MobilityHelper indoorMobilityEd;
   indoorMobilityEd.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
@@ -283,6 +334,7 @@ int main (int argc, char *argv[])
   /*********************************************************************
    * Configure Lora Channel
    *********************************************************************/
+  phaseTimer.Start ("channel");
   //Delay model
   Ptr<PropagationDelayModel> delay = CreateObject<ConstantSpeedPropagationDelayModel> ();
   //LossModel
@@ -309,6 +361,7 @@ int main (int argc, char *argv[])
   /*********************************************************************
    * Create and configure End Devices
    *********************************************************************/
+  phaseTimer.Start ("devices");
   //Outdoor Eds
   NodeContainer outdoorEds;
   outdoorEds.Create (N_EDS_OUTDOOR);
@@ -361,20 +414,24 @@ int main (int argc, char *argv[])
   /*********************************************************************
    * Install Devices in Buildings
    *********************************************************************/
+  phaseTimer.Start ("building-membership");
   BuildingsHelper::Install (gateways);
   BuildingsHelper::Install (endDevices);
-  BuildingsHelper::MakeMobilityModelConsistent ();
+  //Building search in parallel, applied on this thread
+  LoraParallelSetup::MakeMobilityModelConsistent (NodeContainer::GetGlobal (), SETUP_THREADS);
 
 
   /*********************************************************************
    *  Set spreading factors of End Devices
    *********************************************************************/
+  phaseTimer.Start ("spreading-factors");
    macHelper.SetSpreadingFactorsUp (endDevices, gateways, channel);
 
 
   /*********************************************************************
    *  Install Application on End Devices
    *********************************************************************/
+  phaseTimer.Start ("applications");
   Time stopReporting = Seconds (SIMULATION_TIME);
   PeriodicSenderHelper appHelper = PeriodicSenderHelper ();
   appHelper.SetPeriod (Seconds (ED_APP_PERIOD));
@@ -386,9 +443,11 @@ int main (int argc, char *argv[])
   /*********************************************************************
    *  Install Lora Energy Model on End Devices
    *********************************************************************/
+  phaseTimer.Start ("energy-install");
 
   LoraEnergySourceHelper loraSourceHelper;
   LoraRadioEnergyModelHelper radioEnergyHelper;
+  Ptr<LoraEnergyMonitor> energyMonitor = CreateObject<LoraEnergyMonitor> ();
 
   // configure energy source
   loraSourceHelper.Set ("LoraEnergySourceInitialEnergyJ", DoubleValue (INITIAL_ENERGY));
@@ -396,35 +455,140 @@ int main (int argc, char *argv[])
 
 
   radioEnergyHelper.SetConsumptionModel ("ns3::InterpolatedLoraConsumptionModel");
+  radioEnergyHelper.SetCurrentSpread (CURRENT_SPREAD);
+  radioEnergyHelper.Set ("EnergyWindowLength", TimeValue (Seconds (ENERGY_WINDOW_LENGTH)));
+  radioEnergyHelper.Set ("EnergyWindowCount", UintegerValue (ENERGY_WINDOW_COUNT));
+  radioEnergyHelper.SetMonitor (energyMonitor);
+
+  // resident set before installing the energy components
+  statsHelper.MemoryBaseline ();
 
-  // install source on EDs' nodes
-  EnergySourceContainer sources = loraSourceHelper.Install (endDevices);
+  // install source on EDs' nodes (bulk path, measured)
+  std::chrono::steady_clock::time_point installStart = std::chrono::steady_clock::now ();
+  EnergySourceContainer sources = loraSourceHelper.BulkInstall (endDevices);
   Names::Add ("/Names/EnergySource", sources.Get (0));
 
 
   // install device model
-  DeviceEnergyModelContainer deviceModels = radioEnergyHelper.Install
+  DeviceEnergyModelContainer deviceModels = radioEnergyHelper.BulkInstall
       (endDevicesNetDevices, sources);
+  double installMs = std::chrono::duration<double, std::milli> (std::chrono::steady_clock::now () - installStart).count ();
+  NS_LOG_INFO ("Energy model installed on " << endDevices.GetN () << " EDs in " << installMs << " ms ("
+               << 1e3 * installMs / endDevices.GetN () << " us/ED)");
+  statsHelper.MemoryInformation("src/lorawan/deployment/urban-memory.dat",endDevices);
 
 
   /*********************************************************************
    *  Start Simulation
    *********************************************************************/
+  phaseTimer.Start ("instrumentation");
+  //Periodic energy snapshots, written while the simulation runs
+  Ptr<LoraEnergySnapshot> energySnapshot = CreateObject<LoraEnergySnapshot> ();
+  energySnapshot->SetAttribute ("Interval", TimeValue (Seconds (SNAPSHOT_INTERVAL)));
+  energySnapshot->SetAttribute ("FileName", StringValue ("src/lorawan/deployment/urban-snapshots.snp"));
+  energySnapshot->SetMonitor (energyMonitor);
+  energySnapshot->Start ();
+
+  //Discharge curve of every node, bounded number of points per node
+  Ptr<LoraEnergyCurveRecorder> curveRecorder = CreateObject<LoraEnergyCurveRecorder> ();
+  curveRecorder->Install (energyMonitor);
+
+  //Radio state timelines of a few EDs (chrome://tracing, Perfetto)
+  Ptr<LoraRadioStateTrace> radioStateTrace = CreateObject<LoraRadioStateTrace> ();
+  radioStateTrace->SetAttribute ("SamplingRatio", DoubleValue (RADIO_TRACE_RATIO));
+  radioStateTrace->SetAttribute ("StartTime", TimeValue (Seconds (RADIO_TRACE_START)));
+  radioStateTrace->SetAttribute ("StopTime", TimeValue (Seconds (RADIO_TRACE_STOP)));
+  radioStateTrace->SetAttribute ("FileName", StringValue ("src/lorawan/deployment/urban-radio-states.json"));
+  if (RADIO_TRACE_RATIO > 0)
+    {
+      radioStateTrace->Install (energyMonitor);
+    }
+
+  //Energy accounting invariants on a few EDs
+  Ptr<LoraEnergyInvariantChecker> invariantChecker = CreateObject<LoraEnergyInvariantChecker> ();
+  invariantChecker->SetAttribute ("SamplingRatio", DoubleValue (INVARIANT_CHECK_RATIO));
+  invariantChecker->SetAttribute ("Interval", TimeValue (Seconds (INVARIANT_CHECK_INTERVAL)));
+  invariantChecker->Install (energyMonitor);
+
+  //Record the run in the results database
+  if (std::string (RESULTS_DATABASE) != "")
+    {
+      if (!statsHelper.OpenDatabase (RESULTS_DATABASE))
+        {
+          NS_FATAL_ERROR ("Cannot open results database " << RESULTS_DATABASE
+                          << (LoraResultsDatabase::IsAvailable () ? "" : " (lorawan built without SQLite)"));
+        }
+      std::ostringstream parameters;
+      parameters << "indoor="   << N_EDS_INDOOR  << ";outdoor=" << N_EDS_OUTDOOR
+                 << ";gws="     << N_GWS         << ";period="  << ED_APP_PERIOD
+                 << ";simTime=" << SIMULATION_TIME << ";spread=" << CURRENT_SPREAD;
+      statsHelper.BeginDatabaseRun ("lora-urban-area", parameters.str ());
+    }
+
+  //Live metrics while the simulation runs
+  Ptr<LoraMetricsServer> metricsServer = CreateObject<LoraMetricsServer> ();
+  if (METRICS_PORT > 0)
+    {
+      metricsServer->SetAttribute ("Port", UintegerValue (METRICS_PORT));
+      metricsServer->SetMonitor (energyMonitor);
+      if (!metricsServer->Start ())
+        {
+          NS_LOG_WARN ("Metrics server not started on port " << METRICS_PORT);
+        }
+    }
+
   //Set Stop Time
   Simulator::Stop (Seconds (SIMULATION_TIME));
 
+  //Throughput and ETA every PROGRESS_MINUTES
+  statsHelper.SetTimeStamp (PROGRESS_MINUTES);
+  statsHelper.SetStopTime (Seconds (SIMULATION_TIME));
+  statsHelper.SetProgressFile ("src/lorawan/deployment/urban-progress.dat");
+  statsHelper.SchedulePrintSimulationTime ();
+
   //Run Simulation
+  phaseTimer.Start ("run");
   Simulator::Run ();
+  LoraEventLog::Disable ();
+  energySnapshot->Stop ();
+  radioStateTrace->Finish ();
+  invariantChecker->Stop ();
+  metricsServer->Stop ();
 
   //Collect statistics
-  statsHelper.NodeInformation("src/lorawan/deployment/urban-collect.dat",endDevices,gateways);
-  statsHelper.EnergyInformation("src/lorawan/deployment/urban-energy.dat",endDevices);
+  phaseTimer.Start ("statistics");
+  statsHelper.NodeInformation("src/lorawan/deployment/urban-collect.dat",energyMonitor,gateways);
+  statsHelper.EnergyInformation("src/lorawan/deployment/urban-energy.dat",energyMonitor);
+  statsHelper.NodeInformationBinary("src/lorawan/deployment/urban-collect.col",energyMonitor,gateways);
+  statsHelper.EnergyInformationBinary("src/lorawan/deployment/urban-energy.col",energyMonitor);
+  curveRecorder->WriteCurves ("src/lorawan/deployment/urban-discharge-curves.dat");
+  statsHelper.EnergyInformationDatabase(energyMonitor);
+  statsHelper.EndDatabaseRun();
+  statsHelper.EnergyWindowInformation("src/lorawan/deployment/urban-energy-windows.dat",energyMonitor);
+
+  //Consumed energy per SF, placement and nearest gateway
+  Ptr<LoraEnergyAggregator> energyAggregator = CreateObject<LoraEnergyAggregator> ();
+  energyAggregator->SetGateways (gateways);
+  energyAggregator->Collect (energyMonitor);
+  energyAggregator->Report ("src/lorawan/deployment/urban-aggregates.dat");
+
+  //Raster maps, readable for large fleets unlike the gnuplot point plots
+  LoraHeatmapRenderer heatmapRenderer;
+  heatmapRenderer.SetArea (-SCENARIO_SIDE/2, SCENARIO_SIDE/2, -SCENARIO_SIDE/2, SCENARIO_SIDE/2);
+  heatmapRenderer.Render ("src/lorawan/deployment/urban-energy-map.png", energyMonitor, LoraHeatmapRenderer::CONSUMED_ENERGY);
+  heatmapRenderer.Render ("src/lorawan/deployment/urban-sf-map.png", energyMonitor, LoraHeatmapRenderer::SPREADING_FACTOR);
+
   statsHelper.Buildings2dInformation("src/lorawan/deployment/2dBLayout.dat");
   statsHelper.Buildings3dInformation("src/lorawan/deployment/3dBLayout.dat");
+  statsHelper.BuildingsMeshInformation("src/lorawan/deployment/buildings.obj");
+  statsHelper.BuildingsBinaryInformation("src/lorawan/deployment/buildings.bld");
   statsHelper.GnuPlot2dScript ("src/lorawan/deployment/2d-urban-deployment-labels","urban-collect.dat", "2dBLayout.dat",true);
   statsHelper.GnuPlot2dScript ("src/lorawan/deployment/2d-urban-deployment","urban-collect.dat", "2dBLayout.dat",false);
   statsHelper.GnuPlot3dScript ("src/lorawan/deployment/3d-urban-deployment","urban-collect.dat", "3dBLayout.dat",LABELS);
 
+  phaseTimer.Stop ();
+  phaseTimer.Report ("src/lorawan/deployment/urban-phases.dat");
+
   NS_LOG_INFO("End of simulation");
 
   //Destroy simulation objects
@@ -0,0 +1,402 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Gabriel Dobato <gdobato@uoc.edu>
+ */
+
+#include "ns3/end-device-lora-phy.h"
+#include "ns3/gateway-lora-phy.h"
+#include "ns3/end-device-lora-mac.h"
+#include "ns3/gateway-lora-mac.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/lora-helper.h"
+#include "ns3/node-container.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/position-allocator.h"
+#include "ns3/double.h"
+#include "ns3/periodic-sender-helper.h"
+#include "ns3/command-line.h"
+#include "ns3/lora-radio-energy-model-helper.h"
+#include "ns3/lora-energy-source-helper.h"
+#include "ns3/lora-stats-helper.h"
+#include "ns3/lora-phase-timer.h"
+#include "ns3/lora-parallel-setup.h"
+#include "ns3/lora-process-info.h"
+#include "ns3/lora-building-allocator.h"
+#include "ns3/string.h"
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("LoraUrbanScaling");
+
+/*********************************************************************
+ * Parameters configuration
+ *********************************************************************/
+/*
+ * Scenario dimensions and buildings layout, as in lora-urban-area
+ */
+#define SCENARIO_SIDE                  4000
+#define X_BUILDINGLENGHT                 60
+#define Y_BUILDINGLENGHT                120
+#define BUILDING_HEIGHT                  40
+#define DELTAX_BUILDING                  40
+#define DELTAY_BUILDING                  20
+#define SQAUARELAYOUT_SIDE    SCENARIO_SIDE
+#define BUILDINGGRID_SEPARATION         100
+
+/*
+ * Network configuration
+ */
+//Fraction of EDs placed inside buildings
+#define INDOOR_RATIO                    0.5
+#define GATEWAY_HEIGHT                   45
+#define ED_OUTDOOR_HEIGHT_MIN           1.5
+#define ED_OUTDOOR_HEIGHT_MAX             5
+#define ED_APP_PERIOD                   360
+#define FREQUENCY                     868e6
+/*
+ * Energy Model Configuration
+ */
+#define VOLTAGE                        3.7
+#define INITIAL_ENERGY                 5.5
+
+/*
+ * Sweep configuration (comma separated lists, every combination is run)
+ */
+#define SWEEP_EDS     "1000,10000,50000,100000,200000"
+#define SWEEP_GWS                      "1,3,9"
+#define SWEEP_SIM_TIMES           "600,3600"
+//Run every point in its own process, so that peak RSS is per point and a
+//point killed by the OOM killer does not end the sweep
+#define ISOLATE_POINTS                 true
+#define SETUP_THREADS                     0
+#define SCALING_CSV   "src/lorawan/deployment/urban-scaling.csv"
+#define SCALING_OUTPUT "src/lorawan/deployment/urban-scaling"
+
+
+/*********************************************************************
+ * Auxiliar functions
+ *********************************************************************/
+/*
+ * Function to Create buldings layout
+ */
+void CreateBuildings(void)
+{
+  double xGrid   = -(SQAUARELAYOUT_SIDE/2);
+  double yGrid    = -(SQAUARELAYOUT_SIDE/2);
+  double gridWidth = SQAUARELAYOUT_SIDE/(X_BUILDINGLENGHT + DELTAX_BUILDING);
+  uint elements = static_cast<uint>((SQAUARELAYOUT_SIDE/(Y_BUILDINGLENGHT + DELTAY_BUILDING+BUILDINGGRID_SEPARATION))*gridWidth);
+  double limitY = yGrid;
+
+  //Configure Grid
+  Ptr<GridBuildingAllocator>  gridBuildingAllocator;
+  gridBuildingAllocator = CreateObject<GridBuildingAllocator> ();
+  gridBuildingAllocator->SetAttribute ("LengthX", DoubleValue (X_BUILDINGLENGHT));
+  gridBuildingAllocator->SetAttribute ("LengthY", DoubleValue (Y_BUILDINGLENGHT));
+  gridBuildingAllocator->SetAttribute ("DeltaX", DoubleValue (DELTAX_BUILDING));
+  gridBuildingAllocator->SetAttribute ("DeltaY", DoubleValue (DELTAY_BUILDING));
+  gridBuildingAllocator->SetAttribute ("Height", DoubleValue (BUILDING_HEIGHT));
+  gridBuildingAllocator->SetBuildingAttribute ("NRoomsX", UintegerValue (10));
+  gridBuildingAllocator->SetBuildingAttribute ("NRoomsY", UintegerValue (3));
+  gridBuildingAllocator->SetBuildingAttribute ("NFloors", UintegerValue (10));
+  gridBuildingAllocator->SetAttribute ("MinX", DoubleValue (xGrid));
+  gridBuildingAllocator->SetAttribute ("MinY", DoubleValue (yGrid));
+  gridBuildingAllocator->SetAttribute ("GridWidth", UintegerValue (gridWidth));
+
+  //Limit scope
+  while (limitY < 2000)
+    {
+      gridBuildingAllocator->Create (elements);
+      limitY += ((elements/gridWidth)*Y_BUILDINGLENGHT) + ((elements/gridWidth-1)*DELTAY_BUILDING) + BUILDINGGRID_SEPARATION;
+    }
+}
+
+/*
+ * Function to parse a comma separated list of numbers
+ */
+std::vector<uint32_t> ParseList (std::string list)
+{
+  std::vector<uint32_t> values;
+  std::istringstream stream (list);
+  std::string item;
+  while (std::getline (stream, item, ','))
+    {
+      if (!item.empty ())
+        {
+          values.push_back (std::strtoul (item.c_str (), 0, 10));
+        }
+    }
+  return values;
+}
+
+/*
+ * Function to place gateways: one in the centre, the rest evenly spread on
+ * a ring at a quarter of the scenario side, above the rooftops
+ */
+Ptr<ListPositionAllocator> GatewayPositions (uint32_t nGws)
+{
+  Ptr<ListPositionAllocator> allocator = CreateObject<ListPositionAllocator> ();
+  allocator->Add (Vector (0, 0, GATEWAY_HEIGHT));
+  for (uint32_t i = 1; i < nGws; i++)
+    {
+      double angle = 2 * M_PI * (i - 1) / (nGws - 1);
+      allocator->Add (Vector (SCENARIO_SIDE/4 * std::cos (angle), SCENARIO_SIDE/4 * std::sin (angle), GATEWAY_HEIGHT));
+    }
+  return allocator;
+}
+
+/*
+ * Measures of one sweep point
+ */
+struct ScalingPoint
+{
+  uint32_t eds;
+  uint32_t gws;
+  uint32_t simTime;
+  double setupMs;
+  double runMs;
+  uint64_t events;
+  uint64_t peakRssBytes;
+  double statsMs;
+};
+
+void WriteHeader (std::ofstream &csv)
+{
+  csv << "eds,gws,simTime,setupMs,runMs,events,eventsPerSecond,peakRssMiB,statsMs,status\n";
+}
+
+void WritePoint (std::ofstream &csv, const ScalingPoint &point, std::string status)
+{
+  csv << point.eds << "," << point.gws << "," << point.simTime << ","
+      << std::fixed << std::setprecision (3)
+      << point.setupMs << "," << point.runMs << "," << point.events << ","
+      << (point.runMs > 0 ? 1e3 * point.events / point.runMs : 0) << ","
+      << point.peakRssBytes / 1048576.0 << "," << point.statsMs << ","
+      << status << std::endl;
+}
+
+/*
+ * Function to run one point of the sweep, the urban area setup without
+ * logging nor instrumentation
+ */
+void RunPoint (ScalingPoint &point, std::string outputPrefix)
+{
+  LoraPhaseTimer phaseTimer;
+  uint32_t nIndoor = static_cast<uint32_t> (point.eds * INDOOR_RATIO);
+  uint32_t nOutdoor = point.eds - nIndoor;
+
+  phaseTimer.Start ("setup");
+  CreateBuildings ();
+
+  //Mobility
+  Box outdoorArea (-SCENARIO_SIDE/2, SCENARIO_SIDE/2, -SCENARIO_SIDE/2, SCENARIO_SIDE/2, ED_OUTDOOR_HEIGHT_MIN, ED_OUTDOOR_HEIGHT_MAX);
+  MobilityHelper outdoorMobilityEd;
+  outdoorMobilityEd.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  outdoorMobilityEd.SetPositionAllocator (LoraParallelSetup::OutdoorPositions (nOutdoor, outdoorArea, 0, 1, SETUP_THREADS));
+  MobilityHelper indoorMobilityEd;
+  indoorMobilityEd.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  indoorMobilityEd.SetPositionAllocator (LoraParallelSetup::IndoorPositions (nIndoor, 0, 2, SETUP_THREADS));
+  MobilityHelper mobilityGw;
+  mobilityGw.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobilityGw.SetPositionAllocator (GatewayPositions (point.gws));
+
+  //Channel
+  Ptr<PropagationDelayModel> delay = CreateObject<ConstantSpeedPropagationDelayModel> ();
+  Ptr<HybridBuildingsPropagationLossModel> hybridLoss = CreateObject<HybridBuildingsPropagationLossModel> ();
+  hybridLoss->SetAttribute("Frequency",DoubleValue(FREQUENCY));
+  hybridLoss->SetAttribute("Environment",StringValue("Urban"));
+  hybridLoss->SetAttribute("CitySize",StringValue("Large"));
+  hybridLoss->SetAttribute("RooftopLevel",DoubleValue(BUILDING_HEIGHT));
+  Ptr<LoraChannel> channel = CreateObject<LoraChannel> (hybridLoss, delay);
+
+  LoraPhyHelper phyHelper = LoraPhyHelper ();
+  phyHelper.SetChannel (channel);
+  LoraMacHelper macHelper = LoraMacHelper ();
+  LoraHelper helper = LoraHelper ();
+  LoraStatsHelper statsHelper = LoraStatsHelper();
+
+  //End Devices
+  NodeContainer outdoorEds;
+  outdoorEds.Create (nOutdoor);
+  outdoorMobilityEd.Install (outdoorEds);
+  NodeContainer indoorEds;
+  indoorEds.Create (nIndoor);
+  indoorMobilityEd.Install (indoorEds);
+  NodeContainer endDevices;
+  endDevices.Add(outdoorEds);
+  endDevices.Add(indoorEds);
+  phyHelper.SetDeviceType (LoraPhyHelper::ED);
+  macHelper.SetDeviceType (LoraMacHelper::ED);
+  NetDeviceContainer endDevicesNetDevices = helper.Install (phyHelper, macHelper, endDevices);
+
+  //Gateways
+  NodeContainer gateways;
+  gateways.Create (point.gws);
+  mobilityGw.Install (gateways);
+  phyHelper.SetDeviceType (LoraPhyHelper::GW);
+  macHelper.SetDeviceType (LoraMacHelper::GW);
+  helper.Install (phyHelper, macHelper, gateways);
+
+  BuildingsHelper::Install (gateways);
+  BuildingsHelper::Install (endDevices);
+  LoraParallelSetup::MakeMobilityModelConsistent (NodeContainer::GetGlobal (), SETUP_THREADS);
+  macHelper.SetSpreadingFactorsUp (endDevices, gateways, channel);
+
+  //Applications
+  PeriodicSenderHelper appHelper = PeriodicSenderHelper ();
+  appHelper.SetPeriod (Seconds (ED_APP_PERIOD));
+  ApplicationContainer appContainer = appHelper.Install (endDevices);
+  appContainer.Start (Seconds (0));
+  appContainer.Stop (Seconds (point.simTime));
+
+  //Energy model
+  LoraEnergySourceHelper loraSourceHelper;
+  LoraRadioEnergyModelHelper radioEnergyHelper;
+  Ptr<LoraEnergyMonitor> energyMonitor = CreateObject<LoraEnergyMonitor> ();
+  loraSourceHelper.Set ("LoraEnergySourceInitialEnergyJ", DoubleValue (INITIAL_ENERGY));
+  loraSourceHelper.Set ("LoraEnergySupplyVoltageV", DoubleValue (VOLTAGE));
+  radioEnergyHelper.SetConsumptionModel ("ns3::InterpolatedLoraConsumptionModel");
+  radioEnergyHelper.SetMonitor (energyMonitor);
+  EnergySourceContainer sources = loraSourceHelper.BulkInstall (endDevices);
+  radioEnergyHelper.BulkInstall (endDevicesNetDevices, sources);
+
+  //Run
+  Simulator::Stop (Seconds (point.simTime));
+  uint64_t eventsBefore = Simulator::GetEventCount ();
+  phaseTimer.Start ("run");
+  Simulator::Run ();
+  phaseTimer.Stop ();
+  point.events = Simulator::GetEventCount () - eventsBefore;
+
+  //Statistics, the writers of the urban area scenario
+  phaseTimer.Start ("statistics");
+  statsHelper.NodeInformation (outputPrefix + "-collect.dat", energyMonitor, gateways);
+  statsHelper.EnergyInformation (outputPrefix + "-energy.dat", energyMonitor);
+  statsHelper.NodeInformationBinary (outputPrefix + "-collect.col", energyMonitor, gateways);
+  statsHelper.EnergyInformationBinary (outputPrefix + "-energy.col", energyMonitor);
+  phaseTimer.Stop ();
+
+  const std::vector<LoraPhaseTimer::Phase> &phases = phaseTimer.GetPhases ();
+  point.setupMs = phases[0].wallMs;
+  point.runMs = phases[1].wallMs;
+  point.statsMs = phases[2].wallMs;
+  point.peakRssBytes = LoraProcessInfo::GetPeakResidentBytes ();
+
+  Simulator::Destroy ();
+}
+
+
+/*********************************************************************
+ * Main Program - Urban Area Scaling Sweep
+ *********************************************************************/
+
+int main (int argc, char *argv[])
+{
+  std::string edsList = SWEEP_EDS;
+  std::string gwsList = SWEEP_GWS;
+  std::string simTimesList = SWEEP_SIM_TIMES;
+  std::string csvName = SCALING_CSV;
+  std::string outputPrefix = SCALING_OUTPUT;
+  bool isolate = ISOLATE_POINTS;
+
+  CommandLine cmd;
+  cmd.AddValue ("eds", "Comma separated numbers of end devices", edsList);
+  cmd.AddValue ("gws", "Comma separated numbers of gateways", gwsList);
+  cmd.AddValue ("simTimes", "Comma separated simulation times (seconds)", simTimesList);
+  cmd.AddValue ("csv", "Output CSV file", csvName);
+  cmd.AddValue ("output", "Prefix of the statistics files of every point", outputPrefix);
+  cmd.AddValue ("isolate", "Run every point in a child process", isolate);
+  cmd.Parse (argc, argv);
+
+  std::vector<uint32_t> eds = ParseList (edsList);
+  std::vector<uint32_t> gws = ParseList (gwsList);
+  std::vector<uint32_t> simTimes = ParseList (simTimesList);
+
+  std::ofstream csv (csvName.c_str ());
+  WriteHeader (csv);
+
+  //Sweep progress goes to standard error, also in optimized builds
+  uint32_t nPoints = eds.size () * gws.size () * simTimes.size ();
+  uint32_t index = 0;
+  uint32_t nFailed = 0;
+
+  for (uint32_t e = 0; e < eds.size (); e++)
+    {
+      for (uint32_t g = 0; g < gws.size (); g++)
+        {
+          for (uint32_t s = 0; s < simTimes.size (); s++)
+            {
+              ScalingPoint point = ScalingPoint ();
+              point.eds = eds[e];
+              point.gws = std::max (1u, gws[g]);
+              point.simTime = simTimes[s];
+              index++;
+              std::cerr << "Point " << index << "/" << nPoints << ": eds=" << point.eds
+                        << " gws=" << point.gws << " simTime=" << point.simTime << std::endl;
+
+              if (!isolate)
+                {
+                  RunPoint (point, outputPrefix);
+                  WritePoint (csv, point, "ok");
+                  continue;
+                }
+
+              //The child writes its own row; a crashed child gets a failed row
+              csv.flush ();
+              pid_t child = fork ();
+              if (child < 0)
+                {
+                  NS_FATAL_ERROR ("Can not fork the sweep point");
+                }
+              if (child == 0)
+                {
+                  RunPoint (point, outputPrefix);
+                  WritePoint (csv, point, "ok");
+                  csv.close ();
+                  _exit (0);
+                }
+              int status = 0;
+              waitpid (child, &status, 0);
+              if (!WIFEXITED (status) || WEXITSTATUS (status) != 0)
+                {
+                  std::ostringstream reason;
+                  reason << (WIFSIGNALED (status) ? "signal-" : "exit-")
+                         << (WIFSIGNALED (status) ? WTERMSIG (status) : WEXITSTATUS (status));
+                  nFailed++;
+                  std::cerr << "Point " << index << "/" << nPoints << " failed: " << reason.str () << std::endl;
+                  WritePoint (csv, point, reason.str ());
+                }
+            }
+        }
+    }
+
+  std::cerr << "Scaling results written to " << csvName << " (" << nFailed << " of "
+            << nPoints << " points failed)" << std::endl;
+  return 0;
+}